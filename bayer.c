@@ -0,0 +1,251 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bayer.h"
+
+/**
+ * @addtogroup bayer
+ * @{
+ */
+
+/**************************************/
+
+/** Bayer demosaicing instance. */
+struct bayer_t {
+	unsigned width;				/**< Width of frames, in pixels, rounded down to even. */
+	unsigned height;			/**< Height of frames, in pixels. */
+	unsigned bytesperline;		/**< Bytes per each line of the frame, including padding, if any. */
+	unsigned scale;				/**< Downscaling factor: 1, 2, 4 or 8. */
+	unsigned shift;				/**< Binary logarithm of the number of red (or blue) samples averaged into one. */
+	unsigned out_width;			/**< Width of the output image, in pixels. */
+	unsigned red_x;				/**< Column of red samples in each 2x2 block (0 or 1). */
+	unsigned red_y;				/**< Line of red samples in each 2x2 block (0 or 1). */
+	unsigned char *lines[3];	/**< Previous, current & next line, with one sample mirrored at both ends. */
+	unsigned char *rgb[3];		/**< Red, green & blue samples of the output line. */
+	unsigned short *sums[3];	/**< Column sums of red, green & blue samples of 2x2 blocks, used when downscaling. */
+};
+
+/**************************************/
+
+/**
+ * Converts a line of RGB samples to Y, Cb & Cr rows (JFIF conversion),
+ * averaging chroma of each pair of pixels.
+ *
+ * @param bayer Bayer demosaicing instance.
+ * @param yp Destination Y row.
+ * @param up Destination Cb row.
+ * @param vp Destination Cr row.
+ */
+static void bayer_convert(bayer_t *bayer, unsigned char *yp, unsigned char *up, unsigned char *vp)
+{
+	const unsigned char *r = bayer->rgb[0], *g = bayer->rgb[1], *b = bayer->rgb[2];
+	unsigned x, pairs = bayer->out_width / 2;
+
+	/* 8-bit fixed point keeps products within 16 bits, so the compiler vectorizes it 8 or 16 samples at once; offsets keep sums positive */
+	for (x = 0; x < pairs * 2; x++)
+		yp[x] = (77 * r[x] + 150 * g[x] + 29 * b[x] + 128) >> 8;
+	for (x = 0; x < pairs; x++) {
+		unsigned rs = r[2 * x] + r[2 * x + 1], gs = g[2 * x] + g[2 * x + 1], bs = b[2 * x] + b[2 * x + 1];
+
+		up[x] = (128 * bs - 43 * rs - 85 * gs + (128 << 9) + 255) >> 9;
+		vp[x] = (128 * rs - 107 * gs - 21 * bs + (128 << 9) + 255) >> 9;
+	}
+}
+
+/**
+ * Copies a line of the frame mirroring one sample at both ends, so that
+ * samples at the edges have neighbours of proper colours.
+ *
+ * @param bayer Bayer demosaicing instance.
+ * @param dst Destination buffer (width + 2 samples).
+ * @param src Source line.
+ */
+static void bayer_pad(bayer_t *bayer, unsigned char *dst, const unsigned char *src)
+{
+	memcpy(dst + 1, src, bayer->width);
+	dst[0] = src[1];
+	dst[bayer->width + 1] = src[bayer->width - 2];
+}
+
+/**
+ * Interpolates missing samples of a line bilinearly.
+ *
+ * @param prev Previous line (index -1 and width are valid).
+ * @param cur Current line (index -1 and width are valid).
+ * @param next Next line (index -1 and width are valid).
+ * @param pairs Number of pixel pairs (half of the width).
+ * @param site Column of non-green samples of the current line in each pair (0 or 1).
+ * @param own Destination of samples of the colour present in the current line (red or blue).
+ * @param g Destination of green samples.
+ * @param other Destination of samples of the colour absent from the current line.
+ */
+static void bayer_interpolate(const unsigned char *prev, const unsigned char *cur, const unsigned char *next, unsigned pairs, unsigned site,
+	unsigned char *own, unsigned char *g, unsigned char *other)
+{
+	unsigned x;
+
+	/* vectorized gathering of alternate samples turns out slower than this */
+	for (x = 0; x < pairs; x++) {
+		int c = 2 * x + site, n = 2 * x + !site;
+
+		own[c] = cur[c];
+		g[c] = (cur[c - 1] + cur[c + 1] + prev[c] + next[c] + 2) >> 2;
+		other[c] = (prev[c - 1] + prev[c + 1] + next[c - 1] + next[c + 1] + 2) >> 2;
+		own[n] = (cur[n - 1] + cur[n + 1] + 1) >> 1;
+		g[n] = cur[n];
+		other[n] = (prev[n] + next[n] + 1) >> 1;
+	}
+}
+
+/**
+ * Demosaics a line of a frame of original size.
+ *
+ * @param bayer Bayer demosaicing instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param row Index of the line.
+ * @return 0 on success, -1 if the frame is too short.
+ */
+static int bayer_line_full(bayer_t *bayer, const unsigned char *frame, size_t size, unsigned row)
+{
+	size_t bpl = bayer->bytesperline;
+	unsigned prev = row ? row - 1 : 1, next = row + 1 < bayer->height ? row + 1 : row - 1;
+	unsigned red = (row & 1) == bayer->red_y;
+
+	if (row * bpl + bayer->width > size)
+		return -1;
+	if (next * bpl + bayer->width > size)
+		next = prev;
+	bayer_pad(bayer, bayer->lines[0], frame + prev * bpl);
+	bayer_pad(bayer, bayer->lines[1], frame + row * bpl);
+	bayer_pad(bayer, bayer->lines[2], frame + next * bpl);
+	bayer_interpolate(bayer->lines[0] + 1, bayer->lines[1] + 1, bayer->lines[2] + 1, bayer->width / 2,
+		red ? bayer->red_x : !bayer->red_x,
+		bayer->rgb[red ? 0 : 2], bayer->rgb[1], bayer->rgb[red ? 2 : 0]);
+	return 0;
+}
+
+/**
+ * Averages red, green & blue samples of blocks of @c scale x @c scale
+ * pixels making a line of a downscaled frame.
+ *
+ * @param bayer Bayer demosaicing instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param row Index of the output line.
+ * @return 0 on success, -1 if the frame is too short.
+ */
+static int bayer_line_scaled(bayer_t *bayer, const unsigned char *frame, size_t size, unsigned row)
+{
+	unsigned short *rs = bayer->sums[0], *gs = bayer->sums[1], *bs = bayer->sums[2];
+	unsigned quads = bayer->width / 2, q = bayer->scale / 2, shift = bayer->shift;
+	unsigned round = (1 << shift) >> 1;
+	size_t bpl = bayer->bytesperline, first = (size_t) row * bayer->scale * bpl;
+	const unsigned char *src = frame + first;
+	unsigned rx = bayer->red_x, bx = !rx;
+	unsigned l, x, k;
+
+	if (first + (bayer->scale - 1) * bpl + bayer->width > size)
+		return -1;
+	/* vertical pass: sum up columns of 2x2 blocks */
+	memset(rs, 0, quads * sizeof(*rs));
+	memset(gs, 0, quads * sizeof(*gs));
+	memset(bs, 0, quads * sizeof(*bs));
+	for (l = 0; l < q; l++, src += 2 * bpl) {
+		const unsigned char *red = src + bayer->red_y * bpl, *blue = src + !bayer->red_y * bpl;
+
+		for (x = 0; x < quads; x++) {
+			rs[x] += red[2 * x + rx];
+			gs[x] += red[2 * x + bx] + blue[2 * x + rx];
+			bs[x] += blue[2 * x + bx];
+		}
+	}
+	/* horizontal pass: sum up neighbours & divide */
+	for (x = 0; x < bayer->out_width; x++) {
+		unsigned r = round, g = 1 << shift, b = round;
+
+		for (k = 0; k < q; k++) {
+			r += rs[x * q + k];
+			g += gs[x * q + k];
+			b += bs[x * q + k];
+		}
+		bayer->rgb[0][x] = r >> shift;
+		bayer->rgb[1][x] = g >> (shift + 1);
+		bayer->rgb[2][x] = b >> shift;
+	}
+	return 0;
+}
+
+/**************************************/
+
+bayer_t *bayer_create(const capture_data_format_t *format, unsigned scale)
+{
+	bayer_t *rv;
+	unsigned c;
+
+	if (!CAPTURE_FMT_IS_BAYER(format->fmt) || format->width < 2 || format->height < 2 || format->width / scale < 2) {
+		fprintf(stderr, "Unsupported Bayer frame %u x %u at scale 1/%u\n", format->width, format->height, scale);
+		return NULL;
+	}
+	rv = (bayer_t *) calloc(1, sizeof(bayer_t));
+	rv->width = format->width & ~1U;
+	rv->height = format->height;
+	rv->bytesperline = format->bytesperline;
+	rv->scale = scale;
+	for (rv->shift = 0; (1U << rv->shift) < scale / 2; rv->shift++)
+		;
+	rv->shift *= 2;
+	rv->out_width = format->width / scale & ~1U;
+	rv->red_x = CAPTURE_BAYER_RED_X(format->fmt);
+	rv->red_y = CAPTURE_BAYER_RED_Y(format->fmt);
+	for (c = 0; c < 3; c++) {
+		rv->rgb[c] = malloc(rv->out_width);
+		if (scale == 1)
+			rv->lines[c] = malloc(rv->width + 2);
+		else
+			rv->sums[c] = malloc(rv->width / 2 * sizeof(*rv->sums[c]));
+	}
+	return rv;
+}
+
+int bayer_line(bayer_t *bayer, const unsigned char *frame, size_t size, unsigned row, unsigned char *yp, unsigned char *up, unsigned char *vp)
+{
+	if (bayer->scale == 1 ? bayer_line_full(bayer, frame, size, row) : bayer_line_scaled(bayer, frame, size, row))
+		return -1;
+	bayer_convert(bayer, yp, up, vp);
+	return 0;
+}
+
+void bayer_destroy(bayer_t *bayer)
+{
+	unsigned c;
+
+	for (c = 0; c < 3; c++) {
+		free(bayer->lines[c]);
+		free(bayer->rgb[c]);
+		free(bayer->sums[c]);
+	}
+	free(bayer);
+}
+
+/**
+ * @}
+ */
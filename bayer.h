@@ -0,0 +1,75 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef	BAYER_H
+#define	BAYER_H
+
+/**
+ * @defgroup bayer Bayer demosaicing
+ * @{
+ * Converts lines of 8-bit raw Bayer frames into Y, Cb & Cr rows
+ */
+
+#include <stddef.h>
+#include "capture.h"
+
+/** Bayer demosaicing instance. */
+typedef struct bayer_t bayer_t;
+
+/**
+ * Creates a Bayer demosaicing instance.
+ *
+ * Frames of original size are interpolated bilinearly. Downscaled frames
+ * are made of averages of red, green and blue samples of each block of
+ * @c scale x @c scale pixels, so 1/2 scale costs no interpolation at all.
+ *
+ * @param format Format of captured frames; must be one of Bayer formats.
+ * @param scale Downscaling factor (1, 2, 4 or 8).
+ * @return An instance of Bayer demosaicing, or NULL on error.
+ */
+bayer_t *bayer_create(const capture_data_format_t *format, unsigned scale);
+
+/**
+ * Converts a line of the output image.
+ *
+ * Y row gets (width / scale) & ~1 samples; Cb & Cr rows get half of that
+ * (horizontally subsampled, as in YUV 4:2:2).
+ *
+ * @param bayer Bayer demosaicing instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param row Index of the output line.
+ * @param yp Destination Y row.
+ * @param up Destination Cb row.
+ * @param vp Destination Cr row.
+ * @return 0 on success, -1 if the frame is too short.
+ */
+int bayer_line(bayer_t *bayer, const unsigned char *frame, size_t size, unsigned row, unsigned char *yp, unsigned char *up, unsigned char *vp);
+
+/**
+ * Destroys a Bayer demosaicing instance.
+ *
+ * @param bayer Bayer demosaicing instance.
+ */
+void bayer_destroy(bayer_t *bayer);
+
+/**
+ * @}
+ */
+
+#endif
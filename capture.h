@@ -37,14 +37,30 @@ typedef enum {
 	CAPTURE_FMT__JPEG,
 	/** Data given frame by frame, each as a MJPEG image (JPEG without Huffman table). */
 	CAPTURE_FMT__MJPEG,
+	/** Data given frame by frame, each as 8-bit raw Bayer image, red at even column of even line. */
+	CAPTURE_FMT__BAYER_RGGB8,
+	/** Data given frame by frame, each as 8-bit raw Bayer image, red at odd column of even line. */
+	CAPTURE_FMT__BAYER_GRBG8,
+	/** Data given frame by frame, each as 8-bit raw Bayer image, red at even column of odd line. */
+	CAPTURE_FMT__BAYER_GBRG8,
+	/** Data given frame by frame, each as 8-bit raw Bayer image, red at odd column of odd line. */
+	CAPTURE_FMT__BAYER_BGGR8,
 } capture_data_format_e;
 
+/** Tells whether given capture data format is one of raw Bayer formats. */
+#define	CAPTURE_FMT_IS_BAYER(fmt)	((fmt) >= CAPTURE_FMT__BAYER_RGGB8 && (fmt) <= CAPTURE_FMT__BAYER_BGGR8)
+/** Column of red samples (0 or 1) in each 2x2 block of given raw Bayer format. */
+#define	CAPTURE_BAYER_RED_X(fmt)	(((fmt) - CAPTURE_FMT__BAYER_RGGB8) & 1)
+/** Line of red samples (0 or 1) in each 2x2 block of given raw Bayer format. */
+#define	CAPTURE_BAYER_RED_Y(fmt)	(((fmt) - CAPTURE_FMT__BAYER_RGGB8) >> 1)
+
 /** Capture data format. */
 typedef struct {
 	capture_data_format_e fmt;	/**< Data format. */
 	unsigned width;				/**< Width of captured frame. */
 	unsigned height;			/**< Height of captured frame. */
-	unsigned bytesperline;		/**< Bytes per line. Meaningful in @ref CAPTURE_FMT__YUV422_PACKED. */
+	unsigned bytesperline;		/**< Bytes per line. Meaningful in @ref CAPTURE_FMT__YUV422_PACKED and Bayer formats. */
+	unsigned interval;			/**< Nominal interval between frames, in microseconds, or 0 if unknown. */
 } capture_data_format_t;
 
 /** Capture interface operations. */
@@ -90,7 +106,7 @@ typedef struct {
 /** Capture interface. */
 struct capture_interface_t {
 	/** Capture interface operations. */
-	capture_interface_ops_t *op;
+	const capture_interface_ops_t *op;
 };
 
 /**
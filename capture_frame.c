@@ -0,0 +1,206 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "capture_frame.h"
+
+/**
+ * @addtogroup capture_frame
+ * @{
+ */
+
+/**************************************/
+
+/** Maximum number of capture buffers of a driver. */
+#define	CAPTURE_POOL_BUFFERS	64
+
+/** Slot of the arena. */
+typedef struct {
+	capture_frame_t frame;	/**< Copy of a frame kept in the slot. */
+	unsigned char *buffer;	/**< Memory of the slot, kept for the next copies. */
+	size_t capacity;		/**< Size of @c buffer. */
+	int busy;				/**< Whether @c frame is in use. */
+} capture_slot_t;
+
+/** Pool of captured frames. */
+struct capture_pool_t {
+	capture_interface_t *cap;							/**< Capture interface the frames come from. */
+	unsigned deadline;									/**< How long frames may be kept in capture buffers, in microseconds. */
+	capture_frame_t frame[CAPTURE_POOL_BUFFERS];		/**< Frames in capture buffers, by buffer index. */
+	pthread_mutex_t lock;								/**< Protects @c busy of slots. */
+	unsigned slots;										/**< Number of arena slots. */
+	capture_slot_t *slot;								/**< Arena slots (@c slots entries). */
+	unsigned long copies;								/**< Number of frames copied to the arena. */
+	unsigned long misses;								/**< Number of frames kept in capture buffers with the arena full. */
+};
+
+/**************************************/
+
+/**
+ * Copies a frame to a free arena slot.
+ *
+ * @param pool Pool of captured frames.
+ * @param frame Frame in a capture buffer.
+ * @return Copy of the frame with one reference, or NULL if the arena is full.
+ */
+static capture_frame_t *capture_pool_copy(capture_pool_t *pool, capture_frame_t *frame)
+{
+	capture_slot_t *slot = NULL;
+	unsigned i;
+
+	pthread_mutex_lock(&pool->lock);
+	for (i = 0; i < pool->slots; i++) {
+		if (!pool->slot[i].busy) {
+			slot = pool->slot + i;
+			slot->busy = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	if (!slot)
+		return NULL;
+
+	if (slot->capacity < frame->size) {
+		/* slots keep their memory, so frames of similar size don't allocate any more */
+		unsigned char *buffer = (unsigned char *) realloc(slot->buffer, frame->size);
+
+		if (!buffer) {
+			pthread_mutex_lock(&pool->lock);
+			slot->busy = 0;
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		slot->buffer = buffer;
+		slot->capacity = frame->size;
+	}
+	memcpy(slot->buffer, frame->data, frame->size);
+	slot->frame.refs = 1;
+	slot->frame.data = slot->buffer;
+	slot->frame.size = frame->size;
+	slot->frame.time = frame->time;
+	slot->frame.format = frame->format;
+	slot->frame.pool = pool;
+	slot->frame.index = -1;
+	slot->frame.copy = NULL;
+	pool->copies++;
+	return &slot->frame;
+}
+
+/**************************************/
+
+capture_pool_t *capture_pool_create(capture_interface_t *cap, unsigned slots, unsigned deadline)
+{
+	capture_pool_t *rv = (capture_pool_t *) calloc(1, sizeof(capture_pool_t));
+
+	if (!rv)
+		return NULL;
+	rv->slot = (capture_slot_t *) calloc(slots, sizeof(capture_slot_t));
+	if (slots && !rv->slot) {
+		free(rv);
+		return NULL;
+	}
+	rv->cap = cap;
+	rv->slots = slots;
+	rv->deadline = deadline;
+	pthread_mutex_init(&rv->lock, NULL);
+	return rv;
+}
+
+capture_frame_t *capture_pool_capture(capture_pool_t *pool)
+{
+	capture_frame_t *frame;
+	unsigned char *data;
+	size_t size;
+	int index = pool->cap->op->Capture(pool->cap, &data, &size);
+
+	if (index < 0)
+		return NULL;
+	if (index >= CAPTURE_POOL_BUFFERS) {
+		fprintf(stderr, "Capture buffer %d out of range\n", index);
+		pool->cap->op->ReleaseBuffer(pool->cap, index);
+		return NULL;
+	}
+	frame = pool->frame + index;
+	frame->refs = 1;
+	frame->data = data;
+	frame->size = size;
+	clock_gettime(CLOCK_MONOTONIC, &frame->time);
+	frame->format = pool->cap->op->GetFormat(pool->cap);
+	frame->pool = pool;
+	frame->index = index;
+	frame->copy = NULL;
+	return frame;
+}
+
+capture_frame_t *capture_frame_hold(capture_frame_t *frame, unsigned usec)
+{
+	capture_pool_t *pool = frame->pool;
+
+	if (frame->index < 0 || usec <= pool->deadline)
+		return capture_frame_ref(frame);
+	if (!frame->copy) {
+		frame->copy = capture_pool_copy(pool, frame);
+		if (!frame->copy) {
+			if (!pool->misses++)
+				fprintf(stderr, "Arena of %u captured frames is full, readers keep capture buffers\n", pool->slots);
+			return capture_frame_ref(frame);
+		}
+	}
+	return capture_frame_ref(frame->copy);
+}
+
+void capture_frame_release(capture_frame_t *frame)
+{
+	capture_pool_t *pool = frame->pool;
+
+	if (__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (frame->index >= 0) {
+		capture_frame_t *copy = frame->copy;
+
+		/* the frame may be captured again right after that */
+		pool->cap->op->ReleaseBuffer(pool->cap, frame->index);
+		if (copy)
+			capture_frame_release(copy);
+	} else {
+		pthread_mutex_lock(&pool->lock);
+		((capture_slot_t *) frame)->busy = 0;
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+void capture_pool_destroy(capture_pool_t *pool)
+{
+	unsigned i;
+
+	if (pool->misses)
+		fprintf(stderr, "Arena of captured frames was full for %lu readers (%lu frames copied)\n", pool->misses, pool->copies);
+	for (i = 0; i < pool->slots; i++)
+		free(pool->slot[i].buffer);
+	free(pool->slot);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+/**
+ * @}
+ */
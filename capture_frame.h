@@ -0,0 +1,122 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	CAPTURE_FRAME_H
+#define	CAPTURE_FRAME_H
+
+/**
+ * @addtogroup capture
+ * @{
+ * @defgroup capture_frame Captured frames
+ * @{
+ * Reference-counted captured frames, whose capture buffers are given back
+ * to the driver as soon as their last reader is done
+ */
+
+#include <stddef.h>
+#include <time.h>
+#include "capture.h"
+
+/** Pool of captured frames. */
+typedef struct capture_pool_t capture_pool_t;
+
+/** Captured frame shared by its readers. */
+typedef struct capture_frame_t capture_frame_t;
+
+/** Captured frame shared by its readers. */
+struct capture_frame_t {
+	unsigned refs;								/**< Number of references; the frame goes back to its pool when it drops to 0. */
+	const unsigned char *data;					/**< Frame data. */
+	size_t size;								/**< Size of frame data. */
+	struct timespec time;						/**< When the frame was captured (CLOCK_MONOTONIC). */
+	const capture_data_format_t *format;		/**< Format of the frame. */
+	capture_pool_t *pool;						/**< Pool the frame belongs to. */
+	int index;									/**< Index of capture buffer holding the data, or -1 for a copy in the arena. */
+	capture_frame_t *copy;						/**< Copy in the arena made for readers keeping the frame long, or NULL. */
+};
+
+/**
+ * Creates a pool of captured frames.
+ *
+ * @param cap Capture interface the frames come from; it must outlive the pool.
+ * @param slots Number of frames which can be copied to the arena at once.
+ * @param deadline How long readers may keep a frame in its capture buffer,
+ *                 in microseconds; those keeping it longer get a copy.
+ * @return An instance of a pool of captured frames, or NULL on error.
+ */
+capture_pool_t *capture_pool_create(capture_interface_t *cap, unsigned slots, unsigned deadline);
+
+/**
+ * Captures a frame.
+ *
+ * @param pool Pool of captured frames.
+ * @return The frame with one reference, or NULL on error.
+ */
+capture_frame_t *capture_pool_capture(capture_pool_t *pool);
+
+/**
+ * Takes another reference to a frame, for a reader done with it before
+ * the deadline given to @ref capture_pool_create.
+ *
+ * @param frame Captured frame.
+ * @return @c frame.
+ */
+static inline capture_frame_t *capture_frame_ref(capture_frame_t *frame)
+{
+	__atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+	return frame;
+}
+
+/**
+ * Takes a reference to a frame for a reader which may keep it for given time.
+ *
+ * If that's past the deadline given to @ref capture_pool_create, the reader
+ * gets a copy of the frame in the arena, made once for all such readers,
+ * so the capture buffer goes back to the driver as soon as short-lived
+ * readers are done. If the arena is full, the reader gets the frame itself.
+ * Must be called from the thread which captured the frame.
+ *
+ * @param frame Captured frame.
+ * @param usec How long the reader may keep the frame, in microseconds.
+ * @return A new reference to @c frame or its copy.
+ */
+capture_frame_t *capture_frame_hold(capture_frame_t *frame, unsigned usec);
+
+/**
+ * Releases a reference to a frame. Can be called from any thread.
+ * The last reference gives the capture buffer back to the driver,
+ * or the arena slot back to the pool.
+ *
+ * @param frame Captured frame.
+ */
+void capture_frame_release(capture_frame_t *frame);
+
+/**
+ * Destroys a pool of captured frames. All its frames must be released before.
+ *
+ * @param pool Pool of captured frames.
+ */
+void capture_pool_destroy(capture_pool_t *pool);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -60,6 +60,22 @@ static const capture_data_format_t* capture_v4l2_streaming_GetFormat(capture_int
 	return &thiz->format;
 }
 
+/** @copydoc capture_interface_ops_t::ReleaseBuffer */
+static void capture_v4l2_streaming_ReleaseBuffer(capture_interface_t *base, int index)
+{
+	capture_v4l2_streaming_t *thiz = (capture_v4l2_streaming_t *) base;
+	struct v4l2_buffer buffer;
+
+	memset(&buffer, 0, sizeof(buffer));
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	buffer.index = index;
+
+	if (ioctl(thiz->fd, VIDIOC_QBUF, &buffer)) {
+		fprintf(stderr, "VIDIOC_QBUF[%d]: %s\n", index, strerror(errno));
+	}
+}
+
 /** @copydoc capture_interface_ops_t::Capture */
 static int capture_v4l2_streaming_Capture(capture_interface_t *base, unsigned char **buffer, size_t *size)
 {
@@ -70,9 +86,15 @@ static int capture_v4l2_streaming_Capture(capture_interface_t *base, unsigned ch
 	v4l2buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	v4l2buf.memory = V4L2_MEMORY_MMAP;
 
-	if (ioctl(thiz->fd, VIDIOC_DQBUF, &v4l2buf)) {
-		fprintf(stderr, "VIDIOC_DQBUF: %s\n", strerror(errno));
-		return -1;
+	for (;;) {
+		if (ioctl(thiz->fd, VIDIOC_DQBUF, &v4l2buf)) {
+			fprintf(stderr, "VIDIOC_DQBUF: %s\n", strerror(errno));
+			return -1;
+		}
+		if (!(v4l2buf.flags & V4L2_BUF_FLAG_ERROR) && v4l2buf.bytesused)
+			break;
+		/* frame data are corrupt, give the buffer back & wait for the next one */
+		capture_v4l2_streaming_ReleaseBuffer(base, v4l2buf.index);
 	}
 
 	*buffer = thiz->buffers[v4l2buf.index].start;
@@ -80,22 +102,6 @@ static int capture_v4l2_streaming_Capture(capture_interface_t *base, unsigned ch
 	return v4l2buf.index;
 }
 
-/** @copydoc capture_interface_ops_t::ReleaseBuffer */
-static void capture_v4l2_streaming_ReleaseBuffer(capture_interface_t *base, int index)
-{
-	capture_v4l2_streaming_t *thiz = (capture_v4l2_streaming_t *) base;
-	struct v4l2_buffer buffer;
-
-	memset(&buffer, 0, sizeof(buffer));
-	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	buffer.memory = V4L2_MEMORY_MMAP;
-	buffer.index = index;
-
-	if (ioctl(thiz->fd, VIDIOC_QBUF, &buffer)) {
-		fprintf(stderr, "VIDIOC_QBUF[%d]: %s\n", index, strerror(errno));
-	}
-}
-
 /** @copydoc capture_interface_ops_t::Destroy */
 static void capture_v4l2_streaming_Destroy(capture_interface_t *base)
 {
@@ -118,7 +124,7 @@ static void capture_v4l2_streaming_Destroy(capture_interface_t *base)
 /************************************************/
 
 /** Operations of V4L2 capture. */
-static capture_interface_ops_t capture_v4l2_streaming_ops = {
+static const capture_interface_ops_t capture_v4l2_streaming_ops = {
 	.GetFormat = capture_v4l2_streaming_GetFormat,
 	.Capture = capture_v4l2_streaming_Capture,
 	.ReleaseBuffer = capture_v4l2_streaming_ReleaseBuffer,
@@ -136,9 +142,10 @@ static capture_interface_ops_t capture_v4l2_streaming_ops = {
  * @param reqbuf_count Number of frame buffers allocated by V4L2 layer.
  * @param sizeimage Maximum size of a frame, as determined by @c VIDIOC_G_FMT.
  * @param bytesperline Bytes per each line of the frame, including padding, if any.
+ * @param interval Interval between frames, in microseconds, or 0 if unknown.
  * @return An instance of V4L2 capture, or NULL on error.
  */
-static capture_v4l2_streaming_t *capture_new_v4l2(const char *path, int fd, capture_data_format_e format, unsigned width, unsigned height, unsigned reqbuf_count, unsigned sizeimage, unsigned bytesperline)
+static capture_v4l2_streaming_t *capture_new_v4l2(const char *path, int fd, capture_data_format_e format, unsigned width, unsigned height, unsigned reqbuf_count, unsigned sizeimage, unsigned bytesperline, unsigned interval)
 {
     capture_v4l2_streaming_t *rv = (capture_v4l2_streaming_t *) calloc(1, sizeof(capture_v4l2_streaming_t) + reqbuf_count * sizeof(capture_buffer_t));
     int j;
@@ -150,6 +157,7 @@ static capture_v4l2_streaming_t *capture_new_v4l2(const char *path, int fd, capt
 	rv->format.width = width;
 	rv->format.height = height;
 	rv->format.bytesperline = bytesperline;
+	rv->format.interval = interval;
 	rv->buffers_cnt = reqbuf_count;
 	rv->buffers = (capture_buffer_t *) (rv + 1);
 	/* query & mmap buffers allocated by V4L2 layer, fill buffers array */
@@ -226,12 +234,18 @@ static capture_v4l2_streaming_t *capture_init_v4l2_dev(int verbose, const char *
 			{ V4L2_PIX_FMT_JPEG, CAPTURE_FMT__JPEG },
 			{ V4L2_PIX_FMT_MJPEG, CAPTURE_FMT__MJPEG },
 			{ V4L2_PIX_FMT_YUYV, CAPTURE_FMT__YUV422_PACKED },
+			{ V4L2_PIX_FMT_SRGGB8, CAPTURE_FMT__BAYER_RGGB8 },
+			{ V4L2_PIX_FMT_SGRBG8, CAPTURE_FMT__BAYER_GRBG8 },
+			{ V4L2_PIX_FMT_SGBRG8, CAPTURE_FMT__BAYER_GBRG8 },
+			{ V4L2_PIX_FMT_SBGGR8, CAPTURE_FMT__BAYER_BGGR8 },
 		};
 		unsigned i, ok = 0;
 		struct v4l2_capability cap;
 		struct v4l2_format format;
 		struct v4l2_requestbuffers reqbuf;
+		struct v4l2_streamparm stream;
 		capture_data_format_e selected;
+		unsigned interval = 0;
 
 		if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == -1) {
 			fprintf(stderr, "%s: VIDIOC_QUERYCAP: %s\n", path, strerror(errno));
@@ -297,26 +311,31 @@ static capture_v4l2_streaming_t *capture_init_v4l2_dev(int verbose, const char *
 				format.fmt.pix.width, format.fmt.pix.height,
 				(const char *) &format.fmt.pix.pixelformat,
 				format.fmt.pix.sizeimage, format.fmt.pix.bytesperline);
-		if (user_fr) {
-			struct v4l2_streamparm stream;
-
-			memset(&stream, 0, sizeof(stream));
-			stream.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			if (!ioctl(fd, VIDIOC_G_PARM, &stream) && (stream.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+		memset(&stream, 0, sizeof(stream));
+		stream.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if (ioctl(fd, VIDIOC_G_PARM, &stream)) {
+			if (user_fr)
+				fprintf(stderr, "%s: VIDIOC_G_PARM: %s\n", path, strerror(errno));
+		} else if (user_fr) {
+			if (stream.parm.capture.capability & V4L2_CAP_TIMEPERFRAME) {
 				stream.parm.capture.timeperframe.numerator = 1;
 				stream.parm.capture.timeperframe.denominator = user_fr;
 				if (ioctl(fd, VIDIOC_S_PARM, &stream) == -1) {
 					fprintf(stderr, "%s: VIDIOC_S_PARM: %s\n", path, strerror(errno));
 				}
-				if (verbose && ioctl(fd, VIDIOC_G_PARM, &stream) == 0) {
-					fprintf(stderr, "%s: %u/%u s frame duration\n", path,
-						stream.parm.capture.timeperframe.numerator,
-						stream.parm.capture.timeperframe.denominator);
-				}
+				ioctl(fd, VIDIOC_G_PARM, &stream);
 			} else {
-				fprintf(stderr, "%s: VIDIOC_G_PARM: %s\n", path, strerror(errno));
+				fprintf(stderr, "%s: frame rate cannot be set\n", path);
 			}
 		}
+		if (stream.parm.capture.timeperframe.denominator) {
+			interval = (unsigned long long) stream.parm.capture.timeperframe.numerator * 1000000
+				/ stream.parm.capture.timeperframe.denominator;
+			if (verbose)
+				fprintf(stderr, "%s: %u/%u s frame duration\n", path,
+					stream.parm.capture.timeperframe.numerator,
+					stream.parm.capture.timeperframe.denominator);
+		}
 
 		memset(&reqbuf, 0, sizeof(reqbuf));
 		reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -333,7 +352,7 @@ static capture_v4l2_streaming_t *capture_init_v4l2_dev(int verbose, const char *
 		if (reqbuf.count < 2) {
 			break;
 		}
-		return capture_new_v4l2(path, fd, selected, format.fmt.pix.width, format.fmt.pix.height, reqbuf.count, format.fmt.pix.sizeimage, format.fmt.pix.bytesperline);
+		return capture_new_v4l2(path, fd, selected, format.fmt.pix.width, format.fmt.pix.height, reqbuf.count, format.fmt.pix.sizeimage, format.fmt.pix.bytesperline, interval);
 	} while (0);
 
 	close(fd);
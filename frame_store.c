@@ -0,0 +1,151 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "frame_store.h"
+
+/**
+ * @addtogroup frame_store
+ * @{
+ */
+
+/**************************************/
+
+/** Maximum number of chunks of a frame read at once. */
+#define	FRAME_STORE_CHUNKS	8
+
+/** Store of the latest frame. */
+struct frame_store_t {
+	pthread_mutex_t lock;		/**< Protects @c latest. */
+	shared_frame_t *latest;		/**< The latest frame, or NULL. */
+	unsigned long seq;			/**< Sequence number of the latest frame. */
+	size_t capacity;			/**< Size allocated for frames of unknown size, adjusted to recent frames. */
+};
+
+/**************************************/
+
+shared_frame_t *shared_frame_create(video_frame_filter_t *filter, size_t *capacity_hint)
+{
+	size_t size = filter->op->GetSize(filter), capacity;
+	shared_frame_t *frame;
+	struct iovec iov[FRAME_STORE_CHUNKS];
+	unsigned n;
+
+	if (!size)
+		return NULL;
+	/* frames compressed while being read have to grow */
+	capacity = size != VFF_SIZE_UNKNOWN ? size : capacity_hint && *capacity_hint ? *capacity_hint : 65536;
+	frame = (shared_frame_t *) malloc(sizeof(shared_frame_t) + capacity);
+	if (!frame)
+		return NULL;
+	frame->size = 0;
+	while ((n = vff_get_chunks(filter, iov, FRAME_STORE_CHUNKS)) > 0) {
+		unsigned i;
+
+		for (i = 0; i < n; i++) {
+			if (frame->size + iov[i].iov_len > capacity) {
+				shared_frame_t *bigger;
+
+				capacity = (frame->size + iov[i].iov_len) * 3 / 2;
+				bigger = (shared_frame_t *) realloc(frame, sizeof(shared_frame_t) + capacity);
+				if (!bigger) {
+					free(frame);
+					return NULL;
+				}
+				frame = bigger;
+			}
+			memcpy(frame->data + frame->size, iov[i].iov_base, iov[i].iov_len);
+			frame->size += iov[i].iov_len;
+		}
+	}
+	if (!frame->size) {
+		free(frame);
+		return NULL;
+	}
+	if (size == VFF_SIZE_UNKNOWN && capacity_hint)
+		*capacity_hint = frame->size + frame->size / 4;
+	frame->refs = 1;
+	frame->seq = 0;
+	return frame;
+}
+
+void shared_frame_release(shared_frame_t *frame)
+{
+	if (!__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL))
+		free(frame);
+}
+
+frame_store_t *frame_store_create(void)
+{
+	frame_store_t *rv = (frame_store_t *) calloc(1, sizeof(frame_store_t));
+
+	if (rv)
+		pthread_mutex_init(&rv->lock, NULL);
+	return rv;
+}
+
+int frame_store_put(frame_store_t *store, video_frame_filter_t *filter)
+{
+	shared_frame_t *frame = shared_frame_create(filter, &store->capacity);
+
+	if (!frame)
+		return -1;
+	frame_store_publish(store, frame);
+	return 0;
+}
+
+void frame_store_publish(frame_store_t *store, shared_frame_t *frame)
+{
+	shared_frame_t *old;
+
+	pthread_mutex_lock(&store->lock);
+	frame->seq = ++store->seq;
+	old = store->latest;
+	store->latest = frame;
+	pthread_mutex_unlock(&store->lock);
+
+	if (old)
+		shared_frame_release(old);
+}
+
+shared_frame_t *frame_store_get(frame_store_t *store)
+{
+	shared_frame_t *rv;
+
+	pthread_mutex_lock(&store->lock);
+	rv = store->latest;
+	if (rv)
+		shared_frame_ref(rv);
+	pthread_mutex_unlock(&store->lock);
+	return rv;
+}
+
+void frame_store_destroy(frame_store_t *store)
+{
+	if (store->latest)
+		shared_frame_release(store->latest);
+	pthread_mutex_destroy(&store->lock);
+	free(store);
+}
+
+/**
+ * @}
+ */
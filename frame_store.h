@@ -0,0 +1,121 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	FRAME_STORE_H
+#define	FRAME_STORE_H
+
+/**
+ * @defgroup frame_store Frame store
+ * @{
+ * Keeps the latest filtered frame as a reference-counted copy, so that
+ * other threads can send it while next frames are being processed
+ */
+
+#include "vff.h"
+
+/** Reference-counted copy of a filtered frame. It's immutable once published. */
+typedef struct {
+	unsigned refs;			/**< Number of references; the frame is freed when it drops to 0. */
+	unsigned long seq;		/**< Sequence number of the frame in the store it's published in, starting from 1. */
+	size_t size;			/**< Size of frame data. */
+	unsigned char data[];	/**< Frame data. */
+} shared_frame_t;
+
+/** Store of the latest frame. */
+typedef struct frame_store_t frame_store_t;
+
+/**
+ * Reads a frame from a filter into a new shared frame.
+ *
+ * @param filter Video frame filter whose output is ready to be read.
+ * @param capacity Size to allocate if the filter doesn't know the size
+ *                 of its output, or 0 for a default; it's updated to suit
+ *                 the next frames. May be NULL.
+ * @return A new shared frame with one reference, or NULL on error
+ *         (including an empty frame).
+ */
+shared_frame_t *shared_frame_create(video_frame_filter_t *filter, size_t *capacity);
+
+/**
+ * Takes another reference to a shared frame.
+ *
+ * @param frame Frame.
+ * @return @c frame.
+ */
+static inline shared_frame_t *shared_frame_ref(shared_frame_t *frame)
+{
+	__atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+	return frame;
+}
+
+/**
+ * Releases a reference to a frame. Can be called from any thread.
+ *
+ * @param frame Frame.
+ */
+void shared_frame_release(shared_frame_t *frame);
+
+/**
+ * Creates an empty frame store.
+ *
+ * @return An instance of frame store, or NULL on error.
+ */
+frame_store_t *frame_store_create(void);
+
+/**
+ * Reads a frame from a filter into a new shared frame and makes it
+ * the latest one in the store.
+ *
+ * @param store Frame store.
+ * @param filter Video frame filter whose output is ready to be read.
+ * @return 0 on success, -1 on error (nothing is stored then).
+ */
+int frame_store_put(frame_store_t *store, video_frame_filter_t *filter);
+
+/**
+ * Makes a shared frame the latest one in the store, and numbers it.
+ * A frame can be published in one store only.
+ *
+ * @param store Frame store.
+ * @param frame Frame; the store takes over the caller's reference.
+ */
+void frame_store_publish(frame_store_t *store, shared_frame_t *frame);
+
+/**
+ * Gets a reference to the latest frame in the store.
+ * It must be released with @ref shared_frame_release.
+ *
+ * @param store Frame store.
+ * @return The latest frame, or NULL if there's none yet.
+ */
+shared_frame_t *frame_store_get(frame_store_t *store);
+
+/**
+ * Destroys a frame store. Frames still referenced outside live on
+ * until they're released.
+ *
+ * @param store Frame store.
+ */
+void frame_store_destroy(frame_store_t *store);
+
+/**
+ * @}
+ */
+
+#endif
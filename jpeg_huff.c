@@ -0,0 +1,796 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include "jpeg_huff.h"
+#include "vff_mjpeg2jpeg.h"
+
+/**
+ * @addtogroup jpeg_huff
+ * @{
+ */
+
+/**************************************/
+
+/** Number of bits decoded at once using lookup tables. */
+#define	HUFF_LOOKAHEAD		9
+/** Relative change of frame size (in percent) which is taken as a change of the scene. */
+#define	HUFF_SCENE_CHANGE	25
+
+/** Huffman decoding table. */
+typedef struct {
+	unsigned char look_len[1 << HUFF_LOOKAHEAD];	/**< Length of a code starting with given bits, or 0 if it's longer than @ref HUFF_LOOKAHEAD. */
+	unsigned char look_sym[1 << HUFF_LOOKAHEAD];	/**< Symbol of a code starting with given bits. */
+	unsigned char look_skip[1 << HUFF_LOOKAHEAD];	/**< Length of a code starting with given bits together with the value bits of its (AC) symbol, or 0 if it's longer than @ref HUFF_LOOKAHEAD. */
+	long maxcode[17];								/**< Largest code of each length, or -1 if there are no codes of that length. */
+	long valoffset[17];								/**< Offset of a code of each length into @c huffval. */
+	unsigned char huffval[256];						/**< Symbols in order of increasing code length. */
+	int defined;									/**< Whether the table has been defined. */
+} jpeg_huff_decoder_t;
+
+/** Reader of entropy-coded data. */
+typedef struct {
+	const unsigned char *p;		/**< Next byte to be read. */
+	const unsigned char *end;	/**< End of data. */
+	uint64_t buf;				/**< Bits read ahead, MSB first. */
+	int bits;					/**< Number of bits in @c buf. */
+	unsigned fake;				/**< Number of zero bytes put into @c buf past the data. */
+	int marker;					/**< Whether a marker has been reached. */
+} jpeg_huff_reader_t;
+
+/** Frame being walked. */
+typedef struct {
+	jpeg_huff_decoder_t dc[JPEG_HUFF_TABLES];	/**< DC decoding tables. */
+	jpeg_huff_decoder_t ac[JPEG_HUFF_TABLES];	/**< AC decoding tables. */
+	unsigned width;								/**< Width of the image, in pixels. */
+	unsigned height;							/**< Height of the image, in pixels. */
+	unsigned components;						/**< Number of components in the frame. */
+	/** Components of the frame. */
+	struct {
+		unsigned id;	/**< Component identifier. */
+		unsigned h;		/**< Horizontal sampling factor. */
+		unsigned v;		/**< Vertical sampling factor. */
+		unsigned tq;	/**< Quantization table slot. */
+	} comp[4];
+	unsigned q0[4];								/**< DC quantizer of each quantization table slot. */
+	unsigned hmax;								/**< Maximum horizontal sampling factor. */
+	unsigned vmax;								/**< Maximum vertical sampling factor. */
+	unsigned restart;							/**< Restart interval, in MCUs, or 0. */
+	unsigned scan_components;					/**< Number of components in the first scan. */
+	/** Components of the first scan. */
+	struct {
+		unsigned c;		/**< Index into @c comp. */
+		unsigned td;	/**< DC table slot. */
+		unsigned ta;	/**< AC table slot. */
+	} scan[4];
+} jpeg_huff_frame_t;
+
+/**************************************/
+
+/**
+ * Builds a decoding table.
+ *
+ * @param dec Decoding table to build.
+ * @param bits Number of codes of length 1 to 16.
+ * @param vals Symbols.
+ * @return 0 on success, -1 if the table is invalid.
+ */
+static int jpeg_huff_build(jpeg_huff_decoder_t *dec, const unsigned char *bits, const unsigned char *vals)
+{
+	long code = 0;
+	unsigned l, i, j, k = 0;
+
+	memset(dec->look_len, 0, sizeof(dec->look_len));
+	memset(dec->look_skip, 0, sizeof(dec->look_skip));
+	for (l = 1; l <= 16; l++) {
+		dec->valoffset[l] = (long) k - code;
+		for (i = 0; i < bits[l - 1]; i++, code++, k++) {
+			/* codes have to fit in l bits (and the all-ones one is reserved) before they index the lookahead tables */
+			if (code >= (1L << l) - 1)
+				return -1;
+			if (l <= HUFF_LOOKAHEAD) {
+				unsigned shift = HUFF_LOOKAHEAD - l;
+
+				unsigned skip = l + (vals[k] & 0x0F);
+
+				for (j = 0; j < 1U << shift; j++) {
+					dec->look_len[(code << shift) | j] = l;
+					dec->look_sym[(code << shift) | j] = vals[k];
+					if (skip <= HUFF_LOOKAHEAD)
+						dec->look_skip[(code << shift) | j] = skip;
+				}
+			}
+		}
+		dec->maxcode[l] = bits[l - 1] ? code - 1 : -1;
+		code <<= 1;
+	}
+	memcpy(dec->huffval, vals, k);
+	dec->defined = 1;
+	return 0;
+}
+
+/**
+ * Parses contents of DHT marker segment.
+ *
+ * @param f Frame being walked.
+ * @param p Contents of the segment (past its length).
+ * @param length Length of the contents.
+ * @return 0 on success, -1 if the segment is invalid.
+ */
+static int jpeg_huff_parse_dht(jpeg_huff_frame_t *f, const unsigned char *p, size_t length)
+{
+	while (length) {
+		unsigned tc, th, i, count = 0;
+
+		if (length < 17)
+			return -1;
+		tc = p[0] >> 4;
+		th = p[0] & 0x0F;
+		for (i = 1; i <= 16; i++)
+			count += p[i];
+		if (tc > 1 || th >= JPEG_HUFF_TABLES || count > 256 || length < 17 + count)
+			return -1;
+		if (jpeg_huff_build(tc ? &f->ac[th] : &f->dc[th], p + 1, p + 17))
+			return -1;
+		p += 17 + count;
+		length -= 17 + count;
+	}
+	return 0;
+}
+
+/**
+ * Parses DQT marker segment; only DC quantizers are kept.
+ *
+ * @param f Frame being walked.
+ * @param p Contents of the segment.
+ * @param length Length of the contents.
+ * @return 0 on success, -1 if the segment is corrupt.
+ */
+static int jpeg_huff_parse_dqt(jpeg_huff_frame_t *f, const unsigned char *p, size_t length)
+{
+	while (length) {
+		unsigned pq = p[0] >> 4, tq = p[0] & 0x0F;
+		size_t n = pq ? 129 : 65;
+
+		if (pq > 1 || tq > 3 || length < n)
+			return -1;
+		f->q0[tq] = pq ? (p[1] << 8) | p[2] : p[1];
+		p += n;
+		length -= n;
+	}
+	return 0;
+}
+
+/**
+ * Parses markers of a frame up to the first SOS.
+ *
+ * @param f Frame being walked.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @return Offset of entropy-coded data, or 0 if the frame is corrupt or not supported.
+ */
+static size_t jpeg_huff_parse_header(jpeg_huff_frame_t *f, const unsigned char *frame, size_t size)
+{
+	const unsigned char *dht = video_frame_filter_mjpeg_missing_chunk;
+	size_t pos;
+	unsigned i, j;
+
+	/* defaults for MJPEG */
+	if (jpeg_huff_parse_dht(f, dht + 4, ((dht[2] << 8) | dht[3]) - 2))
+		return 0;
+	if (size < 4 || frame[0] != 0xFF || frame[1] != 0xD8)
+		return 0;
+	for (pos = 2; ; ) {
+		const unsigned char *p;
+		unsigned marker, length;
+
+		if (pos + 2 > size || frame[pos] != 0xFF)
+			return 0;
+		marker = frame[pos + 1];
+		if (marker == 0xFF) {
+			pos++;	/* fill byte */
+			continue;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			pos += 2;	/* standalone marker */
+			continue;
+		}
+		if (pos + 4 > size)
+			return 0;
+		length = (frame[pos + 2] << 8) | frame[pos + 3];
+		if (length < 2 || pos + 2 + length > size)
+			return 0;
+		p = frame + pos + 4;
+		length -= 2;
+		pos += 4 + length;
+		switch (marker) {
+			case 0xC0:	/* SOF0 */
+			case 0xC1:	/* SOF1 */
+				if (length < 6 || p[0] != 8)
+					return 0;
+				f->height = (p[1] << 8) | p[2];
+				f->width = (p[3] << 8) | p[4];
+				f->components = p[5];
+				if (!f->width || !f->height || !f->components || f->components > 4 || length < 6 + 3 * f->components)
+					return 0;
+				for (i = 0; i < f->components; i++) {
+					f->comp[i].id = p[6 + 3 * i];
+					f->comp[i].h = p[7 + 3 * i] >> 4;
+					f->comp[i].v = p[7 + 3 * i] & 0x0F;
+					f->comp[i].tq = p[8 + 3 * i] & 0x03;
+					if (!f->comp[i].h || !f->comp[i].v || f->comp[i].h > 4 || f->comp[i].v > 4)
+						return 0;
+					if (f->hmax < f->comp[i].h)
+						f->hmax = f->comp[i].h;
+					if (f->vmax < f->comp[i].v)
+						f->vmax = f->comp[i].v;
+				}
+				break;
+			case 0xC4:	/* DHT */
+				if (jpeg_huff_parse_dht(f, p, length))
+					return 0;
+				break;
+			case 0xDB:	/* DQT */
+				if (jpeg_huff_parse_dqt(f, p, length))
+					return 0;
+				break;
+			case 0xC8:	/* JPG */
+			case 0xCC:	/* DAC */
+				break;
+			case 0xD8:	/* SOI */
+			case 0xD9:	/* EOI */
+				return 0;
+			case 0xDD:	/* DRI */
+				if (length < 2)
+					return 0;
+				f->restart = (p[0] << 8) | p[1];
+				break;
+			case 0xDA:	/* SOS */
+				if (!f->components || length < 1)
+					return 0;
+				f->scan_components = p[0];
+				if (!f->scan_components || f->scan_components > 4 || length < 1 + 2 * f->scan_components)
+					return 0;
+				for (i = 0; i < f->scan_components; i++) {
+					for (j = 0; j < f->components && f->comp[j].id != p[1 + 2 * i]; j++)
+						;
+					if (j >= f->components)
+						return 0;
+					f->scan[i].c = j;
+					f->scan[i].td = p[2 + 2 * i] >> 4;
+					f->scan[i].ta = p[2 + 2 * i] & 0x0F;
+					if (f->scan[i].td >= JPEG_HUFF_TABLES || f->scan[i].ta >= JPEG_HUFF_TABLES
+						|| !f->dc[f->scan[i].td].defined || !f->ac[f->scan[i].ta].defined)
+						return 0;
+				}
+				return pos;
+			default:
+				/* other SOFn (progressive, arithmetic, ...) are not supported */
+				if (marker >= 0xC0 && marker <= 0xCF)
+					return 0;
+				break;
+		}
+	}
+}
+
+/**
+ * Fills bit buffer of a reader, removing stuffed bytes.
+ * Once a marker or end of data is reached, zeros are put instead.
+ *
+ * @param r Reader of entropy-coded data.
+ */
+static void jpeg_huff_fill(jpeg_huff_reader_t *r)
+{
+	if (r->bits > 56)
+		return;
+	if (!r->marker && r->end - r->p >= 8) {
+		/* fast path: next 8 bytes contain no 0xFF, so they can be taken at once */
+		uint64_t w = 0;
+		unsigned i, n;
+
+		for (i = 0; i < 8; i++)
+			w = (w << 8) | r->p[i];
+		if (!((~w - 0x0101010101010101ULL) & w & 0x8080808080808080ULL)) {
+			n = (64 - r->bits) >> 3;
+			r->buf |= (w >> (64 - 8 * n)) << (64 - r->bits - 8 * n);
+			r->p += n;
+			r->bits += 8 * n;
+			return;
+		}
+	}
+	while (r->bits <= 56) {
+		unsigned c = 0;
+
+		if (r->marker || r->p >= r->end) {
+			r->fake++;
+		} else if (*r->p != 0xFF) {
+			c = *r->p++;
+		} else if (r->p + 1 < r->end && !r->p[1]) {
+			c = 0xFF;
+			r->p += 2;
+		} else {
+			r->marker = 1;
+			r->fake++;
+		}
+		r->buf |= (uint64_t) c << (56 - r->bits);
+		r->bits += 8;
+	}
+}
+
+/**
+ * Checks whether a reader hasn't gone past the data.
+ *
+ * @param r Reader of entropy-coded data.
+ * @return Non-zero if all bits read so far are genuine.
+ */
+static int jpeg_huff_genuine(const jpeg_huff_reader_t *r)
+{
+	return (int) r->fake * 8 <= r->bits;
+}
+
+/**
+ * Skips bits of a reader.
+ *
+ * @param r Reader of entropy-coded data.
+ * @param n Number of bits to skip (not more than available in the buffer).
+ */
+static void jpeg_huff_skip(jpeg_huff_reader_t *r, unsigned n)
+{
+	r->buf <<= n;
+	r->bits -= n;
+}
+
+/**
+ * Decodes a Huffman-coded symbol. At least 16 bits must be buffered.
+ *
+ * @param r Reader of entropy-coded data.
+ * @param dec Decoding table.
+ * @return Decoded symbol, or -1 if the code is invalid.
+ */
+static int jpeg_huff_decode(jpeg_huff_reader_t *r, const jpeg_huff_decoder_t *dec)
+{
+	unsigned idx = (unsigned) (r->buf >> (64 - HUFF_LOOKAHEAD));
+	unsigned l = dec->look_len[idx];
+	long code, k;
+
+	if (l) {
+		jpeg_huff_skip(r, l);
+		return dec->look_sym[idx];
+	}
+	for (l = HUFF_LOOKAHEAD + 1; l <= 16; l++) {
+		code = (long) (r->buf >> (64 - l));
+		if (code <= dec->maxcode[l]) {
+			k = code + dec->valoffset[l];
+			if (k < 0 || k > 255)
+				return -1;
+			jpeg_huff_skip(r, l);
+			return dec->huffval[k];
+		}
+	}
+	return -1;
+}
+
+/**
+ * Resynchronizes a reader at a restart marker.
+ *
+ * @param r Reader of entropy-coded data.
+ * @return 0 on success, -1 if there's no restart marker.
+ */
+static int jpeg_huff_restart(jpeg_huff_reader_t *r)
+{
+	if (!jpeg_huff_genuine(r))
+		return -1;
+	while (r->p + 1 < r->end && r->p[0] == 0xFF && r->p[1] == 0xFF)
+		r->p++;
+	if (r->p + 1 >= r->end || r->p[0] != 0xFF || (r->p[1] & 0xF8) != 0xD0)
+		return -1;
+	r->p += 2;
+	r->buf = 0;
+	r->bits = 0;
+	r->fake = 0;
+	r->marker = 0;
+	return 0;
+}
+
+/**
+ * Counts symbols of a single block. Values of AC coefficients are skipped
+ * without being decoded.
+ *
+ * @param r Reader of entropy-coded data.
+ * @param dc DC decoding table.
+ * @param ac AC decoding table.
+ * @param dc_stats Statistics of symbols of the DC table.
+ * @param ac_stats Statistics of symbols of the AC table.
+ * @param dc_diff Receives difference of DC coefficient from the previous block's one.
+ * @return 0 on success, -1 if the block is corrupt.
+ */
+static int jpeg_huff_block(jpeg_huff_reader_t *r, const jpeg_huff_decoder_t *dc, const jpeg_huff_decoder_t *ac,
+	unsigned long *dc_stats, unsigned long *ac_stats, int *dc_diff)
+{
+	int s, k;
+
+	jpeg_huff_fill(r);
+	s = jpeg_huff_decode(r, dc);
+	if (s < 0 || s > 11)
+		return -1;
+	dc_stats[s]++;
+	*dc_diff = 0;
+	if (s) {
+		*dc_diff = (int) (r->buf >> (64 - s));
+		if (*dc_diff < 1 << (s - 1))
+			*dc_diff -= (1 << s) - 1;
+		jpeg_huff_skip(r, s);
+	}
+	for (k = 1; k < 64; k++) {
+		unsigned idx, skip;
+
+		if (r->bits < 32)
+			jpeg_huff_fill(r);
+		/* fast path: short code and its value bits at once */
+		idx = (unsigned) (r->buf >> (64 - HUFF_LOOKAHEAD));
+		skip = ac->look_skip[idx];
+		if (skip) {
+			s = ac->look_sym[idx];
+			ac_stats[s]++;
+			jpeg_huff_skip(r, skip);
+			if (s & 0x0F) {
+				k += s >> 4;
+				if (k > 63)
+					return -1;
+			} else if (s == 0xF0)
+				k += 15;
+			else
+				break;	/* EOB */
+			continue;
+		}
+		s = jpeg_huff_decode(r, ac);
+		if (s < 0)
+			return -1;
+		ac_stats[s]++;
+		if (s & 0x0F) {
+			k += s >> 4;
+			if (k > 63)
+				return -1;
+			jpeg_huff_skip(r, s & 0x0F);
+		} else if (s == 0xF0) {
+			k += 15;
+		} else {
+			break;	/* EOB */
+		}
+	}
+	return 0;
+}
+
+/**
+ * Lays out a DC image for a frame.
+ *
+ * @param image DC image.
+ * @param f Frame being walked.
+ * @param mcus_per_row Number of MCUs in each row.
+ * @param mcu_rows Number of rows of MCUs.
+ * @return 0 on success, -1 if the first scan doesn't cover all components or memory is exhausted.
+ */
+static int jpeg_huff_dc_image_setup(jpeg_huff_dc_image_t *image, const jpeg_huff_frame_t *f, unsigned mcus_per_row, unsigned mcu_rows)
+{
+	size_t total = 0;
+	unsigned c;
+
+	if (f->scan_components != f->components)
+		return -1;
+	image->width = (f->width + 7) / 8;
+	image->height = (f->height + 7) / 8;
+	image->components = f->components;
+	for (c = 0; c < f->components; c++) {
+		unsigned h = f->components == 1 ? 1 : f->comp[c].h;
+		unsigned v = f->components == 1 ? 1 : f->comp[c].v;
+
+		image->comp[c].h = f->comp[c].h;
+		image->comp[c].v = f->comp[c].v;
+		image->comp[c].width = ((f->width * f->comp[c].h + f->hmax - 1) / f->hmax + 7) / 8;
+		image->comp[c].height = ((f->height * f->comp[c].v + f->vmax - 1) / f->vmax + 7) / 8;
+		image->comp[c].stride = mcus_per_row * h;
+		image->comp[c].offset = total;
+		total += (size_t) image->comp[c].stride * mcu_rows * v;
+	}
+	if (total > image->allocated) {
+		unsigned char *samples = realloc(image->samples, total);
+
+		if (!samples)
+			return -1;
+		image->samples = samples;
+		image->allocated = total;
+	}
+	return 0;
+}
+
+/**
+ * Stores a sample of a DC image.
+ *
+ * @param image DC image.
+ * @param c Component index.
+ * @param x Column of the block.
+ * @param y Row of the block.
+ * @param dc Dequantized DC coefficient of the block.
+ */
+static void jpeg_huff_dc_image_put(jpeg_huff_dc_image_t *image, unsigned c, unsigned x, unsigned y, int dc)
+{
+	/* DC is 8 times the mean of a level-shifted block */
+	int level = 128 + (dc >= 0 ? (dc + 4) / 8 : -((4 - dc) / 8));
+
+	image->samples[image->comp[c].offset + (size_t) y * image->comp[c].stride + x] = level < 0 ? 0 : level > 255 ? 255 : level;
+}
+
+/**
+ * Walks entropy-coded data of the first scan of a frame, block by block.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param stats Statistics the counts of symbols are added to.
+ * @param image Receives DC image of the frame, or NULL if it's not needed.
+ * @return 0 on success, -1 if the frame is corrupt or not supported.
+ */
+static int jpeg_huff_walk(const unsigned char *frame, size_t size, jpeg_huff_stats_t *stats, jpeg_huff_dc_image_t *image)
+{
+	jpeg_huff_frame_t f;
+	jpeg_huff_reader_t r;
+	unsigned long mcus, m;
+	unsigned mcus_per_row, mcu_x = 0, mcu_y = 0, to_restart, i, x, y;
+	int pred[4] = { 0, 0, 0, 0 };
+
+	memset(&f, 0, sizeof(f));
+	memset(&r, 0, sizeof(r));
+	r.p = frame + jpeg_huff_parse_header(&f, frame, size);
+	if (r.p == frame)
+		return -1;
+	r.end = frame + size;
+
+	if (f.scan_components == 1) {
+		/* non-interleaved: one block per MCU */
+		unsigned c = f.scan[0].c;
+		unsigned long w = ((unsigned long) f.width * f.comp[c].h + f.hmax - 1) / f.hmax;
+		unsigned long h = ((unsigned long) f.height * f.comp[c].v + f.vmax - 1) / f.vmax;
+
+		mcus_per_row = (w + 7) / 8;
+		mcus = mcus_per_row * ((h + 7) / 8);
+	} else {
+		mcus_per_row = (f.width + 8 * f.hmax - 1) / (8 * f.hmax);
+		mcus = (unsigned long) mcus_per_row * ((f.height + 8 * f.vmax - 1) / (8 * f.vmax));
+	}
+	if (image && jpeg_huff_dc_image_setup(image, &f, mcus_per_row, mcus / mcus_per_row))
+		return -1;
+	to_restart = f.restart;
+	for (m = 0; m < mcus; m++) {
+		if (f.restart && !to_restart--) {
+			if (jpeg_huff_restart(&r))
+				return -1;
+			memset(pred, 0, sizeof(pred));
+			to_restart = f.restart - 1;
+		}
+		for (i = 0; i < f.scan_components; i++) {
+			unsigned c = f.scan[i].c, td = f.scan[i].td, ta = f.scan[i].ta;
+			unsigned h = f.scan_components == 1 ? 1 : f.comp[c].h;
+			unsigned v = f.scan_components == 1 ? 1 : f.comp[c].v;
+
+			for (y = 0; y < v; y++)
+				for (x = 0; x < h; x++) {
+					int diff;
+
+					if (jpeg_huff_block(&r, &f.dc[td], &f.ac[ta], stats->dc[td], stats->ac[ta], &diff))
+						return -1;
+					pred[i] += diff;
+					if (image)
+						jpeg_huff_dc_image_put(image, c, mcu_x * h + x, mcu_y * v + y, pred[i] * (int) f.q0[f.comp[c].tq]);
+				}
+		}
+		if (++mcu_x == mcus_per_row) {
+			mcu_x = 0;
+			mcu_y++;
+		}
+	}
+	return jpeg_huff_genuine(&r) ? 0 : -1;
+}
+
+int jpeg_huff_gather(const unsigned char *frame, size_t size, jpeg_huff_stats_t *stats)
+{
+	return jpeg_huff_walk(frame, size, stats, NULL);
+}
+
+int jpeg_huff_dc_image(const unsigned char *frame, size_t size, jpeg_huff_dc_image_t *image)
+{
+	jpeg_huff_stats_t stats;
+
+	memset(&stats, 0, sizeof(stats));
+	return jpeg_huff_walk(frame, size, &stats, image);
+}
+
+void jpeg_huff_dc_image_free(jpeg_huff_dc_image_t *image)
+{
+	free(image->samples);
+	memset(image, 0, sizeof(*image));
+}
+
+/**************************************/
+
+void jpeg_huff_optimal_table(const unsigned long freq_in[256], jpeg_huff_table_t *table)
+{
+	unsigned long freq[257];
+	int codesize[257], others[257];
+	unsigned bits[258];
+	int i, j, c1, c2, p;
+
+	memcpy(freq, freq_in, 256 * sizeof(*freq));
+	freq[256] = 1;	/* reserved symbol, so no code consists of 1-bits only */
+	memset(codesize, 0, sizeof(codesize));
+	memset(bits, 0, sizeof(bits));
+	for (i = 0; i < 257; i++)
+		others[i] = -1;
+
+	/* build Huffman tree (JPEG spec, Annex K.2) */
+	for (;;) {
+		unsigned long v = ULONG_MAX;
+
+		for (c1 = -1, i = 0; i < 257; i++)
+			if (freq[i] && freq[i] <= v) {
+				v = freq[i];
+				c1 = i;
+			}
+		v = ULONG_MAX;
+		for (c2 = -1, i = 0; i < 257; i++)
+			if (freq[i] && freq[i] <= v && i != c1) {
+				v = freq[i];
+				c2 = i;
+			}
+		if (c2 < 0)
+			break;
+		freq[c1] += freq[c2];
+		freq[c2] = 0;
+		for (codesize[c1]++; others[c1] >= 0; codesize[c1]++)
+			c1 = others[c1];
+		others[c1] = c2;
+		for (codesize[c2]++; others[c2] >= 0; codesize[c2]++)
+			c2 = others[c2];
+	}
+	for (i = 0; i < 257; i++)
+		if (codesize[i])
+			bits[codesize[i]]++;
+
+	/* limit code length to 16 bits (Annex K.3) */
+	for (i = 257; i > 16; i--) {
+		while (bits[i]) {
+			for (j = i - 2; !bits[j]; j--)
+				;
+			bits[i] -= 2;
+			bits[i - 1]++;
+			bits[j + 1] += 2;
+			bits[j]--;
+		}
+	}
+	/* remove the reserved symbol */
+	for (i = 16; i > 0 && !bits[i]; i--)
+		;
+	if (i > 0)
+		bits[i]--;
+
+	table->bits[0] = 0;
+	for (i = 1; i <= 16; i++)
+		table->bits[i] = bits[i];
+	for (p = 0, i = 1; i < 258; i++)
+		for (j = 0; j < 256; j++)
+			if (codesize[j] == i)
+				table->huffval[p++] = j;
+}
+
+/**************************************/
+
+/**
+ * Checks whether a table has been used at all.
+ *
+ * @param counts Number of occurrences of each symbol of the table.
+ * @return Non-zero if any symbol has occurred.
+ */
+static int jpeg_huff_used(const unsigned long counts[256])
+{
+	unsigned s;
+
+	for (s = 0; s < 256; s++)
+		if (counts[s])
+			return 1;
+	return 0;
+}
+
+void jpeg_huff_learner_init(jpeg_huff_learner_t *learner, unsigned interval)
+{
+	memset(learner, 0, sizeof(*learner));
+	learner->interval = interval;
+}
+
+int jpeg_huff_learner_update(jpeg_huff_learner_t *learner, const unsigned char *frame, size_t size)
+{
+	unsigned long freq[256];
+	size_t delta = size > learner->size ? size - learner->size : learner->size - size;
+	int scene_change = delta * 100 > learner->size * HUFF_SCENE_CHANGE;
+	unsigned t, s, r;
+
+	if (++learner->frames < learner->interval && !scene_change)
+		return 0;
+	learner->frames = 0;
+	learner->size = size;
+	for (t = 0; t < JPEG_HUFF_TABLES; t++)
+		for (s = 0; s < 256; s++) {
+			/* forget older statistics gradually, or at once if the scene has changed */
+			learner->stats.dc[t][s] = scene_change ? 0 : learner->stats.dc[t][s] / 2;
+			learner->stats.ac[t][s] = scene_change ? 0 : learner->stats.ac[t][s] / 2;
+		}
+	if (jpeg_huff_gather(frame, size, &learner->stats))
+		return 0;
+
+	for (t = 0; t < JPEG_HUFF_TABLES; t++) {
+		if (jpeg_huff_used(learner->stats.dc[t])) {
+			/* every category gets a code, even if it hasn't occurred */
+			memset(freq, 0, sizeof(freq));
+			for (s = 0; s <= 11; s++)
+				freq[s] = learner->stats.dc[t][s] + 1;
+			jpeg_huff_optimal_table(freq, &learner->dc[t]);
+			learner->valid |= 1 << t;
+		}
+		if (jpeg_huff_used(learner->stats.ac[t])) {
+			/* every run/size combination gets a code, even if it hasn't occurred */
+			memcpy(freq, learner->stats.ac[t], sizeof(freq));
+			freq[0x00]++;
+			freq[0xF0]++;
+			for (r = 0; r < 16; r++)
+				for (s = 1; s <= 10; s++)
+					freq[(r << 4) | s]++;
+			jpeg_huff_optimal_table(freq, &learner->ac[t]);
+			learner->valid |= 0x10 << t;
+		}
+	}
+	return 1;
+}
+
+#ifdef	USE_JPEGLIB
+void jpeg_huff_learner_apply(const jpeg_huff_learner_t *learner, j_compress_ptr cinfo)
+{
+	unsigned t;
+
+	for (t = 0; t < JPEG_HUFF_TABLES; t++) {
+		if (learner->valid & (1 << t)) {
+			if (!cinfo->dc_huff_tbl_ptrs[t])
+				cinfo->dc_huff_tbl_ptrs[t] = jpeg_alloc_huff_table((j_common_ptr) cinfo);
+			memcpy(cinfo->dc_huff_tbl_ptrs[t]->bits, learner->dc[t].bits, sizeof(learner->dc[t].bits));
+			memcpy(cinfo->dc_huff_tbl_ptrs[t]->huffval, learner->dc[t].huffval, sizeof(learner->dc[t].huffval));
+			cinfo->dc_huff_tbl_ptrs[t]->sent_table = FALSE;
+		}
+		if (learner->valid & (0x10 << t)) {
+			if (!cinfo->ac_huff_tbl_ptrs[t])
+				cinfo->ac_huff_tbl_ptrs[t] = jpeg_alloc_huff_table((j_common_ptr) cinfo);
+			memcpy(cinfo->ac_huff_tbl_ptrs[t]->bits, learner->ac[t].bits, sizeof(learner->ac[t].bits));
+			memcpy(cinfo->ac_huff_tbl_ptrs[t]->huffval, learner->ac[t].huffval, sizeof(learner->ac[t].huffval));
+			cinfo->ac_huff_tbl_ptrs[t]->sent_table = FALSE;
+		}
+	}
+}
+#endif
+
+/**
+ * @}
+ */
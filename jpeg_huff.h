@@ -0,0 +1,162 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	JPEG_HUFF_H
+#define	JPEG_HUFF_H
+
+/**
+ * @defgroup jpeg_huff Huffman table learning
+ * @{
+ * Gathers statistics of Huffman-coded symbols of JPEG frames and derives
+ * optimal Huffman tables out of them; extracts DC images of JPEG frames
+ */
+
+#include <stddef.h>
+#ifdef	USE_JPEGLIB
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+
+/** Number of Huffman table slots of each class (DC and AC). */
+#define	JPEG_HUFF_TABLES	4
+
+/** Huffman table in the form used by DHT marker segment. */
+typedef struct {
+	unsigned char bits[17];		/**< bits[k] is the number of codes of length k (bits[0] is unused). */
+	unsigned char huffval[256];	/**< Symbols in order of increasing code length. */
+} jpeg_huff_table_t;
+
+/** Statistics of Huffman-coded symbols. */
+typedef struct {
+	unsigned long dc[JPEG_HUFF_TABLES][256];	/**< Number of occurrences of each symbol coded with each DC table. */
+	unsigned long ac[JPEG_HUFF_TABLES][256];	/**< Number of occurrences of each symbol coded with each AC table. */
+} jpeg_huff_stats_t;
+
+/** Image made of DC coefficients of a JPEG frame, i.e. the frame scaled down to 1/8. */
+typedef struct {
+	unsigned width;			/**< Width of the image, in samples of the component of highest resolution. */
+	unsigned height;		/**< Height of the image, in samples of the component of highest resolution. */
+	unsigned components;	/**< Number of components. */
+	/** Components of the image. */
+	struct {
+		unsigned width;		/**< Width of the component, in samples. */
+		unsigned height;	/**< Height of the component, in samples. */
+		unsigned h;			/**< Horizontal sampling factor. */
+		unsigned v;			/**< Vertical sampling factor. */
+		unsigned stride;	/**< Distance between rows of samples. */
+		size_t offset;		/**< Offset of the first sample in @c samples. */
+	} comp[4];
+	unsigned char *samples;	/**< Samples of all components. */
+	size_t allocated;		/**< Size of @c samples. */
+} jpeg_huff_dc_image_t;
+
+/** Learner of Huffman tables, refreshing them from time to time. */
+typedef struct {
+	unsigned interval;						/**< Number of frames after which tables are refreshed. */
+	unsigned frames;						/**< Number of frames since the last refresh. */
+	size_t size;							/**< Size of the frame which tables have been refreshed from. */
+	unsigned valid;							/**< Bit mask of learned tables: DC in bits 0-3, AC in bits 4-7. */
+	jpeg_huff_stats_t stats;				/**< Accumulated statistics. */
+	jpeg_huff_table_t dc[JPEG_HUFF_TABLES];	/**< Learned DC tables. */
+	jpeg_huff_table_t ac[JPEG_HUFF_TABLES];	/**< Learned AC tables. */
+} jpeg_huff_learner_t;
+
+/**
+ * Counts Huffman-coded symbols in the first scan of a baseline JPEG frame.
+ *
+ * Frames without Huffman tables (MJPEG) are walked with the default ones.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param stats Statistics the counts are added to.
+ * @return 0 on success, -1 if the frame is corrupt or not supported
+ *         (@c stats may be partially updated then).
+ */
+int jpeg_huff_gather(const unsigned char *frame, size_t size, jpeg_huff_stats_t *stats);
+
+/**
+ * Extracts DC image of a baseline JPEG frame.
+ *
+ * Only DC coefficients are decoded; AC symbols are skipped over without
+ * decoding their values, and there is no IDCT. Each sample is the mean of
+ * a block of the frame. The first scan must contain all components.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param image DC image, zeroed before the first use; its buffer is reused by subsequent calls.
+ * @return 0 on success, -1 if the frame is corrupt or not supported.
+ */
+int jpeg_huff_dc_image(const unsigned char *frame, size_t size, jpeg_huff_dc_image_t *image);
+
+/**
+ * Frees memory held by a DC image.
+ *
+ * @param image DC image.
+ */
+void jpeg_huff_dc_image_free(jpeg_huff_dc_image_t *image);
+
+/**
+ * Generates optimal Huffman table for given frequencies of symbols
+ * (codes are limited to 16 bits, as JPEG requires).
+ *
+ * @param freq Frequency of each symbol; symbols with frequency 0 get no code.
+ * @param table Receives the table.
+ */
+void jpeg_huff_optimal_table(const unsigned long freq[256], jpeg_huff_table_t *table);
+
+/**
+ * Initializes a learner of Huffman tables.
+ *
+ * @param learner Learner to initialize.
+ * @param interval Number of frames after which tables are refreshed.
+ */
+void jpeg_huff_learner_init(jpeg_huff_learner_t *learner, unsigned interval);
+
+/**
+ * Feeds a learner with a compressed frame.
+ *
+ * Every @c interval frames, or when frame size changes by more than 25%
+ * (a change of the scene), symbols of the frame are counted and tables are
+ * regenerated. Older statistics are halved each time. Every symbol
+ * allowed in a table gets a code, so learned tables can encode any frame.
+ *
+ * @param learner Learner of Huffman tables.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @return Non-zero if tables have been refreshed.
+ */
+int jpeg_huff_learner_update(jpeg_huff_learner_t *learner, const unsigned char *frame, size_t size);
+
+#ifdef	USE_JPEGLIB
+/**
+ * Installs learned tables into a compressor. Tables which haven't been
+ * learned yet are left alone. Must be called before @c jpeg_start_compress
+ * or @c jpeg_write_coefficients.
+ *
+ * @param learner Learner of Huffman tables.
+ * @param cinfo Compressor instance.
+ */
+void jpeg_huff_learner_apply(const jpeg_huff_learner_t *learner, j_compress_ptr cinfo);
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "jpeg_markers.h"
+
+/**
+ * @addtogroup jpeg_markers
+ * @{
+ */
+
+/**************************************/
+
+/** Marker codes (second byte of a marker). */
+enum {
+	MARKER_DHT = 0xC4,	/**< Define Huffman tables. */
+	MARKER_RST0 = 0xD0,	/**< Restart marker 0. */
+	MARKER_RST7 = 0xD7,	/**< Restart marker 7. */
+	MARKER_SOI = 0xD8,	/**< Start of image. */
+	MARKER_EOI = 0xD9,	/**< End of image. */
+	MARKER_SOS = 0xDA,	/**< Start of scan. */
+	MARKER_TEM = 0x01,	/**< Temporary (standalone). */
+};
+
+/**
+ * Skips a marker segment.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param pos Offset of the marker.
+ * @return Offset past the marker segment, or 0 if it doesn't fit in the frame.
+ */
+static size_t jpeg_markers_skip_segment(const unsigned char *frame, size_t size, size_t pos)
+{
+	unsigned length;
+
+	if (pos + 4 > size)
+		return 0;
+	length = (frame[pos + 2] << 8) | frame[pos + 3];
+	if (length < 2 || pos + 2 + length > size)
+		return 0;
+	return pos + 2 + length;
+}
+
+/**
+ * Looks for EOI marker in entropy-coded data.
+ *
+ * Searching for 0xFF bytes is done by @c memchr, which is vectorized by any decent C library.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param pos Offset where entropy-coded data begin.
+ * @return Offset past EOI marker, or 0 if not found.
+ */
+static size_t jpeg_markers_find_eoi(const unsigned char *frame, size_t size, size_t pos)
+{
+	while (pos + 1 < size) {
+		const unsigned char *ff = memchr(frame + pos, 0xFF, size - 1 - pos);
+		unsigned char marker;
+
+		if (!ff)
+			break;
+		pos = ff - frame;
+		marker = frame[pos + 1];
+		if (marker == MARKER_EOI)
+			return pos + 2;
+		if (marker == 0x00 || marker == 0xFF || (marker >= MARKER_RST0 && marker <= MARKER_RST7)) {
+			/* stuffed byte, fill byte or restart marker */
+			pos++;
+		} else {
+			/* another segment, e.g. next scan */
+			pos = jpeg_markers_skip_segment(frame, size, pos);
+			if (!pos)
+				break;
+		}
+	}
+	return 0;
+}
+
+int jpeg_markers_scan(const unsigned char *frame, size_t size, jpeg_markers_t *markers)
+{
+	size_t pos, end;
+
+	memset(markers, 0, sizeof(*markers));
+	if (size < 4 || frame[0] != 0xFF || frame[1] != MARKER_SOI)
+		return -1;
+
+	/* walk header segments up to SOS */
+	for (pos = 2; ; ) {
+		unsigned char marker;
+
+		if (pos + 2 > size || frame[pos] != 0xFF)
+			return -1;
+		marker = frame[pos + 1];
+		if (marker == 0xFF) {
+			pos++;	/* fill byte */
+			continue;
+		}
+		if (marker == MARKER_TEM || (marker >= MARKER_RST0 && marker <= MARKER_RST7)) {
+			pos += 2;	/* standalone marker */
+			continue;
+		}
+		if (marker == MARKER_SOI || marker == MARKER_EOI)
+			return -1;
+		if (marker == MARKER_DHT)
+			markers->has_dht = 1;
+		if (marker == MARKER_SOS)
+			markers->sos = pos;
+		pos = jpeg_markers_skip_segment(frame, size, pos);
+		if (!pos)
+			return -1;
+		if (markers->sos)
+			break;
+	}
+
+	/* fast path: EOI at the end, possibly followed by zero padding */
+	for (end = size; end > pos && !frame[end - 1]; end--)
+		;
+	if (end >= pos + 2 && frame[end - 2] == 0xFF && frame[end - 1] == MARKER_EOI) {
+		markers->length = end;
+		return 0;
+	}
+
+	/* slow path: look for EOI in entropy-coded data */
+	markers->length = jpeg_markers_find_eoi(frame, size, pos);
+	return markers->length ? 0 : -1;
+}
+
+/**
+ * @}
+ */
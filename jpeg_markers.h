@@ -0,0 +1,56 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	JPEG_MARKERS_H
+#define	JPEG_MARKERS_H
+
+/**
+ * @defgroup jpeg_markers JPEG marker scanner
+ * @{
+ * Finds essential markers of a (M)JPEG frame without decoding it
+ */
+
+#include <stddef.h>
+
+/** Essential markers found in a (M)JPEG frame. */
+typedef struct {
+	size_t sos;		/**< Offset of the first SOS marker. */
+	size_t length;	/**< Length of the frame up to and including EOI marker. */
+	int has_dht;	/**< Whether the frame defines Huffman tables (DHT marker) before SOS. */
+} jpeg_markers_t;
+
+/**
+ * Scans a (M)JPEG frame for SOI, DHT, SOS and EOI markers.
+ *
+ * Header segments are walked by their lengths. Then EOI is looked for at
+ * the end of data, past any zero padding; only if it's not there,
+ * entropy-coded data are scanned for it.
+ *
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @param markers Receives markers found in the frame.
+ * @return 0 if the frame is complete, -1 if it's corrupt or truncated.
+ */
+int jpeg_markers_scan(const unsigned char *frame, size_t size, jpeg_markers_t *markers);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2023, 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include <jerror.h>
+#include "jpeg_mgr.h"
+#include "vff_mjpeg2jpeg.h"
+
+/**
+ * @addtogroup jpeg_mgr
+ * @{
+ */
+
+/**************************************/
+
+/**
+ * Starts collecting compressed frame.
+ *
+ * @param cinfo Memory manager used by jpeglib.
+ */
+static void jpeg_destination_init(j_compress_ptr cinfo)
+{
+	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
+
+	if (!jdst->result)
+		jdst->result = malloc(jdst->size);
+	jdst->base.next_output_byte = jdst->result;
+	jdst->base.free_in_buffer = jdst->size;
+}
+
+/**
+ * Extends space for compressed frame.
+ *
+ * @param cinfo Memory manager used by jpeglib.
+ * @return true on success, false on memory allocation error.
+ */
+static boolean jpeg_destination_empty_output_buffer(j_compress_ptr cinfo)
+{
+	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
+	size_t new_size = jdst->size * 2;	/* double the size of our buffer */
+
+	jdst->result = realloc(jdst->result, new_size);
+	jdst->base.next_output_byte = jdst->result + jdst->size;
+	jdst->base.free_in_buffer = new_size - jdst->size;
+	jdst->size = new_size;
+	return !!jdst->result;
+}
+
+/**
+ * Terminates compression of a frame into JPEG.
+ *
+ * Takes current length as final size of a compressed frame.
+ *
+ * @param cinfo Memory manager used by jpeglib.
+ */
+static void jpeg_destination_term(j_compress_ptr cinfo)
+{
+	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
+
+	jdst->length = jdst->size - jdst->base.free_in_buffer;
+}
+
+struct jpeg_destination_mgr *jpeg_destination_mgr_mem_create(jpeg_destination_mgr_mem_t *jdst)
+{
+	jdst->result = NULL;
+	jdst->size = 4096;	/* start with 4 KB */
+	jdst->base.init_destination = jpeg_destination_init;
+	jdst->base.empty_output_buffer = jpeg_destination_empty_output_buffer;
+	jdst->base.term_destination = jpeg_destination_term;
+	return &jdst->base;
+}
+
+void jpeg_destination_mgr_mem_destroy(jpeg_destination_mgr_mem_t *jdst)
+{
+	free(jdst->result);
+	jdst->result = NULL;
+}
+
+/**************************************/
+
+/**
+ * Starts decompressing a frame. Nothing to do, data are set by @ref jpeg_source_mgr_mem_set.
+ *
+ * @param dinfo Source manager used by jpeglib.
+ */
+static void jpeg_source_init(j_decompress_ptr dinfo)
+{
+	(void) dinfo;
+}
+
+/**
+ * Called when jpeglib runs out of data, what means that the frame is truncated.
+ *
+ * Provides fake EOI marker, so the decompressor finishes the frame gracefully.
+ *
+ * @param dinfo Source manager used by jpeglib.
+ * @return Always true.
+ */
+static boolean jpeg_source_fill_input_buffer(j_decompress_ptr dinfo)
+{
+	static const JOCTET eoi[] = { 0xFF, JPEG_EOI };
+
+	WARNMS(dinfo, JWRN_JPEG_EOF);
+	dinfo->src->next_input_byte = eoi;
+	dinfo->src->bytes_in_buffer = sizeof(eoi);
+	return TRUE;
+}
+
+/**
+ * Skips uninteresting data (e.g. APPn markers).
+ *
+ * @param dinfo Source manager used by jpeglib.
+ * @param num_bytes Number of bytes to skip.
+ */
+static void jpeg_source_skip_input_data(j_decompress_ptr dinfo, long num_bytes)
+{
+	struct jpeg_source_mgr *jsrc = dinfo->src;
+
+	if (num_bytes <= 0)
+		return;
+	if ((size_t) num_bytes > jsrc->bytes_in_buffer) {
+		jpeg_source_fill_input_buffer(dinfo);
+	} else {
+		jsrc->next_input_byte += num_bytes;
+		jsrc->bytes_in_buffer -= num_bytes;
+	}
+}
+
+/**
+ * Terminates decompression of a frame. Nothing to do.
+ *
+ * @param dinfo Source manager used by jpeglib.
+ */
+static void jpeg_source_term(j_decompress_ptr dinfo)
+{
+	(void) dinfo;
+}
+
+struct jpeg_source_mgr *jpeg_source_mgr_mem_create(struct jpeg_source_mgr *jsrc)
+{
+	jsrc->next_input_byte = NULL;
+	jsrc->bytes_in_buffer = 0;
+	jsrc->init_source = jpeg_source_init;
+	jsrc->fill_input_buffer = jpeg_source_fill_input_buffer;
+	jsrc->skip_input_data = jpeg_source_skip_input_data;
+	jsrc->resync_to_restart = jpeg_resync_to_restart;
+	jsrc->term_source = jpeg_source_term;
+	return jsrc;
+}
+
+void jpeg_source_mgr_mem_set(struct jpeg_source_mgr *jsrc, const unsigned char *data, size_t size)
+{
+	jsrc->next_input_byte = data;
+	jsrc->bytes_in_buffer = size;
+}
+
+/**************************************/
+
+/**
+ * Reports fatal error and jumps back to the caller.
+ *
+ * @param cinfo jpeglib's compressor or decompressor instance.
+ */
+static void jpeg_error_exit_jmp(j_common_ptr cinfo)
+{
+	jpeg_error_mgr_jmp_t *jerr = (jpeg_error_mgr_jmp_t *) cinfo->err;
+
+	(*cinfo->err->output_message)(cinfo);
+	longjmp(jerr->jmp, 1);
+}
+
+/**
+ * Reports warnings, turning premature end of data into a fatal error.
+ *
+ * jpeglib would otherwise pad a truncated frame with gray and carry on.
+ *
+ * @param cinfo jpeglib's compressor or decompressor instance.
+ * @param msg_level Message level (-1 for warnings).
+ */
+static void jpeg_emit_message_jmp(j_common_ptr cinfo, int msg_level)
+{
+	jpeg_error_mgr_jmp_t *jerr = (jpeg_error_mgr_jmp_t *) cinfo->err;
+
+	if (msg_level < 0 && (cinfo->err->msg_code == JWRN_HIT_MARKER || cinfo->err->msg_code == JWRN_JPEG_EOF))
+		(*cinfo->err->error_exit)(cinfo);
+	jerr->emit_message(cinfo, msg_level);
+}
+
+struct jpeg_error_mgr *jpeg_error_mgr_jmp_create(jpeg_error_mgr_jmp_t *jerr)
+{
+	jpeg_std_error(&jerr->base);
+	jerr->base.error_exit = jpeg_error_exit_jmp;
+	jerr->emit_message = jerr->base.emit_message;
+	jerr->base.emit_message = jpeg_emit_message_jmp;
+	return &jerr->base;
+}
+
+/**************************************/
+
+void jpeg_mgr_default_huff_tables(j_decompress_ptr dinfo)
+{
+	const unsigned char *dht = video_frame_filter_mjpeg_missing_chunk;
+	const unsigned char *end = dht + 2 + ((dht[2] << 8) | dht[3]);
+	const unsigned char *p;
+
+	for (p = dht + 4; p < end; ) {
+		JHUFF_TBL **tbl = (*p & 0x10) ? &dinfo->ac_huff_tbl_ptrs[*p & 0x0F] : &dinfo->dc_huff_tbl_ptrs[*p & 0x0F];
+		unsigned i, count;
+
+		p++;
+		for (i = count = 0; i < 16; i++)
+			count += p[i];
+		if (!*tbl) {
+			*tbl = jpeg_alloc_huff_table((j_common_ptr) dinfo);
+			(*tbl)->bits[0] = 0;
+			memcpy((*tbl)->bits + 1, p, 16);
+			memcpy((*tbl)->huffval, p + 16, count);
+		}
+		p += 16 + count;
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,104 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2023, 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	JPEG_MGR_H
+#define	JPEG_MGR_H
+
+/**
+ * @defgroup jpeg_mgr jpeglib helpers
+ * @{
+ * Memory source & destination and error managers shared by filters using jpeglib
+ */
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+/** Custom destination memory manager for capturing compressed JPEG from jpeglib. */
+typedef struct {
+	struct jpeg_destination_mgr base;	/**< Base JPEG destination structure. */
+	unsigned char *result;				/**< Result buffer. */
+	size_t length;						/**< Length of compressed data in @c result buffer. */
+	size_t size;						/**< Total amount of space available in @c result buffer (or to be allocated if @c result is NULL). */
+} jpeg_destination_mgr_mem_t;
+
+/** Error manager which jumps back to the caller instead of exiting the program. */
+typedef struct {
+	struct jpeg_error_mgr base;	/**< Base JPEG error manager structure. */
+	jmp_buf jmp;				/**< Where to jump on fatal error, set by the user with @c setjmp. */
+	void (*emit_message)(j_common_ptr cinfo, int msg_level);	/**< jpeglib's default message handler. */
+} jpeg_error_mgr_jmp_t;
+
+/**
+ * Creates custom destination memory manager for jpeglib.
+ *
+ * @param jdst Pointer to the memory manager structure to be initialized.
+ * @return Pointer to base memory manager structure associated with @c jdst.
+ */
+struct jpeg_destination_mgr *jpeg_destination_mgr_mem_create(jpeg_destination_mgr_mem_t *jdst);
+
+/**
+ * Destroys custom destination memory manager for jpeglib.
+ *
+ * @param jdst Pointer to the memory manager structure initialized by @ref jpeg_destination_mgr_mem_create.
+ */
+void jpeg_destination_mgr_mem_destroy(jpeg_destination_mgr_mem_t *jdst);
+
+/**
+ * Creates source memory manager for jpeglib.
+ *
+ * @param jsrc Pointer to the source manager structure to be initialized.
+ * @return @c jsrc
+ */
+struct jpeg_source_mgr *jpeg_source_mgr_mem_create(struct jpeg_source_mgr *jsrc);
+
+/**
+ * Points source memory manager at compressed data to be decompressed next.
+ *
+ * @param jsrc Pointer to the source manager structure initialized by @ref jpeg_source_mgr_mem_create.
+ * @param data Compressed data. Must remain valid until decompression is finished.
+ * @param size Size of compressed data.
+ */
+void jpeg_source_mgr_mem_set(struct jpeg_source_mgr *jsrc, const unsigned char *data, size_t size);
+
+/**
+ * Creates an error manager which longjmp's to @c jerr->jmp on fatal errors.
+ *
+ * Premature end of compressed data is treated as a fatal error too.
+ *
+ * @param jerr Pointer to the error manager structure to be initialized.
+ * @return Pointer to base error manager structure associated with @c jerr.
+ */
+struct jpeg_error_mgr *jpeg_error_mgr_jmp_create(jpeg_error_mgr_jmp_t *jerr);
+
+/**
+ * Supplies default Huffman tables for a MJPEG frame which lacks them.
+ *
+ * Must be called after @c jpeg_read_header. Tables already defined by the frame
+ * (or by a previous frame) are left alone.
+ *
+ * @param dinfo Decompressor instance.
+ */
+void jpeg_mgr_default_huff_tables(j_decompress_ptr dinfo);
+
+/**
+ * @}
+ */
+
+#endif
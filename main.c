@@ -23,25 +23,70 @@
 #include <limits.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 #include "capture.h"
 #include "capture_v4l2.h"
-#include "vff_null.h"
+#include "capture_frame.h"
 #include "vff_mjpeg2jpeg.h"
 #include "vff_yuv2jpeg.h"
+#include "vff_jpegscale.h"
+#include "vff_requant.h"
+#include "vff_decimate.h"
+#include "vff_jpegtran.h"
+#include "vff_mask.h"
+#include "vff_thumb.h"
+#include "vff_chain.h"
+#include "tiers.h"
+#include "motion.h"
+#include "roi.h"
 #include "vfo_stdout.h"
 #include "vfo_files.h"
 #include "vfo_cgi.h"
 #include "vfo_http.h"
+#include "vfo_snapshot.h"
+#include "vfo_tee.h"
+#include "vfo_shm.h"
+#include "vfo_raw.h"
+#include "vff_null.h"
 
 /**
  * @defgroup main Main module
  * @{
  */
 
+/** Maximum number of outputs given by -o. */
+#define	OUTPUTS_MAX	8
+/** Number of captured frames which can be copied at once for outputs keeping them long. */
+#define	ARENA_SLOTS	4
+/** How long outputs may keep a captured frame in its capture buffer if the frame interval is unknown, in microseconds. */
+#define	ARENA_DEADLINE	100000
+/** How long to wait for a frame of the broker before checking whether it's still there, in milliseconds. */
+#define	BROKER_TIMEOUT	500
+
 /** If non-zero, verbose messages are printed on stderr. */
 static int verbose;
 /** If non-zero, main loop keeps iterating. */
 static int run;
+/** Percentage of one CPU core which JPEG compression of all tiers together may take, or 0 for no limit. */
+static unsigned cpu_budget;
+#ifdef	USE_JPEGLIB
+/** Number of frames after which Huffman tables are learned again, or 0 to use the default ones. */
+static unsigned huff_interval;
+/** If non-zero, YUV frames are compressed while being sent. */
+static int stream;
+/** If non-zero, stripes of YUV frames which haven't changed aren't compressed again. */
+static int replenish;
+/** Strength of temporal denoising of YUV frames in percent, or 0 if disabled. */
+static unsigned denoise;
+/** Difference of samples between frames taken as motion and not denoised, or 0. */
+static unsigned denoise_threshold;
+/** Regions of interest, or NULL if all of the frame matters. */
+static roi_t *roi;
+/** Number of DCT coefficients kept in blocks outside regions of interest. */
+static unsigned roi_cutoff;
+/** CPU time budget shared by compression of all tiers, or NULL for no limit. */
+static vff_yuv2jpeg_budget_t *budget;
+#endif
 
 /**
  * Handles a signal to stop the program.
@@ -71,6 +116,391 @@ static void init_signals(void)
 	sigaction(SIGTERM, &act, NULL);
 }
 
+/**
+ * Creates a filter producing JPEG frames out of captured frames.
+ *
+ * @param format Format of captured frames.
+ * @param scale Downscaling factor (1 for original size).
+ * @param quality Desired quality of JPEG images, or UINT_MAX in case of no preference.
+ *                (M)JPEG frames of original size are requantized if it's given.
+ * @param target_size Desired size of requantized (M)JPEG frames in bytes, or 0 if quality should stay fixed.
+ * @param name Receives name of the filter.
+ * @return An instance of a video frame filter, or NULL on error.
+ */
+static video_frame_filter_t *create_filter(const capture_data_format_t *format, unsigned scale, unsigned quality, size_t target_size, const char **name)
+{
+	switch (format->fmt) {
+		case CAPTURE_FMT__JPEG:
+		case CAPTURE_FMT__MJPEG:
+#ifdef	USE_JPEGLIB
+			if (scale == 1 && quality != UINT_MAX) {
+				*name = "requant";
+				return vff_requant_create(quality, target_size, huff_interval, roi, roi_cutoff);
+			}
+			if (scale == 1 && (huff_interval || roi)) {
+				/* quantization tables are left alone, only coefficients outside ROIs and entropy coding are redone */
+				*name = "recode";
+				return vff_requant_create(100, 0, huff_interval, roi, roi_cutoff);
+			}
+#endif
+			if (scale == 1) {
+				*name = "mjpeg2jpeg";
+				return vff_mjpeg2jpeg_create();
+			}
+#ifdef	USE_JPEGLIB
+			if (scale == 8) {
+				/* DC coefficients are just enough */
+				*name = "thumb";
+				return vff_thumb_create(quality);
+			}
+			*name = "jpegscale";
+			return vff_jpegscale_create(scale, quality, huff_interval);
+		case CAPTURE_FMT__BAYER_RGGB8:
+		case CAPTURE_FMT__BAYER_GRBG8:
+		case CAPTURE_FMT__BAYER_GBRG8:
+		case CAPTURE_FMT__BAYER_BGGR8:
+		case CAPTURE_FMT__YUV422_PACKED:
+			*name = CAPTURE_FMT_IS_BAYER(format->fmt) ? "bayer2jpeg" : "yuv2jpeg";
+			return vff_yuv2jpeg_create(format, quality, scale, budget, huff_interval, stream, replenish, denoise, denoise_threshold, verbose ? 100 : 0, roi, roi_cutoff);
+#endif
+		default:
+			break;
+	}
+	(void) quality;
+	(void) target_size;
+	return NULL;
+}
+
+/**
+ * Creates a decimation stage.
+ *
+ * @param format Format of frames entering the stage.
+ * @param arg Every n-th frame to be passed by.
+ * @return An instance of a video frame filter, or NULL on error.
+ */
+static video_frame_filter_t *create_stage_decimate(const capture_data_format_t *format, const char *arg)
+{
+	unsigned n;
+
+	(void) format;
+	if (!arg || sscanf(arg, "%u", &n) != 1)
+		return NULL;
+	return vff_decimate_create(n);
+}
+
+#ifdef	USE_JPEGLIB
+/**
+ * Creates a lossless JPEG transformation stage.
+ *
+ * @param format Format of frames entering the stage; must be (M)JPEG.
+ * @param arg Transformation (none, hflip, vflip, rot90, rot180 or rot270),
+ *            optionally followed by a crop area given as \@WxH+X+Y.
+ * @return An instance of a video frame filter, or NULL on error.
+ */
+static video_frame_filter_t *create_stage_jpegtran(const capture_data_format_t *format, const char *arg)
+{
+	static const char *const ops[] = {
+		[VFF_JPEGTRAN_NONE] = "none",
+		[VFF_JPEGTRAN_FLIP_H] = "hflip",
+		[VFF_JPEGTRAN_FLIP_V] = "vflip",
+		[VFF_JPEGTRAN_ROT_90] = "rot90",
+		[VFF_JPEGTRAN_ROT_180] = "rot180",
+		[VFF_JPEGTRAN_ROT_270] = "rot270",
+	};
+	unsigned x = 0, y = 0, width = 0, height = 0;
+	size_t len;
+	unsigned i;
+
+	if (format->fmt != CAPTURE_FMT__JPEG && format->fmt != CAPTURE_FMT__MJPEG) {
+		fprintf(stderr, "jpegtran requires (M)JPEG frames\n");
+		return NULL;
+	}
+	if (!arg)
+		return NULL;
+	len = strcspn(arg, "@");
+	if (arg[len] && sscanf(arg + len, "@%ux%u+%u+%u", &width, &height, &x, &y) != 4)
+		return NULL;
+	for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+		if (strlen(ops[i]) == len && !strncmp(arg, ops[i], len))
+			return vff_jpegtran_create((vff_jpegtran_op_e) i, x, y, width, height);
+	return NULL;
+}
+
+/**
+ * Creates a privacy mask stage.
+ *
+ * @param format Format of frames entering the stage; must be (M)JPEG.
+ * @param arg Slash-separated list of rectangles, each given as WxH+X+Y.
+ * @return An instance of a video frame filter, or NULL on error.
+ */
+static video_frame_filter_t *create_stage_mask(const capture_data_format_t *format, const char *arg)
+{
+	vff_mask_rect_t rects[VFF_MASK_MAX];
+	unsigned count = 0;
+	int n;
+
+	if (format->fmt != CAPTURE_FMT__JPEG && format->fmt != CAPTURE_FMT__MJPEG) {
+		fprintf(stderr, "mask requires (M)JPEG frames\n");
+		return NULL;
+	}
+	for (; arg && count < VFF_MASK_MAX; arg++) {
+		vff_mask_rect_t *rect = &rects[count++];
+
+		if (sscanf(arg, "%ux%u+%u+%u%n", &rect->width, &rect->height, &rect->x, &rect->y, &n) != 4)
+			return NULL;
+		arg += n;
+		if (*arg != '/')
+			return *arg ? NULL : vff_mask_create(rects, count);
+	}
+	return NULL;
+}
+#endif
+
+#ifdef	USE_JPEGLIB
+/**
+ * Creates regions of interest according to user's specification.
+ *
+ * @param spec Slash-separated list of regions, each given as WxH+X+Y,
+ *             or "motion" for regions where motion is detected.
+ * @param format Format of captured frames.
+ * @return A set of regions of interest, or NULL on error.
+ */
+static roi_t *create_roi(const char *spec, const capture_data_format_t *format)
+{
+	roi_rect_t rects[ROI_MAX];
+	unsigned count = 0;
+	int dynamic = 0, n;
+
+	for (;;) {
+		if (!strncmp(spec, "motion", 6)) {
+			dynamic = 1;
+			spec += 6;
+		} else if (count < ROI_MAX && sscanf(spec, "%ux%u+%u+%u%n", &rects[count].width, &rects[count].height, &rects[count].x, &rects[count].y, &n) == 4) {
+			count++;
+			spec += n;
+		} else {
+			break;
+		}
+		if (*spec != '/') {
+			if (*spec)
+				break;
+			return roi_create(format->width, format->height, rects, count, dynamic);
+		}
+		spec++;
+	}
+	fprintf(stderr, "Regions of interest expected as cutoff:{WxH+X+Y|motion}[/...], but found %s\n", spec);
+	return NULL;
+}
+#endif
+
+/** Stages which can be put in a chain before JPEG compression. */
+static const struct {
+	const char *name;	/**< Name of the stage. */
+	/**
+	 * Creates the stage.
+	 *
+	 * @param format Format of frames entering the stage.
+	 * @param arg Text following '=' after name of the stage, or NULL.
+	 * @return An instance of a video frame filter, or NULL on error.
+	 */
+	video_frame_filter_t *(*create)(const capture_data_format_t *format, const char *arg);
+} stages[] = {
+	{ "decimate", create_stage_decimate },
+#ifdef	USE_JPEGLIB
+	{ "jpegtran", create_stage_jpegtran },
+	{ "mask", create_stage_mask },
+#endif
+};
+
+/**
+ * Appends stages given by user's specification to a chain of filters.
+ *
+ * @param chain Chain of video frame filters.
+ * @param spec Comma-separated list of stages, each given as name[=argument].
+ * @param format Format of captured frames.
+ * @return 0 on success, other value on error.
+ */
+static int create_stages(video_frame_filter_t *chain, const char *spec, const capture_data_format_t *format)
+{
+	char buf[64];
+	const char *p;
+
+	for (p = spec; *p; ) {
+		size_t len = strcspn(p, ",");
+		char *arg;
+		unsigned i;
+
+		if (len >= sizeof(buf))
+			len = sizeof(buf) - 1;
+		memcpy(buf, p, len);
+		buf[len] = '\0';
+		p += strcspn(p, ",");
+		if (*p)
+			p++;
+		arg = strchr(buf, '=');
+		if (arg)
+			*arg++ = '\0';
+		for (i = 0; i < sizeof(stages) / sizeof(stages[0]); i++)
+			if (!strcmp(buf, stages[i].name))
+				break;
+		if (i >= sizeof(stages) / sizeof(stages[0])) {
+			fprintf(stderr, "Unknown filter %s\n", buf);
+			return -1;
+		}
+		if (vff_chain_append(chain, stages[i].name, stages[i].create(format, arg))) {
+			fprintf(stderr, "Could not initialize filter %s\n", buf);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Creates output tiers according to user's specification.
+ *
+ * @param tiers Set of output tiers to fill.
+ * @param spec Comma-separated list of tiers, each given as scale[:quality[:kB]].
+ * @param stages_spec Comma-separated list of stages preceding JPEG compression in each tier (see @ref create_stages).
+ * @param format Format of captured frames.
+ * @param quality Desired quality of JPEG images in tiers which don't specify it, or UINT_MAX in case of no preference.
+ * @return 0 on success, other value on error.
+ */
+static int create_tiers(video_frame_tiers_t *tiers, const char *spec, const char *stages_spec, const capture_data_format_t *format, unsigned quality)
+{
+	const char *p = spec;
+
+	do {
+		video_frame_filter_t *chain, *filter;
+		const char *name = NULL;
+		char chain_name[16];
+		unsigned scale, tier_quality = quality, target_kb = 0;
+		int n;
+
+		if (sscanf(p, "%u%n", &scale, &n) != 1)
+			break;
+		p += n;
+		if (*p == ':') {
+			if (sscanf(++p, "%u%n", &tier_quality, &n) != 1)
+				break;
+			p += n;
+			if (*p == ':') {
+				if (sscanf(++p, "%u%n", &target_kb, &n) != 1)
+					break;
+				p += n;
+			}
+		}
+		if (*p && *p != ',')
+			break;
+
+		snprintf(chain_name, sizeof(chain_name), "Tier %u", video_frame_tiers_count(tiers));
+		chain = vff_chain_create(chain_name, verbose ? 100 : 0);
+		if (!chain)
+			return -1;
+		if (create_stages(chain, stages_spec, format)) {
+			chain->op->Destroy(chain);
+			return -1;
+		}
+		filter = create_filter(format, scale, tier_quality, (size_t) target_kb * 1024, &name);
+		if (vff_chain_append(chain, name, filter)) {
+			chain->op->Destroy(chain);
+			chain = NULL;
+		}
+		if (!chain || video_frame_tiers_add(tiers, chain) < 0) {
+			fprintf(stderr, "Could not initialize data filter for tier 1/%u\n", scale);
+			return -1;
+		}
+		if (verbose)
+			fprintf(stderr, "Tier %u: scale 1/%u, quality %d, target %u kB\n", video_frame_tiers_count(tiers) - 1,
+				scale, tier_quality == UINT_MAX ? -1 : (int) tier_quality, target_kb);
+		if (!*p)
+			return 0;
+	} while (*++p);
+
+	fprintf(stderr, "Tiers expected as scale[:quality[:kB]][,...], but found %s\n", spec);
+	return -1;
+}
+
+/**
+ * Creates an output of given kind.
+ *
+ * @param mode Kind of the output: stdout, files, cgi, http or raw=name[:scale].
+ * @param port TCP port of HTTP output.
+ * @param http_threads Number of threads serving HTTP clients, or 0 for one per CPU.
+ * @param out Set to the new output, or NULL on error.
+ * @return 0 on success (even if the output couldn't be initialized), -1 if the kind is unknown.
+ */
+static int create_output(const char *mode, unsigned short port, unsigned http_threads, video_frame_output_t **out)
+{
+	if (!strcmp(mode, "stdout")) {
+		*out = video_frame_output_stdout_init();
+	} else if (!strcmp(mode, "files")) {
+		*out = video_frame_output_files_init();
+	} else if (!strcmp(mode, "cgi")) {
+		*out = video_frame_output_cgi_init(stdout);
+	} else if (!strcmp(mode, "http")) {
+		*out = video_frame_output_http_init(port, http_threads);
+	} else if (!strncmp(mode, "raw=", 4)) {
+		const char *colon = strchr(mode + 4, ':');
+		unsigned scale = 0;
+		char name[NAME_MAX];
+
+		if (colon && (sscanf(colon + 1, "%u", &scale) != 1 || !scale)) {
+			fprintf(stderr, "Raw output expected as raw=name[:scale], but found %s\n", mode);
+			*out = NULL;
+			return -1;
+		}
+		snprintf(name, sizeof(name), "%.*s", colon ? (int) (colon - mode - 4) : (int) strlen(mode + 4), mode + 4);
+		*out = video_frame_output_raw_init(name, scale);
+	} else {
+		fprintf(stderr, "Unknown output %s\n", mode);
+		*out = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Passes frames published by another instance (the broker) in shared memory
+ * to the output, until this instance becomes the broker itself, e.g. because
+ * the previous one has quit.
+ *
+ * @param ring Ring of frames in shared memory.
+ * @param out Video frame output.
+ * @return 1 if this instance is the broker now, 0 if it's been stopped, -1 on error.
+ */
+static int relay_frames(shm_ring_t *ring, video_frame_output_t *out)
+{
+	video_frame_filter_t *filter = vff_null_create();
+	unsigned char *buffer = NULL;
+	size_t capacity = 0;
+	unsigned frame = 0;
+	int rv = -1;
+
+	while (filter && run) {
+		long size = 0;
+
+		rv = shm_ring_claim(ring);
+		if (rv)
+			break;
+		if (verbose && !frame)
+			fprintf(stderr, "Relaying frames of another instance\n");
+		/* the broker is asked again only when no frames come */
+		while (run && (size = shm_ring_read(ring, &frame, &buffer, &capacity, BROKER_TIMEOUT)) > 0) {
+			filter->op->PutFrame(filter, buffer, size);
+			out->op->PutFrame(out, filter);
+		}
+		if (size < 0) {
+			perror("shm_ring_read");
+			rv = -1;
+			break;
+		}
+	}
+	if (filter)
+		filter->op->Destroy(filter);
+	free(buffer);
+	return run ? rv : 0;
+}
+
 /**
  * Entrypoint and main loop of the program.
  *
@@ -82,22 +512,39 @@ int main(int argc, char **argv)
 {
 	int opt, rv = 0;
 	unsigned width = 0, height = 0, frame_rate = 0;
-#ifdef	USE_JPEGLIB
 	unsigned jpeg_quality = UINT_MAX;
-#endif
 	unsigned short port = 0;
+	unsigned http_threads = 0;
 	size_t max_mem = 8;	/* 8 MB */
 	const char *dev_path = NULL;
-	const char *mode = "cgi";
+	const char *modes[OUTPUTS_MAX];
+	unsigned outputs = 0, i;
+	const char *tiers_spec = "1";
+	const char *broker_name = NULL;
+	unsigned broker_size = 1024;
+	const char *stages_spec = "";
+#ifdef	USE_JPEGLIB
+	const char *roi_spec = NULL;
+#endif
+	char *thumb_path = NULL;
+	unsigned thumb_interval = 5;
+	struct timespec thumb_due = { 0, 0 };
+	unsigned motion_threshold = 0, motion_keepalive = 5;
 	capture_interface_t *cap = NULL;
-	video_frame_filter_t *filter = NULL;
+	capture_pool_t *pool = NULL;
+	shm_ring_t *ring = NULL;
+	motion_detector_t *motion = NULL;
+	video_frame_tiers_t *tiers = NULL;
 	video_frame_output_t *out = NULL;
+	video_frame_filter_t *thumb = NULL;
+	video_frame_output_t *thumb_out = NULL;
 
 	/* initialize signals */
 	init_signals();
+	run = 1;
 
 	/* parse arguments */
-	while (!rv && (opt = getopt(argc, argv, "vd:w:h:r:m:o:p:q:")) != -1) {
+	while (!rv && (opt = getopt(argc, argv, "vd:w:h:r:m:o:p:q:t:f:g:c:u:sRn:i:T:B:")) != -1) {
 		switch (opt) {
 			case 'v':
 				verbose = 1;
@@ -130,8 +577,8 @@ int main(int argc, char **argv)
 				}
 				break;
 			case 'p':
-				if (sscanf(optarg, "%hu", &port) != 1) {
-					fprintf(stderr, "Port expected, but found %s\n", optarg);
+				if (sscanf(optarg, "%hu:%u", &port, &http_threads) < 1) {
+					fprintf(stderr, "Port[:threads] expected, but found %s\n", optarg);
 					rv = 5;
 				}
 				break;
@@ -142,35 +589,126 @@ int main(int argc, char **argv)
 					rv = 5;
 				}
 				break;
+			case 'c':
+				if (sscanf(optarg, "%u", &cpu_budget) != 1 || !cpu_budget) {
+					fprintf(stderr, "CPU budget in percent expected, but found %s\n", optarg);
+					rv = 5;
+				}
+				break;
+			case 's':
+				stream = 1;
+				break;
+			case 'R':
+				replenish = 1;
+				break;
+			case 'i':
+				{
+					int n = 0;
+
+					if (sscanf(optarg, "%u:%n", &roi_cutoff, &n) < 1 || !n || !roi_cutoff || roi_cutoff > 63) {
+						fprintf(stderr, "Cutoff (1-63) and regions of interest expected, but found %s\n", optarg);
+						rv = 5;
+					}
+					roi_spec = optarg + n;
+				}
+				break;
+			case 'n':
+				if (sscanf(optarg, "%u:%u", &denoise, &denoise_threshold) < 1 || !denoise || denoise > 99) {
+					fprintf(stderr, "Denoising strength (1-99)[:motion-threshold] expected, but found %s\n", optarg);
+					rv = 5;
+				}
+				break;
+			case 'u':
+				if (sscanf(optarg, "%u", &huff_interval) != 1) {
+					fprintf(stderr, "Number of frames between updates of Huffman tables expected, but found %s\n", optarg);
+					rv = 5;
+				}
+				break;
 #endif
+			case 't':
+				tiers_spec = optarg;
+				break;
+			case 'f':
+				stages_spec = optarg;
+				break;
+			case 'g':
+				if (sscanf(optarg, "%u:%u", &motion_threshold, &motion_keepalive) < 1 || !motion_threshold) {
+					fprintf(stderr, "Motion threshold[:keepalive-seconds] expected, but found %s\n", optarg);
+					rv = 5;
+				}
+				break;
+			case 'T':
+				thumb_path = optarg;
+				{
+					char *colon = strrchr(optarg, ':');
+
+					if (colon && sscanf(colon + 1, "%u", &thumb_interval) == 1)
+						*colon = '\0';
+				}
+				break;
+			case 'B':
+				broker_name = optarg;
+				{
+					char *colon = strrchr(optarg, ':');
+
+					if (colon && sscanf(colon + 1, "%u", &broker_size) == 1)
+						*colon = '\0';
+				}
+				break;
 			case 'o':
-				mode = optarg;
+				if (outputs >= OUTPUTS_MAX) {
+					fprintf(stderr, "At most %u outputs are supported\n", OUTPUTS_MAX);
+					rv = 7;
+				} else {
+					modes[outputs++] = optarg;
+				}
 				break;
 			default:
-				fprintf(stderr, "Usage: %s [-v] [-w width] [-h height] [-r frame-rate] [-m max-memory-MB] [-o {stdout|files|cgi|http}]\n", argv[0]);
+				fprintf(stderr, "Usage: %s [-v] [-w width] [-h height] [-r frame-rate] [-m max-memory-MB] [-t scale[:quality[:kB]][,...]] [-f filter[=arg][,...]] [-g threshold[:keepalive]] [-c cpu-percent] [-u frames] [-s] [-R] [-n strength[:threshold]] [-i cutoff:{WxH+X+Y|motion}[/...]] [-T thumbnail-file[:seconds]] [-B shm-name[:kB]] [-o {stdout|files|cgi|http|raw=shm-name[:scale]}]... [-p port[:threads]]\n", argv[0]);
 				rv = 6;
 				break;
 		}
 	}
 
+	if (!outputs)
+		modes[outputs++] = "cgi";
 	if (verbose) {
-		fprintf(stderr, "%s: output='%s', dev path='%s', width=%u, height=%u, frame rate=%u, max mem=%tu\n",
-			argv[0], mode, dev_path, width, height, frame_rate, max_mem);
+		fprintf(stderr, "%s: output='%s'", argv[0], modes[0]);
+		for (i = 1; i < outputs; i++)
+			fprintf(stderr, "+'%s'", modes[i]);
+		fprintf(stderr, ", dev path='%s', width=%u, height=%u, frame rate=%u, max mem=%tu\n",
+			dev_path, width, height, frame_rate, max_mem);
 	}
 	max_mem *= 1024 * 1024;
 	/* setup output */
-	if (!strcmp(mode, "stdout")) {
-		out = video_frame_output_stdout_init();
-	} else if (!strcmp(mode, "files")) {
-		out = video_frame_output_files_init();
-	} else if (!strcmp(mode, "cgi")) {
-		out = video_frame_output_cgi_init(stdout);
-	} else if (!strcmp(mode, "http")) {
-		out = video_frame_output_http_init(port);
-	} else {
-		rv = 7;
+	if (!rv && outputs == 1 && !broker_name) {
+		if (create_output(modes[0], port, http_threads, &out))
+			rv = 7;
+	} else if (!rv && (out = video_frame_output_tee_init()) != NULL) {
+		/* one capture and one encoding shared by several outputs (a broker's too) */
+		for (i = 0; i < outputs && !rv; i++) {
+			video_frame_output_t *branch;
+
+			if (create_output(modes[i], port, http_threads, &branch)) {
+				rv = 7;
+			} else if (!branch || video_frame_output_tee_add(out, branch, modes[i])) {
+				fprintf(stderr, "Could not initialize frame output %s\n", modes[i]);
+				rv = 8;
+			}
+		}
 	}
 
+#ifdef	USE_JPEGLIB
+	/* http and tee (also in a broker) copy each frame as a whole before sending it */
+	if (!rv && stream && (outputs > 1 || broker_name || (strcmp(modes[0], "stdout") && strcmp(modes[0], "files") && strcmp(modes[0], "cgi")))) {
+		if (outputs > 1 || broker_name)
+			fprintf(stderr, "Compression while sending (-s) ignored with several outputs or -B\n");
+		else
+			fprintf(stderr, "Compression while sending (-s) ignored with output %s\n", modes[0]);
+		stream = 0;
+	}
+#endif
+
 	do {
 		const capture_data_format_t *format;
 
@@ -183,6 +721,28 @@ int main(int argc, char **argv)
 			break;
 		}
 
+		/* another instance may own the camera already */
+		if (broker_name) {
+			video_frame_output_t *broker;
+			int claimed;
+
+			ring = shm_ring_open(broker_name, (size_t) broker_size * 1024);
+			claimed = ring ? relay_frames(ring, out) : -1;
+			if (claimed <= 0) {
+				rv = claimed ? 12 : 0;
+				break;
+			}
+			if (verbose)
+				fprintf(stderr, "Publishing frames in shared memory %s\n", broker_name);
+			broker = video_frame_output_shm_init(ring);
+			ring = NULL;
+			if (!broker || video_frame_output_tee_add(out, broker, "shm")) {
+				fprintf(stderr, "Could not initialize shared memory output\n");
+				rv = 12;
+				break;
+			}
+		}
+
 		/* setup input */
 		cap = capture_init_v4l2(verbose, dev_path, width, height, frame_rate, max_mem);
 		if (!cap) {
@@ -191,53 +751,126 @@ int main(int argc, char **argv)
 			break;
 		}
 		format = cap->op->GetFormat(cap);
-		/* setup filter appropriate for given input */
-		switch (format->fmt) {
-			case CAPTURE_FMT__JPEG:
-				filter = vff_null_create();
-				break;
-			case CAPTURE_FMT__MJPEG:
-				filter = vff_mjpeg2jpeg_create();
-				break;
+		/* outputs keeping frames longer than a frame interval get copies */
+		pool = capture_pool_create(cap, ARENA_SLOTS, format->interval ? format->interval : ARENA_DEADLINE);
+		if (!pool) {
+			fprintf(stderr, "Could not initialize pool of captured frames\n");
+			rv = 9;
+			break;
+		}
+		if (cpu_budget && !format->interval)
+			fprintf(stderr, "Frame interval is unknown, CPU budget will not be observed\n");
 #ifdef	USE_JPEGLIB
-			case CAPTURE_FMT__YUV422_PACKED:
-				filter = vff_yuv2jpeg_create(format->width, format->height, format->bytesperline, jpeg_quality);
+		if (cpu_budget && format->interval) {
+			/* one budget for all the tiers together */
+			budget = vff_yuv2jpeg_budget_create(format->interval, cpu_budget);
+			if (!budget) {
+				fprintf(stderr, "Could not initialize CPU budget\n");
+				rv = 10;
 				break;
-#endif
-			default:
-				fprintf(stderr, "Unsupported input format\n");
+			}
+		}
+		if (roi_spec) {
+			roi = create_roi(roi_spec, format);
+			if (!roi || (roi_is_dynamic(roi) && !motion_threshold)) {
+				fprintf(stderr, "Could not initialize regions of interest%s\n", roi ? " (motion requires -g)" : "");
+				rv = 10;
 				break;
+			}
+		}
+#endif
+		/* setup filters appropriate for given input */
+		tiers = video_frame_tiers_create();
+		if (!tiers) {
+			fprintf(stderr, "Could not initialize output tiers\n");
+			rv = 12;
+			break;
 		}
-		if (!filter) {
-			fprintf(stderr, "Could not initialize data filter\n");
+		if (create_tiers(tiers, tiers_spec, stages_spec, format, jpeg_quality)) {
 			rv = 10;
 			break;
 		}
+		/* the output is fed with the first tier */
+		video_frame_tiers_subscribe(tiers, 0);
+		if (motion_threshold)
+			motion = motion_detector_create(format, motion_threshold, motion_keepalive);
+#ifdef	USE_JPEGLIB
+		if (motion && roi && roi_is_dynamic(roi))
+			motion_detector_set_roi(motion, roi);
+#endif
+		if (thumb_path) {
+			const char *name;
+
+			thumb = create_filter(format, 8, jpeg_quality, 0, &name);
+			thumb_out = video_frame_output_snapshot_init(thumb_path);
+			if (!thumb || !thumb_out) {
+				fprintf(stderr, "Could not initialize thumbnail %s\n", thumb_path);
+				rv = 11;
+				break;
+			}
+		}
 
 		/* main loop */
-		for (run = 1; run; ) {
-			unsigned char *buffer;
-			size_t size;
+		while (run) {
 			/* capture frame */
-			int index = cap->op->Capture(cap, &buffer, &size);
+			capture_frame_t *frame = capture_pool_capture(pool);
 
-			if (index < 0)
+			if (!frame)
 				break;
 
-			/* pass frame to the filter */
-			filter->op->PutFrame(filter, buffer, size);
+			/* drop frames of a static scene */
+			if (motion && !motion_detector_check(motion, frame->data, frame->size)) {
+				capture_frame_release(frame);
+				continue;
+			}
+
+			/* pass frame to the filters */
+			video_frame_tiers_put_frame(tiers, frame);
 			/* pass filtered frame to the output */
-			out->op->PutFrame(out, filter);
-			/* release captured frame */
-			cap->op->ReleaseBuffer(cap, index);
+			if (out->op->PutTiers)
+				out->op->PutTiers(out, tiers);
+			else
+				out->op->PutFrame(out, video_frame_tiers_get(tiers, 0));
+			/* refresh thumbnail from time to time */
+			if (thumb) {
+				struct timespec now;
+
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				if (now.tv_sec >= thumb_due.tv_sec) {
+					thumb->op->PutFrame(thumb, frame->data, frame->size);
+					thumb_out->op->PutFrame(thumb_out, thumb);
+					thumb_due.tv_sec = now.tv_sec + thumb_interval;
+				}
+			}
+			/* the capture buffer goes back to the driver once outputs which took the frame are done */
+			video_frame_tiers_release_frame(tiers);
+			capture_frame_release(frame);
 		}
 	} while (0);
 
 	/* cleanup */
 	if (out)
 		out->op->Destroy(out);
-	if (filter)
-		filter->op->Destroy(filter);
+	if (tiers)
+		video_frame_tiers_destroy(tiers);
+	if (motion)
+		motion_detector_destroy(motion);
+#ifdef	USE_JPEGLIB
+	if (roi)
+		roi_destroy(roi);
+#endif
+	if (thumb)
+		thumb->op->Destroy(thumb);
+	if (thumb_out)
+		thumb_out->op->Destroy(thumb_out);
+#ifdef	USE_JPEGLIB
+	if (budget)
+		vff_yuv2jpeg_budget_destroy(budget);
+#endif
+	if (pool)
+		capture_pool_destroy(pool);
+	if (ring)
+		shm_ring_close(ring);
 	if (cap)
 		cap->op->Destroy(cap);
     return rv;
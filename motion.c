@@ -0,0 +1,248 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "motion.h"
+#include "jpeg_huff.h"
+
+/**
+ * @addtogroup motion
+ * @{
+ */
+
+/**************************************/
+
+/** Distance between luminance samples of YUV frames, in pixels. */
+#define	MOTION_STEP			4
+/** Size of a tile compared at once, in samples (in both directions). */
+#define	MOTION_TILE			8
+/** Relative change of (M)JPEG frame size (in percent) which is taken as a change of the scene right away. */
+#define	MOTION_SIZE_CHANGE	25
+
+/** Motion detector instance. */
+struct motion_detector_t {
+	capture_data_format_t format;			/**< Format of captured frames. */
+	unsigned threshold;						/**< Mean absolute difference within a tile which means a change. */
+	unsigned keepalive;						/**< Keepalive interval, in seconds. */
+	struct timespec last;					/**< When the last frame has been let through. */
+	size_t last_size;						/**< Size of the last frame let through. */
+	unsigned cols;							/**< Number of samples in each row. */
+	unsigned rows;							/**< Number of rows of samples. */
+	unsigned char *ref;						/**< Samples of the last frame let through (@c cols x @c rows), or NULL. */
+	unsigned char *cur;						/**< Samples of the frame being checked. */
+	jpeg_huff_dc_image_t image;				/**< DC image of the (M)JPEG frame being checked. */
+	unsigned sample_size;					/**< Distance between samples, in pixels. */
+	roi_t *roi;								/**< Regions of interest marked where the scene changes, or NULL. */
+};
+
+/**************************************/
+
+/**
+ * (Re)allocates sample buffers.
+ *
+ * @param md Motion detector instance.
+ * @param cols Number of samples in each row.
+ * @param rows Number of rows of samples.
+ */
+static void motion_resize(motion_detector_t *md, unsigned cols, unsigned rows)
+{
+	if (md->cols == cols && md->rows == rows && md->cur)
+		return;
+	free(md->ref);
+	free(md->cur);
+	md->ref = NULL;
+	md->cur = malloc((size_t) cols * rows);
+	md->cols = cols;
+	md->rows = rows;
+}
+
+/**
+ * Samples luminance of a YUV 4:2:2 packed frame, or green of a raw Bayer frame.
+ *
+ * @param md Motion detector instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @return 0 on success, -1 if the frame is too short.
+ */
+static int motion_sample_yuv(motion_detector_t *md, const unsigned char *frame, size_t size)
+{
+	/* MOTION_STEP is even, so every sample of a Bayer frame is taken from the same site */
+	unsigned bpp = CAPTURE_FMT_IS_BAYER(md->format.fmt) ? 1 : 2;
+	unsigned green = CAPTURE_FMT_IS_BAYER(md->format.fmt) ? CAPTURE_BAYER_RED_X(md->format.fmt) ^ !CAPTURE_BAYER_RED_Y(md->format.fmt) : 0;
+	unsigned x, y;
+
+	motion_resize(md, md->format.width / MOTION_STEP, md->format.height / MOTION_STEP);
+	md->sample_size = MOTION_STEP;
+	if ((size_t) md->format.bytesperline * md->format.height > size)
+		return -1;
+	for (y = 0; y < md->rows; y++) {
+		const unsigned char *line = frame + (size_t) y * MOTION_STEP * md->format.bytesperline;
+		unsigned char *cur = md->cur + (size_t) y * md->cols;
+
+		for (x = 0; x < md->cols; x++)
+			cur[x] = line[x * MOTION_STEP * bpp + green];
+	}
+	return 0;
+}
+
+/**
+ * Samples luminance of a (M)JPEG frame: takes DC coefficient of each luminance block.
+ *
+ * @param md Motion detector instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @return 0 on success, -1 if the frame couldn't be decoded.
+ */
+static int motion_sample_jpeg(motion_detector_t *md, const unsigned char *frame, size_t size)
+{
+	unsigned y;
+
+	if (jpeg_huff_dc_image(frame, size, &md->image))
+		return -1;
+	motion_resize(md, md->image.comp[0].width, md->image.comp[0].height);
+	md->sample_size = (md->format.width + md->cols - 1) / md->cols;
+	for (y = 0; y < md->rows; y++)
+		memcpy(md->cur + (size_t) y * md->cols,
+			md->image.samples + md->image.comp[0].offset + (size_t) y * md->image.comp[0].stride, md->cols);
+	return 0;
+}
+
+/**
+ * Compares current samples with the reference ones, tile by tile.
+ * If regions of interest are given, all tiles are compared, and changed
+ * ones are marked there.
+ *
+ * @param md Motion detector instance.
+ * @return Non-zero if mean absolute difference within any tile exceeds the threshold.
+ */
+static int motion_compare(motion_detector_t *md)
+{
+	unsigned tx, ty, x, y;
+	int changed = 0;
+
+	for (ty = 0; ty < md->rows; ty += MOTION_TILE) {
+		unsigned th = md->rows - ty < MOTION_TILE ? md->rows - ty : MOTION_TILE;
+
+		for (tx = 0; tx < md->cols; tx += MOTION_TILE) {
+			unsigned tw = md->cols - tx < MOTION_TILE ? md->cols - tx : MOTION_TILE;
+			unsigned sad = 0;
+
+			for (y = 0; y < th; y++) {
+				size_t offset = (size_t) (ty + y) * md->cols + tx;
+				const unsigned char *cur = md->cur + offset;
+				const unsigned char *ref = md->ref + offset;
+
+				for (x = 0; x < tw; x++)
+					sad += cur[x] > ref[x] ? cur[x] - ref[x] : ref[x] - cur[x];
+			}
+			if (sad <= md->threshold * tw * th)
+				continue;
+			if (!md->roi)
+				return 1;
+			roi_mark(md->roi, tx * md->sample_size, ty * md->sample_size, tw * md->sample_size, th * md->sample_size);
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+/**************************************/
+
+motion_detector_t *motion_detector_create(const capture_data_format_t *format, unsigned threshold, unsigned keepalive)
+{
+	motion_detector_t *rv = (motion_detector_t *) calloc(1, sizeof(motion_detector_t));
+
+	rv->format = *format;
+	rv->threshold = threshold;
+	rv->keepalive = keepalive;
+	return rv;
+}
+
+int motion_detector_check(motion_detector_t *md, const unsigned char *frame, size_t size)
+{
+	struct timespec now;
+	int changed = 1, sampled = -1;
+
+	if (md->roi)
+		roi_clear(md->roi);
+	switch (md->format.fmt) {
+		case CAPTURE_FMT__BAYER_RGGB8:
+		case CAPTURE_FMT__BAYER_GRBG8:
+		case CAPTURE_FMT__BAYER_GBRG8:
+		case CAPTURE_FMT__BAYER_BGGR8:
+		case CAPTURE_FMT__YUV422_PACKED:
+			sampled = motion_sample_yuv(md, frame, size);
+			break;
+		case CAPTURE_FMT__JPEG:
+		case CAPTURE_FMT__MJPEG:
+			/* considerable change of size means considerable change of contents */
+			if (md->last_size && size * 100 > md->last_size * (100 + MOTION_SIZE_CHANGE))
+				break;
+			if (md->last_size && size * 100 < md->last_size * (100 - MOTION_SIZE_CHANGE))
+				break;
+			sampled = motion_sample_jpeg(md, frame, size);
+			break;
+	}
+	if (!sampled && md->ref)
+		changed = motion_compare(md);
+	else if (md->roi)
+		/* nothing to compare with, so everything is of interest */
+		roi_mark(md->roi, 0, 0, md->format.width, md->format.height);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!changed && md->keepalive && now.tv_sec - md->last.tv_sec >= (time_t) md->keepalive)
+		changed = 1;
+	if (!changed)
+		return 0;
+
+	/* let it through & remember it */
+	md->last = now;
+	md->last_size = size;
+	if (!sampled) {
+		unsigned char *tmp = md->ref;
+
+		md->ref = md->cur;
+		md->cur = tmp ? tmp : malloc((size_t) md->cols * md->rows);
+	} else {
+		/* invalidate reference */
+		free(md->ref);
+		md->ref = NULL;
+	}
+	return 1;
+}
+
+void motion_detector_set_roi(motion_detector_t *md, roi_t *roi)
+{
+	md->roi = roi;
+}
+
+void motion_detector_destroy(motion_detector_t *md)
+{
+	jpeg_huff_dc_image_free(&md->image);
+	free(md->ref);
+	free(md->cur);
+	free(md);
+}
+
+/**
+ * @}
+ */
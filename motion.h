@@ -0,0 +1,84 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	MOTION_H
+#define	MOTION_H
+
+/**
+ * @defgroup motion Motion detector
+ * @{
+ * Tells whether a captured frame differs from the last one let through
+ */
+
+#include <stddef.h>
+#include "capture.h"
+#include "roi.h"
+
+/** Motion detector instance. */
+typedef struct motion_detector_t motion_detector_t;
+
+/**
+ * Creates a motion detector.
+ *
+ * Luminance of a frame is sampled in a coarse grid (every 4th pixel of
+ * YUV frames, every 4th green sample of Bayer frames, DC coefficients of
+ * 8x8 blocks of (M)JPEG frames), and
+ * compared tile by tile with the last frame let through.
+ *
+ * @param format Format of captured frames.
+ * @param threshold Mean absolute difference of luminance samples within a tile
+ *                  above which the scene is considered changed.
+ * @param keepalive Interval in seconds after which a frame is let through even if
+ *                  nothing has changed, or 0 if static frames should be always dropped.
+ * @return An instance of motion detector, or NULL on error.
+ */
+motion_detector_t *motion_detector_create(const capture_data_format_t *format, unsigned threshold, unsigned keepalive);
+
+/**
+ * Checks whether a captured frame should be processed.
+ *
+ * @param md Motion detector instance.
+ * @param frame Pointer to the frame data.
+ * @param size Size of frame data.
+ * @return Non-zero if the scene has changed or keepalive interval has elapsed,
+ *         0 if the frame should be dropped.
+ */
+int motion_detector_check(motion_detector_t *md, const unsigned char *frame, size_t size);
+
+/**
+ * Makes the motion detector mark tiles where the scene has changed as
+ * dynamic regions of interest, each time a frame is checked.
+ *
+ * @param md Motion detector instance.
+ * @param roi Set of regions of interest accepting dynamic ones, or NULL.
+ */
+void motion_detector_set_roi(motion_detector_t *md, roi_t *roi);
+
+/**
+ * Destroys motion detector.
+ *
+ * @param md Motion detector instance.
+ */
+void motion_detector_destroy(motion_detector_t *md);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "roi.h"
+
+/**
+ * @addtogroup roi
+ * @{
+ */
+
+/**************************************/
+
+/** Size of cells of the map of dynamic regions, in pixels. */
+#define	ROI_CELL	16
+
+/** Set of regions of interest. */
+struct roi_t {
+	roi_rect_t rects[ROI_MAX];	/**< Static regions. */
+	unsigned count;				/**< Number of static regions. */
+	unsigned cols;				/**< Number of columns of the map of dynamic regions. */
+	unsigned rows;				/**< Number of rows of the map of dynamic regions. */
+	unsigned char *map;			/**< Map of dynamic regions (non-zero cell means interest), or NULL. */
+};
+
+/**************************************/
+
+roi_t *roi_create(unsigned width, unsigned height, const roi_rect_t *rects, unsigned count, int dynamic)
+{
+	roi_t *rv;
+
+	if (count > ROI_MAX) {
+		fprintf(stderr, "Too many regions of interest: %u\n", count);
+		return NULL;
+	}
+	rv = (roi_t *) calloc(1, sizeof(roi_t));
+	memcpy(rv->rects, rects, count * sizeof(*rects));
+	rv->count = count;
+	if (dynamic) {
+		rv->cols = (width + ROI_CELL - 1) / ROI_CELL;
+		rv->rows = (height + ROI_CELL - 1) / ROI_CELL;
+		rv->map = calloc(rv->cols, rv->rows);
+	}
+	return rv;
+}
+
+int roi_is_dynamic(const roi_t *roi)
+{
+	return roi->map != NULL;
+}
+
+void roi_clear(roi_t *roi)
+{
+	if (roi->map)
+		memset(roi->map, 0, (size_t) roi->cols * roi->rows);
+}
+
+void roi_mark(roi_t *roi, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+	unsigned col, row, x1, y1;
+
+	if (!roi->map || !width || !height)
+		return;
+	x1 = (x + width - 1) / ROI_CELL;
+	y1 = (y + height - 1) / ROI_CELL;
+	if (x1 >= roi->cols)
+		x1 = roi->cols - 1;
+	if (y1 >= roi->rows)
+		y1 = roi->rows - 1;
+	for (row = y / ROI_CELL; row <= y1; row++)
+		for (col = x / ROI_CELL; col <= x1; col++)
+			roi->map[(size_t) row * roi->cols + col] = 1;
+}
+
+int roi_contains(const roi_t *roi, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+	unsigned i, col, row, x1, y1;
+
+	for (i = 0; i < roi->count; i++) {
+		const roi_rect_t *rect = &roi->rects[i];
+
+		if (x < rect->x + rect->width && rect->x < x + width &&
+			y < rect->y + rect->height && rect->y < y + height)
+			return 1;
+	}
+	if (!roi->map || !width || !height)
+		return 0;
+	x1 = (x + width - 1) / ROI_CELL;
+	y1 = (y + height - 1) / ROI_CELL;
+	if (x1 >= roi->cols)
+		x1 = roi->cols - 1;
+	if (y1 >= roi->rows)
+		y1 = roi->rows - 1;
+	for (row = y / ROI_CELL; row <= y1; row++)
+		for (col = x / ROI_CELL; col <= x1; col++)
+			if (roi->map[(size_t) row * roi->cols + col])
+				return 1;
+	return 0;
+}
+
+void roi_destroy(roi_t *roi)
+{
+	free(roi->map);
+	free(roi);
+}
+
+/**
+ * @}
+ */
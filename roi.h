@@ -0,0 +1,104 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef	ROI_H
+#define	ROI_H
+
+/**
+ * @defgroup roi Regions of interest
+ * @{
+ * Parts of frames which keep full detail when the rest is made coarser
+ */
+
+/** Maximum number of static regions of interest. */
+#define	ROI_MAX		16
+
+/** Rectangle of a region of interest, in pixels of captured frames. */
+typedef struct {
+	unsigned x;			/**< Left edge. */
+	unsigned y;			/**< Top edge. */
+	unsigned width;		/**< Width. */
+	unsigned height;	/**< Height. */
+} roi_rect_t;
+
+/** Set of regions of interest. */
+typedef struct roi_t roi_t;
+
+/**
+ * Creates a set of regions of interest.
+ *
+ * @param width Width of captured frames, in pixels.
+ * @param height Height of captured frames, in pixels.
+ * @param rects Static regions (copied).
+ * @param count Number of static regions (up to @ref ROI_MAX).
+ * @param dynamic If non-zero, regions can be also marked frame by frame
+ *                (see @ref roi_mark), e.g. by the motion detector.
+ * @return A set of regions of interest, or NULL on error.
+ */
+roi_t *roi_create(unsigned width, unsigned height, const roi_rect_t *rects, unsigned count, int dynamic);
+
+/**
+ * Tells whether dynamic regions are accepted by the set.
+ *
+ * @param roi Set of regions of interest.
+ * @return Non-zero if @ref roi_mark makes sense.
+ */
+int roi_is_dynamic(const roi_t *roi);
+
+/**
+ * Forgets dynamic regions marked so far.
+ *
+ * @param roi Set of regions of interest.
+ */
+void roi_clear(roi_t *roi);
+
+/**
+ * Marks a dynamic region of interest. It's rounded outwards to a grid of 16 pixels.
+ *
+ * @param roi Set of regions of interest.
+ * @param x Left edge of the region, in pixels.
+ * @param y Top edge of the region, in pixels.
+ * @param width Width of the region, in pixels.
+ * @param height Height of the region, in pixels.
+ */
+void roi_mark(roi_t *roi, unsigned x, unsigned y, unsigned width, unsigned height);
+
+/**
+ * Tells whether an area intersects any region of interest.
+ *
+ * @param roi Set of regions of interest.
+ * @param x Left edge of the area, in pixels.
+ * @param y Top edge of the area, in pixels.
+ * @param width Width of the area, in pixels.
+ * @param height Height of the area, in pixels.
+ * @return Non-zero if the area should keep full detail.
+ */
+int roi_contains(const roi_t *roi, unsigned x, unsigned y, unsigned width, unsigned height);
+
+/**
+ * Destroys a set of regions of interest.
+ *
+ * @param roi Set of regions of interest.
+ */
+void roi_destroy(roi_t *roi);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,393 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shm_ring.h"
+
+/**
+ * @addtogroup shm_ring
+ * @{
+ */
+
+/**************************************/
+
+/** Tells that the ring has been set up. */
+#define	SHM_RING_MAGIC	0x57434d31	/* "WCM1" */
+
+/** Number of slots of a ring. */
+#define	SHM_RING_SLOTS	4
+
+/** Alignment of the header and slots, to keep them on separate cache lines. */
+#define	SHM_RING_ALIGN	64
+
+/** Header of a ring in shared memory. */
+typedef struct {
+	unsigned magic;		/**< @ref SHM_RING_MAGIC once the ring is set up. */
+	unsigned slots;		/**< Number of slots. */
+	size_t slot_size;	/**< Maximum size of a frame in a slot. */
+	unsigned head;		/**< Number of the latest frame; readers wait on it with futex. */
+	pid_t broker;		/**< Process ID of the broker, or 0 if there's none. */
+} shm_ring_header_t;
+
+/** Slot of a ring in shared memory, followed by frame data. */
+typedef struct {
+	unsigned seq;			/**< Sequence lock: odd while the slot is being written. */
+	unsigned frame;			/**< Number of the frame in the slot. */
+	size_t size;			/**< Size of the frame in the slot. */
+	shm_ring_meta_t meta;	/**< Description of the frame in the slot. */
+} shm_ring_slot_t;
+
+/** Ring of frames in shared memory. */
+struct shm_ring_t {
+	int fd;							/**< Shared memory object. */
+	size_t slot_size;				/**< Maximum size of a frame, used if this process becomes the broker. */
+	int broker;						/**< Whether this process is the broker. */
+	shm_ring_header_t *header;		/**< Mapped ring, or NULL. */
+	size_t length;					/**< Length of the mapping. */
+	shm_ring_slot_t *writing;		/**< Slot being written by the broker, or NULL. */
+	shm_ring_slot_t *peeked;		/**< Slot of the frame found by @ref shm_ring_peek, or NULL. */
+	unsigned peeked_seq;			/**< Sequence of @c peeked when the frame was found. */
+};
+
+/**************************************/
+
+/**
+ * Computes offset of a slot from the beginning of the ring.
+ *
+ * @param slot_size Maximum size of a frame in a slot.
+ * @param index Index of the slot.
+ * @return Offset of the slot.
+ */
+static size_t shm_ring_offset(size_t slot_size, unsigned index)
+{
+	size_t header = (sizeof(shm_ring_header_t) + SHM_RING_ALIGN - 1) & ~(size_t) (SHM_RING_ALIGN - 1);
+	size_t stride = (sizeof(shm_ring_slot_t) + slot_size + SHM_RING_ALIGN - 1) & ~(size_t) (SHM_RING_ALIGN - 1);
+
+	return header + stride * index;
+}
+
+/**
+ * Returns slot which keeps given frame.
+ *
+ * @param ring Ring of frames (mapped).
+ * @param frame Number of the frame, starting from 1.
+ * @return The slot.
+ */
+static shm_ring_slot_t *shm_ring_slot(shm_ring_t *ring, unsigned frame)
+{
+	shm_ring_header_t *header = ring->header;
+
+	return (shm_ring_slot_t *) ((char *) header + shm_ring_offset(header->slot_size, (frame - 1) % header->slots));
+}
+
+/**
+ * Unmaps a ring.
+ *
+ * @param ring Ring of frames.
+ */
+static void shm_ring_unmap(shm_ring_t *ring)
+{
+	if (ring->header) {
+		munmap(ring->header, ring->length);
+		ring->header = NULL;
+		ring->peeked = NULL;
+	}
+}
+
+/**
+ * Maps a ring set up by a broker for reading.
+ *
+ * @param ring Ring of frames.
+ * @return 0 on success, -1 if it hasn't been set up yet or on error.
+ */
+static int shm_ring_map(shm_ring_t *ring)
+{
+	shm_ring_header_t *header;
+	struct stat st;
+	size_t length;
+
+	if (fstat(ring->fd, &st) || (size_t) st.st_size < sizeof(shm_ring_header_t))
+		return -1;
+	header = (shm_ring_header_t *) mmap(NULL, sizeof(shm_ring_header_t), PROT_READ, MAP_SHARED, ring->fd, 0);
+	if (header == MAP_FAILED)
+		return -1;
+	length = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_RING_MAGIC ? shm_ring_offset(header->slot_size, header->slots) : 0;
+	munmap(header, sizeof(shm_ring_header_t));
+	if (!length || (size_t) st.st_size < length)
+		return -1;
+	header = (shm_ring_header_t *) mmap(NULL, length, PROT_READ, MAP_SHARED, ring->fd, 0);
+	if (header == MAP_FAILED)
+		return -1;
+	ring->header = header;
+	ring->length = length;
+	return 0;
+}
+
+/**
+ * Tells whether a mapped ring is still set up the way it was mapped.
+ *
+ * @param ring Ring of frames (mapped).
+ * @return Non-zero if the mapping is valid.
+ */
+static int shm_ring_mapped(shm_ring_t *ring)
+{
+	shm_ring_header_t *header = ring->header;
+
+	return __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_RING_MAGIC
+		&& shm_ring_offset(header->slot_size, header->slots) == ring->length;
+}
+
+/**
+ * Calls futex system call on a word of the ring shared between processes.
+ *
+ * @param addr Futex word.
+ * @param op FUTEX_WAIT or FUTEX_WAKE.
+ * @param val Expected value of the word or number of waiters to wake up.
+ * @param timeout Timeout of waiting, or NULL.
+ * @return Result of the system call.
+ */
+static long shm_ring_futex(unsigned *addr, int op, unsigned val, const struct timespec *timeout)
+{
+	return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+/**************************************/
+
+shm_ring_t *shm_ring_open(const char *name, size_t slot_size)
+{
+	shm_ring_t *rv;
+	char path[NAME_MAX];
+
+	if (strchr(name, '/') || snprintf(path, sizeof(path), "/%s", name) >= (int) sizeof(path)) {
+		fprintf(stderr, "Invalid name of shared memory %s\n", name);
+		return NULL;
+	}
+	rv = (shm_ring_t *) calloc(1, sizeof(shm_ring_t));
+	if (!rv)
+		return NULL;
+	rv->fd = shm_open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (rv->fd < 0) {
+		perror(path);
+		free(rv);
+		return NULL;
+	}
+	rv->slot_size = slot_size;
+	return rv;
+}
+
+int shm_ring_claim(shm_ring_t *ring)
+{
+	shm_ring_header_t *header;
+	size_t length;
+	int reuse;
+
+	if (ring->broker)
+		return 1;
+	/* the lock is dropped by the kernel when the broker dies */
+	if (flock(ring->fd, LOCK_EX | LOCK_NB))
+		return errno == EWOULDBLOCK ? 0 : -1;
+	shm_ring_unmap(ring);
+
+	/* a ring set up by a previous broker is taken as it is, readers may use it */
+	reuse = !shm_ring_map(ring) && ring->header->slot_size >= ring->slot_size;
+	length = reuse ? ring->length : shm_ring_offset(ring->slot_size, SHM_RING_SLOTS);
+	shm_ring_unmap(ring);
+	if (!reuse && ftruncate(ring->fd, length)) {
+		flock(ring->fd, LOCK_UN);
+		return -1;
+	}
+	header = (shm_ring_header_t *) mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (header == MAP_FAILED) {
+		flock(ring->fd, LOCK_UN);
+		return -1;
+	}
+	if (!reuse) {
+		/* readers of a ring set up differently map it again */
+		unsigned head = header->head;
+
+		__atomic_store_n(&header->magic, 0, __ATOMIC_RELEASE);
+		memset((char *) header + sizeof(header->magic), 0, length - sizeof(header->magic));
+		header->slots = SHM_RING_SLOTS;
+		header->slot_size = ring->slot_size;
+		header->head = head;
+		__atomic_store_n(&header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&header->broker, getpid(), __ATOMIC_RELEASE);
+	ring->header = header;
+	ring->length = length;
+	ring->broker = 1;
+	return 1;
+}
+
+unsigned char *shm_ring_begin(shm_ring_t *ring, size_t size)
+{
+	unsigned frame = ring->header->head + 1;
+	shm_ring_slot_t *slot;
+
+	if (size > ring->header->slot_size)
+		return NULL;
+	if (!frame)
+		frame++;
+	slot = shm_ring_slot(ring, frame);
+	/* readers skip the slot while its sequence is odd */
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	ring->writing = slot;
+	return (unsigned char *) (slot + 1);
+}
+
+void shm_ring_commit(shm_ring_t *ring, size_t size, const shm_ring_meta_t *meta)
+{
+	shm_ring_header_t *header = ring->header;
+	shm_ring_slot_t *slot = ring->writing;
+	unsigned frame = header->head + 1;
+
+	if (!frame)
+		frame++;
+	if (meta)
+		slot->meta = *meta;
+	else
+		memset(&slot->meta, 0, sizeof(slot->meta));
+	__atomic_store_n(&slot->size, size, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->frame, frame, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+	ring->writing = NULL;
+
+	__atomic_store_n(&header->head, frame, __ATOMIC_RELEASE);
+	shm_ring_futex(&header->head, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+int shm_ring_put(shm_ring_t *ring, const unsigned char *data, size_t size, const shm_ring_meta_t *meta)
+{
+	unsigned char *dst = shm_ring_begin(ring, size);
+
+	if (!dst)
+		return -1;
+	memcpy(dst, data, size);
+	shm_ring_commit(ring, size, meta);
+	return 0;
+}
+
+long shm_ring_peek(shm_ring_t *ring, unsigned *frame, const unsigned char **data, shm_ring_meta_t *meta, unsigned timeout)
+{
+	shm_ring_header_t *header;
+	unsigned head, tries;
+
+	if (ring->header && !shm_ring_mapped(ring))
+		shm_ring_unmap(ring);
+	if (!ring->header && shm_ring_map(ring)) {
+		/* the broker is still setting up the ring */
+		usleep(10000);
+		return 0;
+	}
+	header = ring->header;
+	head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+	if (head == *frame) {
+		struct timespec ts;
+
+		if (!__atomic_load_n(&header->broker, __ATOMIC_ACQUIRE))
+			return 0;
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (long) (timeout % 1000) * 1000000;
+		if (shm_ring_futex(&header->head, FUTEX_WAIT, head, &ts) && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+			return -1;
+		head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+		if (head == *frame)
+			return 0;
+	}
+	/* the broker may be writing the slot right now; the frame before is taken then */
+	for (tries = 0; tries < header->slots && head && head != *frame; tries++, head--) {
+		shm_ring_slot_t *slot = shm_ring_slot(ring, head);
+		unsigned seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		size_t size = __atomic_load_n(&slot->size, __ATOMIC_RELAXED);
+
+		if ((seq & 1) || size > header->slot_size || __atomic_load_n(&slot->frame, __ATOMIC_RELAXED) != head)
+			continue;
+		if (meta)
+			*meta = slot->meta;
+		*data = (const unsigned char *) (slot + 1);
+		ring->peeked = slot;
+		ring->peeked_seq = seq;
+		if (!shm_ring_check(ring))
+			continue;
+		*frame = head;
+		return size;
+	}
+	return 0;
+}
+
+int shm_ring_check(shm_ring_t *ring)
+{
+	if (!ring->peeked)
+		return 0;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&ring->peeked->seq, __ATOMIC_RELAXED) == ring->peeked_seq;
+}
+
+long shm_ring_read(shm_ring_t *ring, unsigned *frame, unsigned char **buffer, size_t *capacity, unsigned timeout)
+{
+	const unsigned char *data;
+	unsigned number = *frame;
+	long size = shm_ring_peek(ring, &number, &data, NULL, timeout);
+
+	if (size <= 0)
+		return size;
+	if ((size_t) size > *capacity) {
+		unsigned char *bigger = (unsigned char *) realloc(*buffer, size);
+
+		if (!bigger)
+			return -1;
+		*buffer = bigger;
+		*capacity = size;
+	}
+	memcpy(*buffer, data, size);
+	/* overwritten while being copied: the next frame is there already */
+	if (!shm_ring_check(ring))
+		return 0;
+	*frame = number;
+	return size;
+}
+
+void shm_ring_close(shm_ring_t *ring)
+{
+	if (ring->broker) {
+		/* readers see there's no broker and try to become one */
+		__atomic_store_n(&ring->header->broker, 0, __ATOMIC_RELEASE);
+		shm_ring_futex(&ring->header->head, FUTEX_WAKE, INT_MAX, NULL);
+	}
+	shm_ring_unmap(ring);
+	close(ring->fd);
+	free(ring);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,167 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	SHM_RING_H
+#define	SHM_RING_H
+
+/**
+ * @defgroup shm_ring Shared memory ring
+ * @{
+ * Ring of frames in POSIX shared memory, written by one process (the broker)
+ * and read by any number of others
+ *
+ * The ring (@c /dev/shm/name) starts with a header, aligned to 64 bytes:
+ * @code
+ * unsigned magic;      // 0x57434d31 once set up
+ * unsigned slots;      // number of slots
+ * size_t slot_size;    // maximum size of a frame
+ * unsigned head;       // number of the latest frame (0 if none); futex
+ * pid_t broker;        // process writing frames, or 0 if none
+ * @endcode
+ * followed by @c slots slots, each aligned to 64 bytes:
+ * @code
+ * unsigned seq;        // odd while the slot is being written
+ * unsigned frame;      // number of the frame in the slot
+ * size_t size;         // size of the frame
+ * shm_ring_meta_t meta;
+ * unsigned char data[slot_size];
+ * @endcode
+ * Frame @c n is kept in slot <tt>(n - 1) % slots</tt>. Readers wait
+ * for @c head to change with @c FUTEX_WAIT, and take a frame as valid
+ * if @c seq is even and the same before and after reading it.
+ */
+
+#include <stddef.h>
+
+/** Description of a frame in a ring. */
+typedef struct {
+	unsigned fourcc;				/**< Pixel format as a V4L2 four-character code, or 0 if not given. */
+	unsigned width;					/**< Width of the frame in pixels, or 0 if not given. */
+	unsigned height;				/**< Height of the frame in pixels, or 0 if not given. */
+	unsigned stride;				/**< Bytes per line of the (first) plane, or 0 if not given. */
+	unsigned long long timestamp;	/**< Capture time in nanoseconds of CLOCK_MONOTONIC, or 0 if not given. */
+} shm_ring_meta_t;
+
+/** Ring of frames in shared memory. */
+typedef struct shm_ring_t shm_ring_t;
+
+/**
+ * Opens a ring, creating it if there's none yet. It isn't mapped until
+ * the process becomes the broker or reads a frame.
+ *
+ * @param name Name of the ring, without slashes.
+ * @param slot_size Maximum size of a frame, used if this process becomes the broker.
+ * @return An instance of a ring, or NULL on error.
+ */
+shm_ring_t *shm_ring_open(const char *name, size_t slot_size);
+
+/**
+ * Tries to become the broker, i.e. the only process writing frames
+ * to the ring. The broker stays so until it closes the ring or dies.
+ * A ring set up before is taken over as it is, unless its slots are
+ * too small.
+ *
+ * @param ring Ring of frames.
+ * @return 1 if this process is the broker now, 0 if another one is, -1 on error.
+ */
+int shm_ring_claim(shm_ring_t *ring);
+
+/**
+ * Starts writing a frame to the ring. Can be called by the broker only.
+ *
+ * @param ring Ring of frames.
+ * @param size Size of the frame.
+ * @return Where to write the frame, or NULL if it doesn't fit in a slot.
+ */
+unsigned char *shm_ring_begin(shm_ring_t *ring, size_t size);
+
+/**
+ * Finishes writing a frame started by @ref shm_ring_begin and wakes up
+ * the readers.
+ *
+ * @param ring Ring of frames.
+ * @param size Size of the frame.
+ * @param meta Description of the frame, or NULL.
+ */
+void shm_ring_commit(shm_ring_t *ring, size_t size, const shm_ring_meta_t *meta);
+
+/**
+ * Writes a frame to the ring and wakes up the readers. Can be called
+ * by the broker only.
+ *
+ * @param ring Ring of frames.
+ * @param data Frame data.
+ * @param size Size of frame data.
+ * @param meta Description of the frame, or NULL.
+ * @return 0 on success, -1 if the frame doesn't fit in a slot.
+ */
+int shm_ring_put(shm_ring_t *ring, const unsigned char *data, size_t size, const shm_ring_meta_t *meta);
+
+/**
+ * Finds the latest frame in the ring, waiting for one newer than given,
+ * unless there's no broker. The frame isn't copied; it's valid as long as
+ * @ref shm_ring_check says so, i.e. until the broker comes round to its
+ * slot again.
+ *
+ * @param ring Ring of frames.
+ * @param frame Number of the last frame read (0 at first), updated.
+ * @param data Set to the frame data in the ring.
+ * @param meta Receives description of the frame, may be NULL.
+ * @param timeout Maximum time of waiting, in milliseconds.
+ * @return Size of the frame, 0 if there's no new frame in time
+ *         or no broker, -1 on error.
+ */
+long shm_ring_peek(shm_ring_t *ring, unsigned *frame, const unsigned char **data, shm_ring_meta_t *meta, unsigned timeout);
+
+/**
+ * Tells whether the frame found by the last @ref shm_ring_peek hasn't been
+ * overwritten since, i.e. whatever has been read of it is consistent.
+ *
+ * @param ring Ring of frames.
+ * @return 1 if the frame is intact, 0 if not.
+ */
+int shm_ring_check(shm_ring_t *ring);
+
+/**
+ * Reads the latest frame from the ring, waiting for one newer than
+ * given, unless there's no broker.
+ *
+ * @param ring Ring of frames.
+ * @param frame Number of the last frame read (0 at first), updated.
+ * @param buffer Buffer receiving the frame, grown with realloc() if needed.
+ * @param capacity Size of @c buffer, updated.
+ * @param timeout Maximum time of waiting, in milliseconds.
+ * @return Size of the frame, 0 if there's no new frame in time
+ *         or no broker, -1 on error.
+ */
+long shm_ring_read(shm_ring_t *ring, unsigned *frame, unsigned char **buffer, size_t *capacity, unsigned timeout);
+
+/**
+ * Closes a ring. If this process is the broker, readers are woken up,
+ * so that one of them can take over.
+ *
+ * @param ring Ring of frames.
+ */
+void shm_ring_close(shm_ring_t *ring);
+
+/**
+ * @}
+ */
+
+#endif
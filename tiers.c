@@ -0,0 +1,162 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "tiers.h"
+
+/**
+ * @addtogroup tiers
+ * @{
+ */
+
+/**************************************/
+
+/** Maximum number of tiers in a set. */
+#define	TIERS_MAX	8
+
+/** Single output tier. */
+typedef struct {
+	video_frame_filter_t *filter;	/**< Filter producing the tier. */
+	unsigned subscribers;			/**< Number of subscribers interested in this tier. */
+	int ready;						/**< Whether the last frame has been already passed to @c filter. */
+	int copied;						/**< Whether output of @c filter has been already read into @c shared. */
+	shared_frame_t *shared;			/**< Copy of output of @c filter for the last frame, or NULL. */
+	size_t capacity;				/**< Size hint for @c shared. */
+} video_frame_tier_t;
+
+/** Set of output tiers. */
+struct video_frame_tiers_t {
+	unsigned count;						/**< Number of tiers. */
+	video_frame_tier_t tier[TIERS_MAX];	/**< Tiers (@c count entries). */
+	capture_frame_t *frame;				/**< Frame provided by @ref video_frame_tiers_put_frame, or NULL. */
+};
+
+/**************************************/
+
+video_frame_tiers_t *video_frame_tiers_create(void)
+{
+	return (video_frame_tiers_t *) calloc(1, sizeof(video_frame_tiers_t));
+}
+
+int video_frame_tiers_add(video_frame_tiers_t *tiers, video_frame_filter_t *filter)
+{
+	if (tiers->count >= TIERS_MAX) {
+		filter->op->Destroy(filter);
+		return -1;
+	}
+	tiers->tier[tiers->count].filter = filter;
+	return tiers->count++;
+}
+
+unsigned video_frame_tiers_count(video_frame_tiers_t *tiers)
+{
+	return tiers->count;
+}
+
+void video_frame_tiers_subscribe(video_frame_tiers_t *tiers, unsigned tier)
+{
+	if (tier < tiers->count)
+		tiers->tier[tier].subscribers++;
+}
+
+void video_frame_tiers_unsubscribe(video_frame_tiers_t *tiers, unsigned tier)
+{
+	if (tier < tiers->count && tiers->tier[tier].subscribers)
+		tiers->tier[tier].subscribers--;
+}
+
+void video_frame_tiers_put_frame(video_frame_tiers_t *tiers, capture_frame_t *frame)
+{
+	unsigned i;
+
+	if (tiers->frame)
+		capture_frame_release(tiers->frame);
+	tiers->frame = capture_frame_ref(frame);
+	for (i = 0; i < tiers->count; i++) {
+		video_frame_tier_t *t = &tiers->tier[i];
+
+		t->ready = 0;
+		t->copied = 0;
+		if (t->shared) {
+			shared_frame_release(t->shared);
+			t->shared = NULL;
+		}
+	}
+}
+
+capture_frame_t *video_frame_tiers_get_captured(video_frame_tiers_t *tiers)
+{
+	return tiers->frame;
+}
+
+void video_frame_tiers_release_frame(video_frame_tiers_t *tiers)
+{
+	if (tiers->frame) {
+		capture_frame_release(tiers->frame);
+		tiers->frame = NULL;
+	}
+}
+
+video_frame_filter_t *video_frame_tiers_get(video_frame_tiers_t *tiers, unsigned tier)
+{
+	video_frame_tier_t *t;
+
+	if (tier >= tiers->count || !tiers->frame)
+		return NULL;
+	t = &tiers->tier[tier];
+	if (!t->subscribers)
+		return NULL;
+	if (!t->ready) {
+		t->filter->op->PutFrame(t->filter, tiers->frame->data, tiers->frame->size);
+		t->ready = 1;
+	}
+	return t->filter;
+}
+
+shared_frame_t *video_frame_tiers_get_shared(video_frame_tiers_t *tiers, unsigned tier)
+{
+	video_frame_filter_t *filter = video_frame_tiers_get(tiers, tier);
+	video_frame_tier_t *t;
+
+	if (!filter)
+		return NULL;
+	t = &tiers->tier[tier];
+	if (!t->copied) {
+		t->shared = shared_frame_create(filter, &t->capacity);
+		t->copied = 1;
+	}
+	return t->shared ? shared_frame_ref(t->shared) : NULL;
+}
+
+void video_frame_tiers_destroy(video_frame_tiers_t *tiers)
+{
+	unsigned i;
+
+	video_frame_tiers_release_frame(tiers);
+	for (i = 0; i < tiers->count; i++) {
+		if (tiers->tier[i].shared)
+			shared_frame_release(tiers->tier[i].shared);
+		tiers->tier[i].filter->op->Destroy(tiers->tier[i].filter);
+	}
+	free(tiers);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,147 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	TIERS_H
+#define	TIERS_H
+
+/**
+ * @defgroup tiers Output tiers
+ * @{
+ * Set of video frame filters producing differently sized/compressed
+ * versions of the same captured frame, evaluated lazily
+ */
+
+#include "vff.h"
+#include "frame_store.h"
+#include "capture_frame.h"
+
+/** Set of output tiers. */
+typedef struct video_frame_tiers_t video_frame_tiers_t;
+
+/**
+ * Creates an empty set of output tiers.
+ *
+ * @return An instance of set of output tiers, or NULL on error.
+ */
+video_frame_tiers_t *video_frame_tiers_create(void);
+
+/**
+ * Adds a tier.
+ *
+ * @param tiers Set of output tiers.
+ * @param filter Video frame filter producing the tier; the set takes ownership of it.
+ * @return Index of the new tier, or a negative number on error.
+ */
+int video_frame_tiers_add(video_frame_tiers_t *tiers, video_frame_filter_t *filter);
+
+/**
+ * Returns number of tiers in the set.
+ *
+ * @param tiers Set of output tiers.
+ * @return Number of tiers.
+ */
+unsigned video_frame_tiers_count(video_frame_tiers_t *tiers);
+
+/**
+ * Registers interest in given tier. A tier is processed only while it has
+ * at least one subscriber.
+ *
+ * @param tiers Set of output tiers.
+ * @param tier Index of the tier.
+ */
+void video_frame_tiers_subscribe(video_frame_tiers_t *tiers, unsigned tier);
+
+/**
+ * Withdraws interest registered by @ref video_frame_tiers_subscribe.
+ *
+ * @param tiers Set of output tiers.
+ * @param tier Index of the tier.
+ */
+void video_frame_tiers_unsubscribe(video_frame_tiers_t *tiers, unsigned tier);
+
+/**
+ * Puts a captured frame into the set. Nothing is processed yet.
+ * The set keeps a reference to the frame until
+ * @ref video_frame_tiers_release_frame is called.
+ *
+ * @param tiers Set of output tiers.
+ * @param frame Captured frame.
+ */
+void video_frame_tiers_put_frame(video_frame_tiers_t *tiers, capture_frame_t *frame);
+
+/**
+ * Returns the captured frame last put into the set, e.g. for outputs
+ * which need it as it is. They have to take their own reference to keep it.
+ *
+ * @param tiers Set of output tiers.
+ * @return The captured frame, or NULL if there's none.
+ */
+capture_frame_t *video_frame_tiers_get_captured(video_frame_tiers_t *tiers);
+
+/**
+ * Releases the captured frame last put into the set, once all outputs
+ * have got it, so its capture buffer can go back to the driver.
+ * Tiers aren't processed any more until the next frame is put.
+ *
+ * @param tiers Set of output tiers.
+ */
+void video_frame_tiers_release_frame(video_frame_tiers_t *tiers);
+
+/**
+ * Returns filter of given tier with the last frame put into it.
+ *
+ * The frame is passed to the filter on first call after
+ * @ref video_frame_tiers_put_frame, so each tier processes each frame
+ * at most once, and only if it's asked for.
+ *
+ * @param tiers Set of output tiers.
+ * @param tier Index of the tier.
+ * @return Filter whose output is ready to be read, or NULL if the tier
+ *         has no subscribers.
+ */
+video_frame_filter_t *video_frame_tiers_get(video_frame_tiers_t *tiers, unsigned tier);
+
+/**
+ * Returns a shared copy of output of given tier for the last frame put
+ * into the set.
+ *
+ * The output is read from the filter once and then handed to every
+ * caller, so several consumers can get the same frame. Don't read
+ * the filter returned by @ref video_frame_tiers_get for the same frame then.
+ *
+ * @param tiers Set of output tiers.
+ * @param tier Index of the tier.
+ * @return A new reference to the frame, to be released with
+ *         @ref shared_frame_release, or NULL if the tier has no
+ *         subscribers or produced no output.
+ */
+shared_frame_t *video_frame_tiers_get_shared(video_frame_tiers_t *tiers, unsigned tier);
+
+/**
+ * Destroys set of output tiers along with all their filters.
+ *
+ * @param tiers Set of output tiers.
+ */
+void video_frame_tiers_destroy(video_frame_tiers_t *tiers);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "uring.h"
+
+/**
+ * @addtogroup uring
+ * @{
+ */
+
+/**************************************/
+
+/** Number of submission queue entries: enough to open, write and close a file. */
+#define	URING_ENTRIES	4
+
+/** Index of the registered file slot used by @ref uring_write. */
+#define	URING_SLOT		0
+
+/** io_uring instance. */
+struct uring_t {
+	int fd;							/**< io_uring file descriptor. */
+	void *sq_ring;					/**< Mapped submission queue ring. */
+	size_t sq_ring_size;			/**< Size of @c sq_ring. */
+	void *cq_ring;					/**< Mapped completion queue ring (may be the same as @c sq_ring). */
+	size_t cq_ring_size;			/**< Size of @c cq_ring. */
+	struct io_uring_sqe *sqes;		/**< Mapped submission queue entries. */
+	size_t sqes_size;				/**< Size of @c sqes. */
+	unsigned *sq_tail;				/**< Tail of the submission queue. */
+	unsigned *sq_mask;				/**< Mask of indices in the submission queue. */
+	unsigned *sq_array;				/**< Indices of submitted entries. */
+	unsigned *cq_head;				/**< Head of the completion queue. */
+	unsigned *cq_tail;				/**< Tail of the completion queue. */
+	unsigned *cq_mask;				/**< Mask of indices in the completion queue. */
+	struct io_uring_cqe *cqes;		/**< Completion queue entries. */
+};
+
+/**************************************/
+
+/**
+ * Maps a region of io_uring.
+ *
+ * @param fd io_uring file descriptor.
+ * @param size Size of the region.
+ * @param offset Offset identifying the region.
+ * @return Mapped region, or NULL on error.
+ */
+static void *uring_map(int fd, size_t size, off_t offset)
+{
+	void *rv = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+	return rv == MAP_FAILED ? NULL : rv;
+}
+
+/**
+ * Puts a new entry at the tail of the submission queue.
+ *
+ * @param ring io_uring instance.
+ * @param tail Local copy of the tail, advanced.
+ * @param opcode Operation.
+ * @return Cleared submission queue entry with @c opcode set.
+ */
+static struct io_uring_sqe *uring_get_sqe(uring_t *ring, unsigned *tail, unsigned char opcode)
+{
+	unsigned index = *tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = ring->sqes + index;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->user_data = opcode;
+	/* each step runs only after the previous one succeeded */
+	sqe->flags = IOSQE_IO_LINK;
+	ring->sq_array[index] = index;
+	++*tail;
+	return sqe;
+}
+
+/**************************************/
+
+uring_t *uring_create(void)
+{
+	struct io_uring_params params;
+	int files[URING_SLOT + 1];
+	uring_t *rv = calloc(1, sizeof(uring_t));
+
+	if (!rv)
+		return NULL;
+	memset(&params, 0, sizeof(params));
+	rv->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	if (rv->fd < 0) {
+		free(rv);
+		return NULL;
+	}
+	do {
+		/* opening files straight into registered slots came after this one */
+		if (!(params.features & IORING_FEAT_CQE_SKIP)) {
+			errno = ENOSYS;
+			break;
+		}
+		rv->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		rv->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP) {
+			if (rv->sq_ring_size < rv->cq_ring_size)
+				rv->sq_ring_size = rv->cq_ring_size;
+			rv->cq_ring_size = 0;
+		}
+		rv->sq_ring = uring_map(rv->fd, rv->sq_ring_size, IORING_OFF_SQ_RING);
+		if (!rv->sq_ring)
+			break;
+		if (rv->cq_ring_size) {
+			rv->cq_ring = uring_map(rv->fd, rv->cq_ring_size, IORING_OFF_CQ_RING);
+			if (!rv->cq_ring)
+				break;
+		} else {
+			rv->cq_ring = rv->sq_ring;
+		}
+		rv->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+		rv->sqes = uring_map(rv->fd, rv->sqes_size, IORING_OFF_SQES);
+		if (!rv->sqes)
+			break;
+		rv->sq_tail = (unsigned *) ((char *) rv->sq_ring + params.sq_off.tail);
+		rv->sq_mask = (unsigned *) ((char *) rv->sq_ring + params.sq_off.ring_mask);
+		rv->sq_array = (unsigned *) ((char *) rv->sq_ring + params.sq_off.array);
+		rv->cq_head = (unsigned *) ((char *) rv->cq_ring + params.cq_off.head);
+		rv->cq_tail = (unsigned *) ((char *) rv->cq_ring + params.cq_off.tail);
+		rv->cq_mask = (unsigned *) ((char *) rv->cq_ring + params.cq_off.ring_mask);
+		rv->cqes = (struct io_uring_cqe *) ((char *) rv->cq_ring + params.cq_off.cqes);
+		/* empty slot for the file being written, so that requests on it can be linked */
+		memset(files, -1, sizeof(files));
+		if (syscall(__NR_io_uring_register, rv->fd, IORING_REGISTER_FILES, files, URING_SLOT + 1))
+			break;
+		return rv;
+	} while (0);
+
+	uring_destroy(rv);
+	return NULL;
+}
+
+int uring_write(uring_t *ring, const char *path, const struct iovec *iov, unsigned count, int flags)
+{
+	struct io_uring_sqe *sqe = NULL;
+	unsigned tail = *ring->sq_tail, to_submit, pending, i;
+	size_t total = 0;
+	int error = 0;
+
+	if (flags & URING_OPEN) {
+		sqe = uring_get_sqe(ring, &tail, IORING_OP_OPENAT);
+		sqe->fd = AT_FDCWD;
+		sqe->addr = (uintptr_t) path;
+		/* files in registered slots are never inherited anyway, and O_CLOEXEC is refused */
+		sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+		sqe->len = 0666;
+		sqe->file_index = URING_SLOT + 1;
+	}
+	if (count) {
+		sqe = uring_get_sqe(ring, &tail, IORING_OP_WRITEV);
+		sqe->flags |= IOSQE_FIXED_FILE;
+		sqe->fd = URING_SLOT;
+		sqe->addr = (uintptr_t) iov;
+		sqe->len = count;
+		/* at the current file position */
+		sqe->off = (__u64) -1;
+		for (i = 0; i < count; i++)
+			total += iov[i].iov_len;
+	}
+	if (flags & URING_CLOSE) {
+		/* close the file even if writing failed */
+		if (sqe)
+			sqe->flags = (sqe->flags & ~IOSQE_IO_LINK) | IOSQE_IO_HARDLINK;
+		sqe = uring_get_sqe(ring, &tail, IORING_OP_CLOSE);
+		sqe->file_index = URING_SLOT + 1;
+	}
+	if (!sqe)
+		return 0;
+	sqe->flags &= ~(IOSQE_IO_LINK | IOSQE_IO_HARDLINK);
+
+	to_submit = pending = tail - *ring->sq_tail;
+	__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+	while (pending) {
+		unsigned head = *ring->cq_head;
+		unsigned ready = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+		if (head == ready) {
+			int rv = syscall(__NR_io_uring_enter, ring->fd, to_submit, pending, IORING_ENTER_GETEVENTS, NULL, 0);
+
+			if (rv < 0) {
+				if (errno == EINTR)
+					continue;
+				return -1;
+			}
+			to_submit -= (unsigned) rv < to_submit ? (unsigned) rv : to_submit;
+			continue;
+		}
+		for (; head != ready && pending; head++, pending--) {
+			const struct io_uring_cqe *cqe = ring->cqes + (head & *ring->cq_mask);
+
+			if (error)
+				continue;
+			if (cqe->res < 0)
+				error = -cqe->res;
+			else if (cqe->user_data == IORING_OP_WRITEV && (size_t) cqe->res != total)
+				error = EIO;
+		}
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	if (error) {
+		errno = error;
+		return -1;
+	}
+	return 0;
+}
+
+void uring_destroy(uring_t *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+	free(ring);
+}
+
+/**
+ * @}
+ */
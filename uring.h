@@ -0,0 +1,73 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	URING_H
+#define	URING_H
+
+/**
+ * @defgroup uring io_uring
+ * @{
+ * Batches writing of a file into a single system call using Linux io_uring
+ */
+
+#include <sys/uio.h>
+
+/** Opens (creates or truncates) the file before writing. */
+#define	URING_OPEN	1
+/** Closes the file after writing. */
+#define	URING_CLOSE	2
+
+/** io_uring instance. */
+typedef struct uring_t uring_t;
+
+/**
+ * Sets up an io_uring.
+ *
+ * @return io_uring instance, or NULL on error (e.g. not supported by the kernel).
+ */
+uring_t *uring_create(void);
+
+/**
+ * Writes data to a file, possibly opening it before and closing after,
+ * and waits for completion. All the steps are submitted at once and
+ * result in a single system call.
+ *
+ * Only one file can be open at a time.
+ *
+ * @param ring io_uring instance.
+ * @param path Name of the file to open; used only with @ref URING_OPEN.
+ * @param iov Buffers to write.
+ * @param count Number of entries in @c iov (may be 0).
+ * @param flags Combination of @ref URING_OPEN and @ref URING_CLOSE.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int uring_write(uring_t *ring, const char *path, const struct iovec *iov, unsigned count, int flags);
+
+/**
+ * Destroys io_uring instance.
+ *
+ * @param ring io_uring instance.
+ */
+void uring_destroy(uring_t *ring);
+
+/**
+ * @}
+ */
+
+#endif
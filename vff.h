@@ -27,6 +27,10 @@
  */
 
 #include <stdio.h>
+#include <sys/uio.h>
+
+/** Size of a frame which is not known until the frame is read completely. */
+#define	VFF_SIZE_UNKNOWN	((size_t) -1)
 
 /** Video frame filter instance. */
 typedef struct video_frame_filter_t video_frame_filter_t;
@@ -49,14 +53,17 @@ typedef struct {
 	 * Retrieves size of the video frame on the output of the filter.
 	 *
 	 * @param base Instance of a video frame filter.
-	 * @return Size of frame data on the output.
+	 * @return Size of frame data on the output, or @ref VFF_SIZE_UNKNOWN if
+	 *         the frame is processed while being read, so its size is not known
+	 *         until Read() gives the last chunk.
 	 */
 	size_t (*GetSize)(video_frame_filter_t *base);
 
 	/**
 	 * Reads video data from filter, processed from a frame passed to the last PutFrame() call.
 	 * If no more data are available (complete frame data has been already read out),
-	 * *size becomes 0.
+	 * *size becomes 0. The chunk remains valid until Read() or PutFrame() is called again.
+	 * Filters may process the frame within this call, chunk by chunk.
 	 *
 	 * @param base Instance of a video frame filter.
 	 * @param data Receives pointer to the beginning of a data chunk.
@@ -64,6 +71,19 @@ typedef struct {
 	 */
 	void (*Read)(video_frame_filter_t *base, const unsigned char **data, size_t *size);
 
+	/**
+	 * Reads video data from filter as an array of chunks, like many calls to Read() at once.
+	 * Optional (may be NULL); use @ref vff_get_chunks, which falls back to Read().
+	 * Chunks remain valid until GetChunks(), Read() or PutFrame() is called again.
+	 * Filters processing the frame while it's being read may give a part of it.
+	 *
+	 * @param base Instance of a video frame filter.
+	 * @param iov Array receiving chunks.
+	 * @param count Number of entries in @c iov (at least 1).
+	 * @return Number of chunks stored in @c iov, or 0 if no more video frame data are left.
+	 */
+	unsigned (*GetChunks)(video_frame_filter_t *base, struct iovec *iov, unsigned count);
+
 	/**
 	 * Destroys instance of video frame filter.
 	 *
@@ -76,9 +96,31 @@ typedef struct {
 /** Video frame filter instance. */
 struct video_frame_filter_t {
 	/** Video frame filter operations. */
-	video_frame_filter_ops_t *op;
+	const video_frame_filter_ops_t *op;
 };
 
+/**
+ * Reads video data from a filter as an array of chunks: as many as the
+ * filter gives at once via GetChunks(), or a single chunk given by Read().
+ *
+ * @param filter Instance of a video frame filter.
+ * @param iov Array receiving chunks.
+ * @param count Number of entries in @c iov (at least 1).
+ * @return Number of chunks stored in @c iov, or 0 if no more video frame data are left.
+ */
+static inline unsigned vff_get_chunks(video_frame_filter_t *filter, struct iovec *iov, unsigned count)
+{
+	const unsigned char *data;
+	size_t size;
+
+	if (filter->op->GetChunks)
+		return filter->op->GetChunks(filter, iov, count);
+	filter->op->Read(filter, &data, &size);
+	iov->iov_base = (void *) data;
+	iov->iov_len = size;
+	return size ? 1 : 0;
+}
+
 /**
  * @}
  */
@@ -0,0 +1,270 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vff_chain.h"
+
+/**
+ * @addtogroup vff_chain
+ * @{
+ */
+
+/**************************************/
+
+/** Single stage of a chain. */
+typedef struct {
+	const char *name;				/**< Name of the stage. */
+	video_frame_filter_t *filter;	/**< Filter of the stage. */
+	unsigned char *buffer;			/**< Output of the stage gathered from many chunks, or NULL. */
+	size_t buffer_size;				/**< Amount of space allocated for @c buffer. */
+	unsigned long long nsec;		/**< Time spent in the stage since the last report, in nanoseconds. */
+} video_frame_filter_chain_stage_t;
+
+/** Instance of a chain of video filters. */
+typedef struct {
+	video_frame_filter_t base;								/**< Base structure. */
+	char name[16];											/**< Name of the chain. */
+	unsigned count;											/**< Number of stages. */
+	video_frame_filter_chain_stage_t stage[VFF_CHAIN_MAX];	/**< Stages (@c count entries). */
+	const unsigned char *frame;								/**< Pointer to a frame provided by @ref video_frame_filter_chain_PutFrame (used if there are no stages). */
+	size_t size;											/**< Size of a frame provided by @ref video_frame_filter_chain_PutFrame (used if there are no stages). */
+	int dropped;											/**< Whether the last frame has been dropped by one of the stages. */
+	unsigned report_frames;									/**< Number of frames between reports, or 0. */
+	unsigned frames;										/**< Number of frames since the last report. */
+} video_frame_filter_chain_t;
+
+/**************************************/
+
+/**
+ * Returns current value of a monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+static unsigned long long vff_chain_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Prints average time spent in each stage and resets the statistics.
+ *
+ * @param thiz Instance of a chain.
+ */
+static void vff_chain_report(video_frame_filter_chain_t *thiz)
+{
+	unsigned i;
+
+	fprintf(stderr, "%s:", thiz->name);
+	for (i = 0; i < thiz->count; i++) {
+		fprintf(stderr, " %s %.3f ms", thiz->stage[i].name, thiz->stage[i].nsec / 1e6 / thiz->frames);
+		thiz->stage[i].nsec = 0;
+	}
+	fputc('\n', stderr);
+	thiz->frames = 0;
+}
+
+/**
+ * Collects complete output of a stage to be passed to the next one.
+ *
+ * Output consisting of a single chunk is passed by reference;
+ * multiple chunks are copied into @c stage->buffer.
+ *
+ * @param stage Stage whose output is to be collected.
+ * @param frame Receives pointer to the output.
+ * @param size Receives size of the output (0 if the stage dropped the frame).
+ */
+static void vff_chain_collect(video_frame_filter_chain_stage_t *stage, const unsigned char **frame, size_t *size)
+{
+	video_frame_filter_t *filter = stage->filter;
+	size_t total = filter->op->GetSize(filter);
+	const unsigned char *data;
+	size_t length, used;
+
+	*size = 0;
+	if (!total)
+		return;
+	filter->op->Read(filter, &data, &length);
+	if (length == total) {
+		/* zero-copy */
+		*frame = data;
+		*size = length;
+		return;
+	}
+	for (used = 0; length; filter->op->Read(filter, &data, &length)) {
+		if (stage->buffer_size < used + length) {
+			/* total size is known in advance, unless the frame is processed while being read */
+			size_t new_size = total != VFF_SIZE_UNKNOWN && total >= used + length ? total : 2 * (used + length);
+			unsigned char *buffer;
+
+			buffer = realloc(stage->buffer, new_size);
+
+			if (!buffer)
+				return;
+			stage->buffer = buffer;
+			stage->buffer_size = new_size;
+		}
+		memcpy(stage->buffer + used, data, length);
+		used += length;
+	}
+	*frame = stage->buffer;
+	*size = used;
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_chain_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) base;
+	unsigned i;
+
+	thiz->frame = frame;
+	thiz->size = size;
+	thiz->dropped = 0;
+	for (i = 0; i < thiz->count; i++) {
+		video_frame_filter_chain_stage_t *stage = &thiz->stage[i];
+		unsigned long long start = vff_chain_now();
+
+		stage->filter->op->PutFrame(stage->filter, frame, size);
+		if (i + 1 < thiz->count)
+			vff_chain_collect(stage, &frame, &size);
+		stage->nsec += vff_chain_now() - start;
+		if (!size) {
+			thiz->dropped = 1;
+			break;
+		}
+	}
+	if (thiz->report_frames && ++thiz->frames >= thiz->report_frames)
+		vff_chain_report(thiz);
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_chain_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) base;
+	video_frame_filter_t *last;
+
+	if (thiz->dropped)
+		return 0;
+	if (!thiz->count)
+		return thiz->size;
+	last = thiz->stage[thiz->count - 1].filter;
+	return last->op->GetSize(last);
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_chain_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) base;
+	video_frame_filter_chain_stage_t *stage;
+	unsigned long long start;
+
+	if (thiz->dropped || !thiz->count) {
+		*data = thiz->frame;
+		*size = thiz->dropped ? 0 : thiz->size;
+		thiz->size = 0;
+		return;
+	}
+	/* the last stage may do its work lazily, while being read */
+	stage = &thiz->stage[thiz->count - 1];
+	start = vff_chain_now();
+	stage->filter->op->Read(stage->filter, data, size);
+	stage->nsec += vff_chain_now() - start;
+}
+
+/** @copydoc video_frame_filter_ops_t::GetChunks */
+static unsigned video_frame_filter_chain_GetChunks(video_frame_filter_t *base, struct iovec *iov, unsigned count)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) base;
+	video_frame_filter_chain_stage_t *stage;
+	unsigned long long start;
+	unsigned n;
+
+	if (thiz->dropped || !thiz->count) {
+		iov->iov_base = (void *) thiz->frame;
+		iov->iov_len = thiz->dropped ? 0 : thiz->size;
+		thiz->size = 0;
+		return iov->iov_len ? 1 : 0;
+	}
+	stage = &thiz->stage[thiz->count - 1];
+	start = vff_chain_now();
+	n = vff_get_chunks(stage->filter, iov, count);
+	stage->nsec += vff_chain_now() - start;
+	return n;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_chain_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) base;
+	unsigned i;
+
+	for (i = 0; i < thiz->count; i++) {
+		thiz->stage[i].filter->op->Destroy(thiz->stage[i].filter);
+		free(thiz->stage[i].buffer);
+	}
+	free(thiz);
+}
+
+/** Operations of the chain of video filters. */
+static const video_frame_filter_ops_t video_frame_filter_chain_ops = {
+	.PutFrame = video_frame_filter_chain_PutFrame,
+	.GetSize = video_frame_filter_chain_GetSize,
+	.Read = video_frame_filter_chain_Read,
+	.GetChunks = video_frame_filter_chain_GetChunks,
+	.Destroy = video_frame_filter_chain_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_chain_create(const char *name, unsigned report_frames)
+{
+	video_frame_filter_chain_t *rv = (video_frame_filter_chain_t *) calloc(1, sizeof(video_frame_filter_chain_t));
+
+	if (!rv)
+		return NULL;
+	rv->base.op = &video_frame_filter_chain_ops;
+	snprintf(rv->name, sizeof(rv->name), "%s", name);
+	rv->report_frames = report_frames;
+	return &rv->base;
+}
+
+int vff_chain_append(video_frame_filter_t *chain, const char *name, video_frame_filter_t *stage)
+{
+	video_frame_filter_chain_t *thiz = (video_frame_filter_chain_t *) chain;
+
+	if (!stage)
+		return -1;
+	if (thiz->count >= VFF_CHAIN_MAX) {
+		stage->op->Destroy(stage);
+		return -1;
+	}
+	thiz->stage[thiz->count].name = name;
+	thiz->stage[thiz->count].filter = stage;
+	thiz->count++;
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,67 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_CHAIN_H
+#define	VFF_CHAIN_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_chain Chain of filters
+ * @{
+ * Stacks video frame filters one after another
+ */
+
+#include "vff.h"
+
+/** Maximum number of stages in a chain. */
+#define	VFF_CHAIN_MAX	8
+
+/**
+ * Creates an empty chain of video frame filters, which behaves like
+ * a NULL filter until stages are appended.
+ *
+ * Output of each stage is passed to the next stage by reference if it
+ * consists of a single chunk; otherwise chunks are gathered into
+ * a buffer owned by the chain. A stage which outputs no data (e.g.
+ * a frame dropped by decimation) ends processing of the frame.
+ *
+ * @param name Name of the chain used in reports; copied.
+ * @param report_frames Number of frames after which average time spent
+ *                      in each stage is reported on stderr, or 0 to disable reports.
+ * @return An instance of a chain of video frame filters, or NULL on error.
+ */
+video_frame_filter_t *vff_chain_create(const char *name, unsigned report_frames);
+
+/**
+ * Appends a stage to the chain.
+ *
+ * @param chain Chain created by @ref vff_chain_create.
+ * @param name Name of the stage used in reports; must remain valid as long as the chain.
+ * @param stage Video frame filter (may be NULL, what is an error); the chain takes ownership of it.
+ * @return 0 on success, other value on error (@c stage is destroyed then).
+ */
+int vff_chain_append(video_frame_filter_t *chain, const char *name, video_frame_filter_t *stage);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "vff_decimate.h"
+
+/**
+ * @addtogroup vff_decimate
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a decimation video filter. */
+typedef struct {
+	video_frame_filter_t base;	/**< Base structure. */
+	unsigned n;					/**< Every n-th frame is passed by. */
+	unsigned counter;			/**< Number of frames until the next one to be passed by. */
+	const unsigned char *frame;	/**< Pointer to a frame provided by @ref video_frame_filter_decimate_PutFrame. */
+	size_t size;				/**< Size of a frame provided by @ref video_frame_filter_decimate_PutFrame, or 0 if it's dropped. */
+} video_frame_filter_decimate_t;
+
+/**************************************/
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_decimate_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_decimate_t *thiz = (video_frame_filter_decimate_t *) base;
+
+	thiz->frame = frame;
+	if (thiz->counter) {
+		thiz->counter--;
+		thiz->size = 0;
+	} else {
+		thiz->counter = thiz->n - 1;
+		thiz->size = size;
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_decimate_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_decimate_t *thiz = (video_frame_filter_decimate_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_decimate_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_decimate_t *thiz = (video_frame_filter_decimate_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_decimate_Destroy(video_frame_filter_t *base)
+{
+	free(base);
+}
+
+/** Operations of the decimation video filter. */
+static const video_frame_filter_ops_t video_frame_filter_decimate_ops = {
+	.PutFrame = video_frame_filter_decimate_PutFrame,
+	.GetSize = video_frame_filter_decimate_GetSize,
+	.Read = video_frame_filter_decimate_Read,
+	.Destroy = video_frame_filter_decimate_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_decimate_create(unsigned n)
+{
+	video_frame_filter_decimate_t *rv;
+
+	if (!n)
+		return NULL;
+	rv = (video_frame_filter_decimate_t *) calloc(1, sizeof(video_frame_filter_decimate_t));
+	if (!rv)
+		return NULL;
+	rv->base.op = &video_frame_filter_decimate_ops;
+	rv->n = n;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,49 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_DECIMATE_H
+#define	VFF_DECIMATE_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_decimate Decimation filter
+ * @{
+ * Lowers frame rate by passing only every n-th frame
+ */
+
+#include "vff.h"
+
+/**
+ * Creates an instance of a decimation video frame filter.
+ *
+ * Frames which are not passed have size 0, so they aren't processed
+ * by subsequent stages of a chain.
+ *
+ * @param n Every n-th frame is passed by, starting from the first one.
+ * @return An instance of a decimation video frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_decimate_create(unsigned n);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
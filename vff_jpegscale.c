@@ -0,0 +1,176 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <jpeglib.h>
+#include "vff_jpegscale.h"
+#include "vff.h"
+#include "jpeg_mgr.h"
+#include "jpeg_markers.h"
+#include "jpeg_huff.h"
+
+/**
+ * @addtogroup vff_jpegscale
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a JPEG downscaling video filter. */
+typedef struct {
+	video_frame_filter_t base;				/**< Base structure. */
+	unsigned scale;							/**< Downscaling factor. */
+	unsigned quality;						/**< Quality of JPEG images, or UINT_MAX. */
+	struct jpeg_decompress_struct dinfo;	/**< jpeglib's decompress info structure. */
+	struct jpeg_compress_struct cinfo;		/**< jpeglib's compress info structure. */
+	jpeg_error_mgr_jmp_t jerr;				/**< jpeglib's error manager, shared by @c dinfo and @c cinfo. */
+	struct jpeg_source_mgr jsrc;			/**< jpeglib's source memory manager used to feed JPEG input. */
+	jpeg_destination_mgr_mem_t jdst;		/**< jpeglib's destination memory manager used to capture JPEG output. */
+	const unsigned char *frame;				/**< Pointer to the compressed downscaled frame. */
+	size_t size;							/**< Size of the compressed downscaled frame. */
+	jpeg_huff_learner_t huff;				/**< Learner of Huffman tables (disabled if its interval is 0). */
+} video_frame_filter_jpegscale_t;
+
+/**************************************/
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_jpegscale_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_jpegscale_t *thiz = (video_frame_filter_jpegscale_t *) base;
+	jpeg_markers_t markers;
+	JSAMPARRAY rows;
+
+	thiz->frame = NULL;
+	thiz->size = 0;
+	/* libjpeg would fill in the missing part of a truncated frame with gray */
+	if (jpeg_markers_scan(frame, size, &markers))
+		return;
+	if (setjmp(thiz->jerr.jmp)) {
+		jpeg_abort_decompress(&thiz->dinfo);
+		jpeg_abort_compress(&thiz->cinfo);
+		return;
+	}
+
+	jpeg_source_mgr_mem_set(&thiz->jsrc, frame, markers.length);
+	jpeg_read_header(&thiz->dinfo, TRUE);
+	jpeg_mgr_default_huff_tables(&thiz->dinfo);
+	thiz->dinfo.scale_num = 1;
+	thiz->dinfo.scale_denom = thiz->scale;
+	thiz->dinfo.out_color_space = thiz->dinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_YCbCr;
+	thiz->dinfo.dct_method = JDCT_IFAST;
+	thiz->dinfo.do_fancy_upsampling = FALSE;
+	jpeg_start_decompress(&thiz->dinfo);
+
+	thiz->cinfo.image_width = thiz->dinfo.output_width;
+	thiz->cinfo.image_height = thiz->dinfo.output_height;
+	thiz->cinfo.input_components = thiz->dinfo.output_components;
+	thiz->cinfo.in_color_space = thiz->dinfo.out_color_space;
+	jpeg_set_defaults(&thiz->cinfo);
+	if (thiz->quality != UINT_MAX)
+		jpeg_set_quality(&thiz->cinfo, thiz->quality, TRUE);
+	thiz->cinfo.dct_method = JDCT_IFAST;
+	if (thiz->huff.interval)
+		jpeg_huff_learner_apply(&thiz->huff, &thiz->cinfo);
+	jpeg_start_compress(&thiz->cinfo, TRUE);
+
+	rows = (*thiz->dinfo.mem->alloc_sarray)((j_common_ptr) &thiz->dinfo, JPOOL_IMAGE,
+		thiz->dinfo.output_width * thiz->dinfo.output_components, thiz->dinfo.rec_outbuf_height);
+	while (thiz->dinfo.output_scanline < thiz->dinfo.output_height) {
+		JDIMENSION lines = jpeg_read_scanlines(&thiz->dinfo, rows, thiz->dinfo.rec_outbuf_height);
+
+		jpeg_write_scanlines(&thiz->cinfo, rows, lines);
+	}
+
+	jpeg_finish_compress(&thiz->cinfo);
+	jpeg_finish_decompress(&thiz->dinfo);
+
+	thiz->frame = thiz->jdst.result;
+	thiz->size = thiz->jdst.length;
+	if (thiz->huff.interval)
+		jpeg_huff_learner_update(&thiz->huff, thiz->frame, thiz->size);
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_jpegscale_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_jpegscale_t *thiz = (video_frame_filter_jpegscale_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_jpegscale_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_jpegscale_t *thiz = (video_frame_filter_jpegscale_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_jpegscale_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_jpegscale_t *thiz = (video_frame_filter_jpegscale_t *) base;
+
+	jpeg_destroy_decompress(&thiz->dinfo);
+	jpeg_destroy_compress(&thiz->cinfo);
+	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
+	free(thiz);
+}
+
+/** Operations of the JPEG downscaling video filter. */
+static const video_frame_filter_ops_t video_frame_filter_jpegscale_ops = {
+	.PutFrame = video_frame_filter_jpegscale_PutFrame,
+	.GetSize = video_frame_filter_jpegscale_GetSize,
+	.Read = video_frame_filter_jpegscale_Read,
+	.Destroy = video_frame_filter_jpegscale_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_jpegscale_create(unsigned scale, unsigned quality, unsigned huff_interval)
+{
+	video_frame_filter_jpegscale_t *rv;
+
+	if (scale != 2 && scale != 4 && scale != 8) {
+		fprintf(stderr, "Unsupported JPEG scale 1/%u\n", scale);
+		return NULL;
+	}
+
+	rv = (video_frame_filter_jpegscale_t *) calloc(1, sizeof(video_frame_filter_jpegscale_t));
+	rv->scale = scale;
+	rv->quality = quality;
+	jpeg_huff_learner_init(&rv->huff, huff_interval);
+	rv->dinfo.err = jpeg_error_mgr_jmp_create(&rv->jerr);
+	rv->cinfo.err = &rv->jerr.base;
+	jpeg_create_decompress(&rv->dinfo);
+	jpeg_create_compress(&rv->cinfo);
+	rv->dinfo.src = jpeg_source_mgr_mem_create(&rv->jsrc);
+	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+
+	rv->base.op = &video_frame_filter_jpegscale_ops;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,52 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_JPEGSCALE_H
+#define	VFF_JPEGSCALE_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_jpegscale JPEG downscaling filter
+ * @{
+ * Downscales (M)JPEG frame using jpeglib's scaled decoding and compresses it again
+ */
+
+#include "vff.h"
+
+/**
+ * Creates an instance of a JPEG downscaling frame filter.
+ *
+ * Accepts both JPEG and MJPEG frames (default Huffman tables are assumed
+ * if the frame doesn't define any).
+ *
+ * @param scale Downscaling factor: 2, 4 or 8.
+ * @param quality Desired quality of JPEG images, or UINT_MAX in case of no preference.
+ * @param huff_interval Number of frames after which Huffman tables are learned again from
+ *                      compressed frames, or 0 to use the default tables.
+ * @return An instance of the JPEG downscaling frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_jpegscale_create(unsigned scale, unsigned quality, unsigned huff_interval);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include "vff_jpegtran.h"
+#include "vff.h"
+#include "jpeg_mgr.h"
+#include "jpeg_markers.h"
+
+/**
+ * @addtogroup vff_jpegtran
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a lossless JPEG transformation video filter. */
+typedef struct {
+	video_frame_filter_t base;				/**< Base structure. */
+	vff_jpegtran_op_e op;					/**< Transformation. */
+	unsigned x;								/**< Left edge of the cropped area, in pixels. */
+	unsigned y;								/**< Top edge of the cropped area, in pixels. */
+	unsigned width;							/**< Width of the cropped area, in pixels, or 0. */
+	unsigned height;						/**< Height of the cropped area, in pixels, or 0. */
+	struct jpeg_decompress_struct dinfo;	/**< jpeglib's decompress info structure. */
+	struct jpeg_compress_struct cinfo;		/**< jpeglib's compress info structure. */
+	jpeg_error_mgr_jmp_t jerr;				/**< jpeglib's error manager, shared by @c dinfo and @c cinfo. */
+	struct jpeg_source_mgr jsrc;			/**< jpeglib's source memory manager used to feed JPEG input. */
+	jpeg_destination_mgr_mem_t jdst;		/**< jpeglib's destination memory manager used to capture JPEG output. */
+	const unsigned char *frame;				/**< Pointer to the transformed frame. */
+	size_t size;							/**< Size of the transformed frame. */
+} video_frame_filter_jpegtran_t;
+
+/** Area of a frame to be transformed, in pixels. */
+typedef struct {
+	JDIMENSION x;		/**< Left edge. */
+	JDIMENSION y;		/**< Top edge. */
+	JDIMENSION width;	/**< Width. */
+	JDIMENSION height;	/**< Height. */
+} jpegtran_area_t;
+
+/**************************************/
+
+/**
+ * Checks whether a transformation swaps rows with columns.
+ *
+ * @param op Transformation.
+ * @return Non-zero if width and height of the frame are swapped.
+ */
+static int jpegtran_transposed(vff_jpegtran_op_e op)
+{
+	return op == VFF_JPEGTRAN_ROT_90 || op == VFF_JPEGTRAN_ROT_270;
+}
+
+/**
+ * Determines area of the input frame to be transformed.
+ *
+ * @param thiz Instance of a lossless JPEG transformation video filter.
+ * @param area Receives the area.
+ * @return 0 on success, -1 if the area is empty.
+ */
+static int jpegtran_area(video_frame_filter_jpegtran_t *thiz, jpegtran_area_t *area)
+{
+	JDIMENSION mcu_width = thiz->dinfo.max_h_samp_factor * DCTSIZE;
+	JDIMENSION mcu_height = thiz->dinfo.max_v_samp_factor * DCTSIZE;
+
+	area->x = thiz->x / mcu_width * mcu_width;
+	area->y = thiz->y / mcu_height * mcu_height;
+	if (area->x >= thiz->dinfo.image_width || area->y >= thiz->dinfo.image_height)
+		return -1;
+	area->width = thiz->dinfo.image_width - area->x;
+	if (thiz->width && thiz->width < area->width)
+		area->width = thiz->width;
+	area->height = thiz->dinfo.image_height - area->y;
+	if (thiz->height && thiz->height < area->height)
+		area->height = thiz->height;
+	if (thiz->op != VFF_JPEGTRAN_NONE) {
+		/* drop partial MCUs */
+		area->width = area->width / mcu_width * mcu_width;
+		area->height = area->height / mcu_height * mcu_height;
+	}
+	return area->width && area->height ? 0 : -1;
+}
+
+/**
+ * Transforms coefficients of a single block.
+ *
+ * Mirroring negates coefficients of odd horizontal (or vertical) frequencies;
+ * rotation by 90 or 270 degrees transposes the block, then mirrors it.
+ *
+ * @param op Transformation.
+ * @param dst Destination block.
+ * @param src Source block.
+ */
+static void jpegtran_block(vff_jpegtran_op_e op, JCOEF *dst, const JCOEF *src)
+{
+	int u, v;
+
+	switch (op) {
+		case VFF_JPEGTRAN_NONE:
+			memcpy(dst, src, DCTSIZE2 * sizeof(*dst));
+			break;
+		case VFF_JPEGTRAN_FLIP_H:
+			for (v = 0; v < DCTSIZE2; v++)
+				dst[v] = (v & 1) ? -src[v] : src[v];
+			break;
+		case VFF_JPEGTRAN_FLIP_V:
+			for (v = 0; v < DCTSIZE2; v++)
+				dst[v] = (v & DCTSIZE) ? -src[v] : src[v];
+			break;
+		case VFF_JPEGTRAN_ROT_180:
+			for (v = 0; v < DCTSIZE2; v++)
+				dst[v] = ((v ^ (v >> 3)) & 1) ? -src[v] : src[v];
+			break;
+		case VFF_JPEGTRAN_ROT_90:
+			for (v = 0; v < DCTSIZE; v++)
+				for (u = 0; u < DCTSIZE; u++)
+					dst[v * DCTSIZE + u] = (u & 1) ? -src[u * DCTSIZE + v] : src[u * DCTSIZE + v];
+			break;
+		case VFF_JPEGTRAN_ROT_270:
+			for (v = 0; v < DCTSIZE; v++)
+				for (u = 0; u < DCTSIZE; u++)
+					dst[v * DCTSIZE + u] = (v & 1) ? -src[u * DCTSIZE + v] : src[u * DCTSIZE + v];
+			break;
+	}
+}
+
+/**
+ * Transforms blocks of a component.
+ *
+ * @param thiz Instance of a lossless JPEG transformation video filter.
+ * @param area Area of the input frame to be transformed.
+ * @param ci Component index.
+ * @param src Virtual coefficient array of the component of the input frame.
+ * @param dst Virtual coefficient array of the component of the output frame.
+ */
+static void jpegtran_component(video_frame_filter_jpegtran_t *thiz, const jpegtran_area_t *area, int ci,
+	jvirt_barray_ptr src, jvirt_barray_ptr dst)
+{
+	j_common_ptr dinfo = (j_common_ptr) &thiz->dinfo;
+	jpeg_component_info *comp = &thiz->dinfo.comp_info[ci];
+	JDIMENSION hmax = thiz->dinfo.max_h_samp_factor * DCTSIZE, vmax = thiz->dinfo.max_v_samp_factor * DCTSIZE;
+	/* the area in blocks of the component */
+	JDIMENSION bx = area->x * comp->h_samp_factor / hmax;
+	JDIMENSION by = area->y * comp->v_samp_factor / vmax;
+	JDIMENSION bw = (area->width * comp->h_samp_factor + hmax - 1) / hmax;
+	JDIMENSION bh = (area->height * comp->v_samp_factor + vmax - 1) / vmax;
+	/* output size in blocks, padded to whole MCUs */
+	int transposed = jpegtran_transposed(thiz->op);
+	JDIMENSION ow = transposed ? bh : bw, oh = transposed ? bw : bh;
+	JDIMENSION ow_padded = ow + (transposed ? comp->v_samp_factor : comp->h_samp_factor) - 1;
+	JDIMENSION oh_padded = oh + (transposed ? comp->h_samp_factor : comp->v_samp_factor) - 1;
+	JDIMENSION x, y;
+
+	ow_padded -= ow_padded % (transposed ? comp->v_samp_factor : comp->h_samp_factor);
+	oh_padded -= oh_padded % (transposed ? comp->h_samp_factor : comp->v_samp_factor);
+	for (y = 0; y < oh_padded; y++) {
+		JBLOCKROW row = (*dinfo->mem->access_virt_barray)(dinfo, dst, y, 1, TRUE)[0];
+
+		for (x = 0; x < ow_padded; x++) {
+			JDIMENSION sx, sy;
+
+			if (x >= ow || y >= oh) {
+				/* dummy block outside of the image */
+				memset(row[x], 0, sizeof(row[x]));
+				continue;
+			}
+			switch (thiz->op) {
+				case VFF_JPEGTRAN_FLIP_H:	sx = bw - 1 - x;	sy = y;				break;
+				case VFF_JPEGTRAN_FLIP_V:	sx = x;				sy = bh - 1 - y;	break;
+				case VFF_JPEGTRAN_ROT_90:	sx = y;				sy = bh - 1 - x;	break;
+				case VFF_JPEGTRAN_ROT_180:	sx = bw - 1 - x;	sy = bh - 1 - y;	break;
+				case VFF_JPEGTRAN_ROT_270:	sx = bw - 1 - y;	sy = x;				break;
+				default:					sx = x;				sy = y;				break;
+			}
+			jpegtran_block(thiz->op, row[x],
+				(*dinfo->mem->access_virt_barray)(dinfo, src, by + sy, 1, FALSE)[0][bx + sx]);
+		}
+	}
+}
+
+/**
+ * Requests virtual coefficient arrays for the output frame.
+ * Must be called before @c jpeg_read_coefficients, which realizes them.
+ *
+ * @param thiz Instance of a lossless JPEG transformation video filter.
+ * @param area Area of the input frame to be transformed.
+ * @return Array of virtual coefficient arrays, one for each component.
+ */
+static jvirt_barray_ptr *jpegtran_request(video_frame_filter_jpegtran_t *thiz, const jpegtran_area_t *area)
+{
+	j_common_ptr dinfo = (j_common_ptr) &thiz->dinfo;
+	JDIMENSION hmax = thiz->dinfo.max_h_samp_factor * DCTSIZE, vmax = thiz->dinfo.max_v_samp_factor * DCTSIZE;
+	int transposed = jpegtran_transposed(thiz->op);
+	jvirt_barray_ptr *rv = (*dinfo->mem->alloc_small)(dinfo, JPOOL_IMAGE, thiz->dinfo.num_components * sizeof(*rv));
+	int ci;
+
+	for (ci = 0; ci < thiz->dinfo.num_components; ci++) {
+		jpeg_component_info *comp = &thiz->dinfo.comp_info[ci];
+		JDIMENSION bw = (area->width * comp->h_samp_factor + hmax - 1) / hmax;
+		JDIMENSION bh = (area->height * comp->v_samp_factor + vmax - 1) / vmax;
+		int h = transposed ? comp->v_samp_factor : comp->h_samp_factor;
+		int v = transposed ? comp->h_samp_factor : comp->v_samp_factor;
+		JDIMENSION ow = transposed ? bh : bw, oh = transposed ? bw : bh;
+
+		rv[ci] = (*dinfo->mem->request_virt_barray)(dinfo, JPOOL_IMAGE, FALSE,
+			(ow + h - 1) / h * h, (oh + v - 1) / v * v, v);
+	}
+	return rv;
+}
+
+/**
+ * Swaps rows with columns of parameters of the output frame.
+ *
+ * @param cinfo Compressor instance with parameters copied from the input frame.
+ */
+static void jpegtran_transpose_parameters(j_compress_ptr cinfo)
+{
+	JDIMENSION dim = cinfo->image_width;
+	int ci, t, u, v;
+
+	cinfo->image_width = cinfo->image_height;
+	cinfo->image_height = dim;
+	for (ci = 0; ci < cinfo->num_components; ci++) {
+		int h = cinfo->comp_info[ci].h_samp_factor;
+
+		cinfo->comp_info[ci].h_samp_factor = cinfo->comp_info[ci].v_samp_factor;
+		cinfo->comp_info[ci].v_samp_factor = h;
+	}
+	for (t = 0; t < NUM_QUANT_TBLS; t++) {
+		JQUANT_TBL *tbl = cinfo->quant_tbl_ptrs[t];
+
+		if (!tbl)
+			continue;
+		for (v = 0; v < DCTSIZE; v++)
+			for (u = v + 1; u < DCTSIZE; u++) {
+				UINT16 q = tbl->quantval[v * DCTSIZE + u];
+
+				tbl->quantval[v * DCTSIZE + u] = tbl->quantval[u * DCTSIZE + v];
+				tbl->quantval[u * DCTSIZE + v] = q;
+			}
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_jpegtran_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_jpegtran_t *thiz = (video_frame_filter_jpegtran_t *) base;
+	jpeg_markers_t markers;
+	jpegtran_area_t area;
+	jvirt_barray_ptr *src, *dst;
+	int ci;
+
+	thiz->frame = NULL;
+	thiz->size = 0;
+	/* libjpeg would fill in the missing part of a truncated frame with gray */
+	if (jpeg_markers_scan(frame, size, &markers))
+		return;
+	if (setjmp(thiz->jerr.jmp)) {
+		jpeg_abort_decompress(&thiz->dinfo);
+		jpeg_abort_compress(&thiz->cinfo);
+		return;
+	}
+
+	jpeg_source_mgr_mem_set(&thiz->jsrc, frame, markers.length);
+	jpeg_read_header(&thiz->dinfo, TRUE);
+	jpeg_mgr_default_huff_tables(&thiz->dinfo);
+	if (jpegtran_area(thiz, &area)) {
+		jpeg_abort_decompress(&thiz->dinfo);
+		return;
+	}
+	dst = jpegtran_request(thiz, &area);
+	src = jpeg_read_coefficients(&thiz->dinfo);
+	for (ci = 0; ci < thiz->dinfo.num_components; ci++)
+		jpegtran_component(thiz, &area, ci, src[ci], dst[ci]);
+
+	jpeg_copy_critical_parameters(&thiz->dinfo, &thiz->cinfo);
+	thiz->cinfo.image_width = area.width;
+	thiz->cinfo.image_height = area.height;
+	if (jpegtran_transposed(thiz->op))
+		jpegtran_transpose_parameters(&thiz->cinfo);
+	jpeg_write_coefficients(&thiz->cinfo, dst);
+
+	jpeg_finish_compress(&thiz->cinfo);
+	jpeg_finish_decompress(&thiz->dinfo);
+
+	thiz->frame = thiz->jdst.result;
+	thiz->size = thiz->jdst.length;
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_jpegtran_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_jpegtran_t *thiz = (video_frame_filter_jpegtran_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_jpegtran_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_jpegtran_t *thiz = (video_frame_filter_jpegtran_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_jpegtran_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_jpegtran_t *thiz = (video_frame_filter_jpegtran_t *) base;
+
+	jpeg_destroy_decompress(&thiz->dinfo);
+	jpeg_destroy_compress(&thiz->cinfo);
+	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
+	free(thiz);
+}
+
+/** Operations of the lossless JPEG transformation video filter. */
+static const video_frame_filter_ops_t video_frame_filter_jpegtran_ops = {
+	.PutFrame = video_frame_filter_jpegtran_PutFrame,
+	.GetSize = video_frame_filter_jpegtran_GetSize,
+	.Read = video_frame_filter_jpegtran_Read,
+	.Destroy = video_frame_filter_jpegtran_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_jpegtran_create(vff_jpegtran_op_e op, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+	video_frame_filter_jpegtran_t *rv = (video_frame_filter_jpegtran_t *) calloc(1, sizeof(video_frame_filter_jpegtran_t));
+
+	rv->op = op;
+	rv->x = x;
+	rv->y = y;
+	rv->width = width;
+	rv->height = height;
+	rv->dinfo.err = jpeg_error_mgr_jmp_create(&rv->jerr);
+	rv->cinfo.err = &rv->jerr.base;
+	jpeg_create_decompress(&rv->dinfo);
+	jpeg_create_compress(&rv->cinfo);
+	rv->dinfo.src = jpeg_source_mgr_mem_create(&rv->jsrc);
+	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+
+	rv->base.op = &video_frame_filter_jpegtran_ops;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
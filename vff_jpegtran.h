@@ -0,0 +1,65 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_JPEGTRAN_H
+#define	VFF_JPEGTRAN_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_jpegtran Lossless JPEG transformation filter
+ * @{
+ * Crops, rotates and mirrors (M)JPEG frame in DCT domain, without quality loss
+ */
+
+#include "vff.h"
+
+/** Lossless transformation of a JPEG frame. */
+typedef enum {
+	VFF_JPEGTRAN_NONE,		/**< No transformation (just crop, if requested). */
+	VFF_JPEGTRAN_FLIP_H,	/**< Mirror horizontally. */
+	VFF_JPEGTRAN_FLIP_V,	/**< Mirror vertically. */
+	VFF_JPEGTRAN_ROT_90,	/**< Rotate by 90 degrees clockwise. */
+	VFF_JPEGTRAN_ROT_180,	/**< Rotate by 180 degrees. */
+	VFF_JPEGTRAN_ROT_270,	/**< Rotate by 270 degrees clockwise. */
+} vff_jpegtran_op_e;
+
+/**
+ * Creates an instance of a lossless JPEG transformation frame filter.
+ *
+ * Frame is cropped first, then transformed. Top left corner of the cropped
+ * area is moved up and left to the nearest MCU boundary. When a frame is
+ * transformed, its partial MCUs at the right and bottom edges (if any) are
+ * dropped, since they can't be moved elsewhere.
+ *
+ * @param op Transformation.
+ * @param x Left edge of the cropped area, in pixels.
+ * @param y Top edge of the cropped area, in pixels.
+ * @param width Width of the cropped area, in pixels, or 0 to keep everything right of @c x.
+ * @param height Height of the cropped area, in pixels, or 0 to keep everything below @c y.
+ * @return An instance of the lossless JPEG transformation frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_jpegtran_create(vff_jpegtran_op_e op, unsigned x, unsigned y, unsigned width, unsigned height);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
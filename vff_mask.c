@@ -0,0 +1,239 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include "vff_mask.h"
+#include "jpeg_mgr.h"
+#include "jpeg_markers.h"
+
+/**
+ * @addtogroup vff_mask
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a JPEG privacy mask video filter. */
+typedef struct {
+	video_frame_filter_t base;				/**< Base structure. */
+	vff_mask_rect_t rects[VFF_MASK_MAX];	/**< Rectangles to be masked. */
+	unsigned count;							/**< Number of rectangles in @c rects. */
+	struct jpeg_decompress_struct dinfo;	/**< jpeglib's decompress info structure. */
+	struct jpeg_compress_struct cinfo;		/**< jpeglib's compress info structure. */
+	jpeg_error_mgr_jmp_t jerr;				/**< jpeglib's error manager, shared by @c dinfo and @c cinfo. */
+	struct jpeg_source_mgr jsrc;			/**< jpeglib's source memory manager used to feed JPEG input. */
+	jpeg_destination_mgr_mem_t jdst;		/**< jpeglib's destination memory manager used to capture JPEG output. */
+	const unsigned char *frame;				/**< Pointer to the masked frame. */
+	size_t size;							/**< Size of the masked frame. */
+} video_frame_filter_mask_t;
+
+/** Range of MCUs covered by a rectangle. */
+typedef struct {
+	JDIMENSION x0;	/**< First MCU column. */
+	JDIMENSION y0;	/**< First MCU row. */
+	JDIMENSION x1;	/**< MCU column past the last one. */
+	JDIMENSION y1;	/**< MCU row past the last one. */
+} mask_mcus_t;
+
+/**************************************/
+
+/**
+ * Finds MCUs of the current frame covered by rectangles.
+ *
+ * @param thiz Instance of a JPEG privacy mask video filter.
+ * @param mcus Receives ranges of MCUs, one for each rectangle intersecting the frame.
+ * @return Number of ranges stored in @c mcus.
+ */
+static unsigned mask_find_mcus(video_frame_filter_mask_t *thiz, mask_mcus_t *mcus)
+{
+	JDIMENSION mcu_width = thiz->dinfo.max_h_samp_factor * DCTSIZE;
+	JDIMENSION mcu_height = thiz->dinfo.max_v_samp_factor * DCTSIZE;
+	unsigned i, n = 0;
+
+	for (i = 0; i < thiz->count; i++) {
+		const vff_mask_rect_t *rect = &thiz->rects[i];
+		JDIMENSION x1 = rect->x + rect->width, y1 = rect->y + rect->height;
+
+		if (rect->x >= thiz->dinfo.image_width || rect->y >= thiz->dinfo.image_height)
+			continue;
+		if (x1 > thiz->dinfo.image_width)
+			x1 = thiz->dinfo.image_width;
+		if (y1 > thiz->dinfo.image_height)
+			y1 = thiz->dinfo.image_height;
+		mcus[n].x0 = rect->x / mcu_width;
+		mcus[n].y0 = rect->y / mcu_height;
+		mcus[n].x1 = (x1 + mcu_width - 1) / mcu_width;
+		mcus[n].y1 = (y1 + mcu_height - 1) / mcu_height;
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Replaces blocks of a component covered by given MCUs with flat ones.
+ *
+ * @param thiz Instance of a JPEG privacy mask video filter.
+ * @param coefs Virtual coefficient arrays of the frame.
+ * @param ci Component index.
+ * @param mcus Ranges of MCUs to be masked.
+ * @param n Number of ranges in @c mcus.
+ */
+static void mask_component(video_frame_filter_mask_t *thiz, jvirt_barray_ptr *coefs, int ci, const mask_mcus_t *mcus, unsigned n)
+{
+	j_common_ptr dinfo = (j_common_ptr) &thiz->dinfo;
+	jpeg_component_info *comp = &thiz->dinfo.comp_info[ci];
+	int h = comp->h_samp_factor, v = comp->v_samp_factor;
+	JCOEF dc = 0;
+	unsigned i;
+
+	if (ci == 0 && comp->quant_table) {
+		/* black luma: samples are level-shifted by 128, DC is 8 times their mean */
+		int q = comp->quant_table->quantval[0];
+
+		dc = (JCOEF) -((128 * DCTSIZE + q / 2) / q);
+	}
+	for (i = 0; i < n; i++) {
+		JDIMENSION y;
+
+		for (y = mcus[i].y0 * v; y < mcus[i].y1 * v && y < comp->height_in_blocks; y++) {
+			JBLOCKROW row = (*dinfo->mem->access_virt_barray)(dinfo, coefs[ci], y, 1, TRUE)[0];
+			JDIMENSION x;
+
+			for (x = mcus[i].x0 * h; x < mcus[i].x1 * h && x < comp->width_in_blocks; x++) {
+				memset(row[x], 0, sizeof(row[x]));
+				row[x][0] = dc;
+			}
+		}
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_mask_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_mask_t *thiz = (video_frame_filter_mask_t *) base;
+	jpeg_markers_t markers;
+	mask_mcus_t mcus[VFF_MASK_MAX];
+	jvirt_barray_ptr *coefs;
+	unsigned n;
+	int ci;
+
+	thiz->frame = NULL;
+	thiz->size = 0;
+	/* libjpeg would fill in the missing part of a truncated frame with gray */
+	if (jpeg_markers_scan(frame, size, &markers))
+		return;
+	if (setjmp(thiz->jerr.jmp)) {
+		jpeg_abort_decompress(&thiz->dinfo);
+		jpeg_abort_compress(&thiz->cinfo);
+		return;
+	}
+
+	jpeg_source_mgr_mem_set(&thiz->jsrc, frame, markers.length);
+	jpeg_read_header(&thiz->dinfo, TRUE);
+	n = mask_find_mcus(thiz, mcus);
+	if (!n) {
+		/* nothing to hide */
+		jpeg_abort_decompress(&thiz->dinfo);
+		thiz->frame = frame;
+		thiz->size = markers.length;
+		return;
+	}
+	jpeg_mgr_default_huff_tables(&thiz->dinfo);
+	coefs = jpeg_read_coefficients(&thiz->dinfo);
+	for (ci = 0; ci < thiz->dinfo.num_components; ci++)
+		mask_component(thiz, coefs, ci, mcus, n);
+
+	jpeg_copy_critical_parameters(&thiz->dinfo, &thiz->cinfo);
+	jpeg_write_coefficients(&thiz->cinfo, coefs);
+
+	jpeg_finish_compress(&thiz->cinfo);
+	jpeg_finish_decompress(&thiz->dinfo);
+
+	thiz->frame = thiz->jdst.result;
+	thiz->size = thiz->jdst.length;
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_mask_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_mask_t *thiz = (video_frame_filter_mask_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_mask_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_mask_t *thiz = (video_frame_filter_mask_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_mask_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_mask_t *thiz = (video_frame_filter_mask_t *) base;
+
+	jpeg_destroy_decompress(&thiz->dinfo);
+	jpeg_destroy_compress(&thiz->cinfo);
+	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
+	free(thiz);
+}
+
+/** Operations of the JPEG privacy mask video filter. */
+static const video_frame_filter_ops_t video_frame_filter_mask_ops = {
+	.PutFrame = video_frame_filter_mask_PutFrame,
+	.GetSize = video_frame_filter_mask_GetSize,
+	.Read = video_frame_filter_mask_Read,
+	.Destroy = video_frame_filter_mask_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_mask_create(const vff_mask_rect_t *rects, unsigned count)
+{
+	video_frame_filter_mask_t *rv;
+
+	if (!count || count > VFF_MASK_MAX) {
+		fprintf(stderr, "Expected 1 to %u masked rectangles, got %u\n", VFF_MASK_MAX, count);
+		return NULL;
+	}
+
+	rv = (video_frame_filter_mask_t *) calloc(1, sizeof(video_frame_filter_mask_t));
+	memcpy(rv->rects, rects, count * sizeof(*rects));
+	rv->count = count;
+	rv->dinfo.err = jpeg_error_mgr_jmp_create(&rv->jerr);
+	rv->cinfo.err = &rv->jerr.base;
+	jpeg_create_decompress(&rv->dinfo);
+	jpeg_create_compress(&rv->cinfo);
+	rv->dinfo.src = jpeg_source_mgr_mem_create(&rv->jsrc);
+	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+
+	rv->base.op = &video_frame_filter_mask_ops;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,63 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_MASK_H
+#define	VFF_MASK_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_mask JPEG privacy mask filter
+ * @{
+ * Blacks out rectangles of (M)JPEG frame in DCT domain, without decompressing it
+ */
+
+#include "vff.h"
+
+/** Maximum number of masked rectangles. */
+#define	VFF_MASK_MAX	16
+
+/** Rectangle to be masked, in pixels. */
+typedef struct {
+	unsigned x;			/**< Left edge. */
+	unsigned y;			/**< Top edge. */
+	unsigned width;		/**< Width. */
+	unsigned height;	/**< Height. */
+} vff_mask_rect_t;
+
+/**
+ * Creates an instance of a JPEG privacy mask frame filter.
+ *
+ * Every MCU of incoming JPEG or MJPEG frames which intersects any of given
+ * rectangles gets its coefficients replaced with flat black blocks. Other
+ * coefficients are left intact, and the frame is entropy-coded again.
+ * Frames not intersecting any rectangle are passed as they are.
+ *
+ * @param rects Array of rectangles to be masked.
+ * @param count Number of rectangles (up to @ref VFF_MASK_MAX).
+ * @return An instance of the JPEG privacy mask frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_mask_create(const vff_mask_rect_t *rects, unsigned count);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
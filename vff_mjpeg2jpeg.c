@@ -17,20 +17,24 @@
  * along with webcam. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "vff.h"
 #include "vff_mjpeg2jpeg.h"
+#include "jpeg_markers.h"
 
 /**
  * @addtogroup vff_mjpeg2jpeg
  * @{
  */
 
+/** An invalid frame is reported only once per this many of them. */
+#define MJPEG_INVALID_REPORT_INTERVAL	100
+
 /**************************************/
 
-/** Missing chunk to be added to a MJPEG frame. */
-static const unsigned char video_frame_filter_mjpeg_missing_chunk[] = {
+const unsigned char video_frame_filter_mjpeg_missing_chunk[] = {
 	0xFF, 0xC4, 0x01, 0xA2, 0x00,
 	0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
 	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
@@ -99,8 +103,10 @@ typedef struct {
 		CHUNK_FINISHED,		/**< Will provide empty chunk to indicate end of frame. */
 	} chunk;
 	const unsigned char *frame;	/**< Pointer to a frame passed to @ref video_frame_filter_mjpeg_PutFrame. */
-	size_t size;				/**< Size of a frame passed to @ref video_frame_filter_mjpeg_PutFrame. */
-	unsigned header_length;		/**< Offset inside @c frame where @ref CHUNK_MISSING jumps in. */
+	size_t size;				/**< Size of a frame passed to @ref video_frame_filter_mjpeg_PutFrame, up to EOI marker. */
+	size_t header_length;		/**< Offset inside @c frame where @ref CHUNK_MISSING jumps in. */
+	int missing;				/**< Whether @ref CHUNK_MISSING is inserted into the frame. */
+	unsigned long invalid;		/**< Number of invalid frames dropped so far. */
 } video_frame_filter_mjpeg_t;
 
 /**************************************/
@@ -109,40 +115,26 @@ typedef struct {
 static void video_frame_filter_mjpeg_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
 {
 	video_frame_filter_mjpeg_t *thiz = (video_frame_filter_mjpeg_t *) base;
+	jpeg_markers_t markers;
+
+	if (jpeg_markers_scan(frame, size, &markers)) {
+		/* a flaky camera may keep sending those, don't flood the log */
+		if (thiz->invalid++ % MJPEG_INVALID_REPORT_INTERVAL == 0)
+			fprintf(stderr, "Invalid MJPEG frame data (size=%zu, %lu dropped so far)\n", size, thiz->invalid);
+		thiz->chunk = CHUNK_FINISHED;
+		thiz->frame = NULL;
+		thiz->size = 0;
+		thiz->missing = 0;
+		return;
+	}
 
-	/* check header */
-	do {
-		static const unsigned char hdr1[] = { 0xFF, 0xD8, 0xFF, 0xE0 };
-		static const unsigned char hdr2[] = "AVI1"; /* null-terminated */
-		unsigned hdr1_length;
-
-		if (size < 12)
-			break;
-		if (memcmp(frame, hdr1, sizeof(hdr1)))
-			break;
-		hdr1_length = (frame[4] << 8) | frame[5];
-		if (hdr1_length < 5)
-			break;
-		if (memcmp(frame + 6, hdr2, sizeof(hdr2)))
-			break;
-
-		thiz->chunk = CHUNK_HEADER;
-		thiz->header_length = 4 + hdr1_length;
-		thiz->frame = frame;
-		thiz->size = size;
-		return;	/* success */
-	} while (0);
-
-	/*
-	fprintf(stderr, "Invalid MJPEG frame data (size=%tu)\n", size);
-	thiz->chunk = CHUNK_FINISHED;
-	thiz->frame = NULL;
-	thiz->size = 0;
-	*/
-	thiz->chunk = CHUNK_REMAINDER;
-	thiz->header_length = 0;
+	/* insert Huffman tables right before SOS, unless they're already there */
+	thiz->missing = !markers.has_dht;
+	thiz->chunk = thiz->missing ? CHUNK_HEADER : CHUNK_REMAINDER;
+	thiz->header_length = thiz->missing ? markers.sos : 0;
 	thiz->frame = frame;
-	thiz->size = size;
+	/* drop padding after EOI */
+	thiz->size = markers.length;
 }
 
 /** @copydoc video_frame_filter_ops_t::GetSize */
@@ -150,7 +142,7 @@ static size_t video_frame_filter_mjpeg_GetSize(video_frame_filter_t *base)
 {
 	video_frame_filter_mjpeg_t *thiz = (video_frame_filter_mjpeg_t *) base;
 
-	return thiz->size ? thiz->size + sizeof(video_frame_filter_mjpeg_missing_chunk) : 0;
+	return thiz->missing ? thiz->size + sizeof(video_frame_filter_mjpeg_missing_chunk) : thiz->size;
 }
 
 /** @copydoc video_frame_filter_ops_t::Read */
@@ -181,6 +173,35 @@ static void video_frame_filter_mjpeg_Read(video_frame_filter_t *base, const unsi
 	}
 }
 
+/** @copydoc video_frame_filter_ops_t::GetChunks */
+static unsigned video_frame_filter_mjpeg_GetChunks(video_frame_filter_t *base, struct iovec *iov, unsigned count)
+{
+	video_frame_filter_mjpeg_t *thiz = (video_frame_filter_mjpeg_t *) base;
+	const unsigned char *data = NULL;
+	size_t size = 0;
+	unsigned n = 0;
+
+	if (thiz->chunk == CHUNK_FINISHED)
+		return 0;
+	if (thiz->chunk != CHUNK_HEADER || count < 3) {
+		/* somebody has already started reading, or there's not enough room */
+		video_frame_filter_mjpeg_Read(base, &data, &size);
+		iov->iov_base = (void *) data;
+		iov->iov_len = size;
+		return 1;
+	}
+	if (thiz->missing) {
+		iov[n].iov_base = (void *) thiz->frame;
+		iov[n++].iov_len = thiz->header_length;
+		iov[n].iov_base = (void *) video_frame_filter_mjpeg_missing_chunk;
+		iov[n++].iov_len = sizeof(video_frame_filter_mjpeg_missing_chunk);
+	}
+	iov[n].iov_base = (void *) (thiz->frame + thiz->header_length);
+	iov[n++].iov_len = thiz->size - thiz->header_length;
+	thiz->chunk = CHUNK_FINISHED;
+	return n;
+}
+
 /** @copydoc video_frame_filter_ops_t::Destroy */
 static void video_frame_filter_mjpeg_Destroy(video_frame_filter_t *base)
 {
@@ -190,10 +211,11 @@ static void video_frame_filter_mjpeg_Destroy(video_frame_filter_t *base)
 }
 
 /** Operations of the MJPEG to JPEG filter. */
-video_frame_filter_ops_t video_frame_filter_mjpeg_ops = {
+static const video_frame_filter_ops_t video_frame_filter_mjpeg_ops = {
 	.PutFrame = video_frame_filter_mjpeg_PutFrame,
 	.GetSize = video_frame_filter_mjpeg_GetSize,
 	.Read = video_frame_filter_mjpeg_Read,
+	.GetChunks = video_frame_filter_mjpeg_GetChunks,
 	.Destroy = video_frame_filter_mjpeg_Destroy,
 };
 
@@ -30,9 +30,19 @@
 
 #include "vff.h"
 
+/**
+ * Missing chunk to be added to a MJPEG frame: DHT marker segment with
+ * the default Huffman tables.
+ */
+extern const unsigned char video_frame_filter_mjpeg_missing_chunk[];
+
 /**
  * Creates an instance of a MJPEG to JPEG video frame filter.
  *
+ * Huffman tables are inserted into frames which don't have them.
+ * Padding after EOI marker is dropped. Corrupt or truncated frames
+ * are dropped altogether (output size is 0).
+ *
  * @return An instance of a MJPEG to JPEG video frame filter, or NULL on error.
  */
 video_frame_filter_t *vff_mjpeg2jpeg_create(void);
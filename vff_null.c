@@ -73,7 +73,7 @@ static void video_frame_filter_null_Destroy(video_frame_filter_t *base)
 }
 
 /** Operations of the NULL video filter. */
-video_frame_filter_ops_t video_frame_filter_null_ops = {
+static const video_frame_filter_ops_t video_frame_filter_null_ops = {
 	.PutFrame = video_frame_filter_null_PutFrame,
 	.GetSize = video_frame_filter_null_GetSize,
 	.Read = video_frame_filter_null_Read,
@@ -0,0 +1,307 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <jpeglib.h>
+#include "vff_requant.h"
+#include "vff.h"
+#include "jpeg_mgr.h"
+#include "jpeg_markers.h"
+#include "jpeg_huff.h"
+
+/**
+ * @addtogroup vff_requant
+ * @{
+ */
+
+/**************************************/
+
+/** Lowest quality the filter falls back to when chasing target size. */
+#define	REQUANT_MIN_QUALITY	10
+
+/** Instance of a JPEG requantization video filter. */
+typedef struct {
+	video_frame_filter_t base;				/**< Base structure. */
+	unsigned max_quality;					/**< Quality requested by the user. */
+	unsigned quality;						/**< Quality used for the next frame. */
+	size_t target_size;						/**< Desired size of output frame, or 0. */
+	struct jpeg_decompress_struct dinfo;	/**< jpeglib's decompress info structure. */
+	struct jpeg_compress_struct cinfo;		/**< jpeglib's compress info structure. */
+	jpeg_error_mgr_jmp_t jerr;				/**< jpeglib's error manager, shared by @c dinfo and @c cinfo. */
+	struct jpeg_source_mgr jsrc;			/**< jpeglib's source memory manager used to feed JPEG input. */
+	jpeg_destination_mgr_mem_t jdst;		/**< jpeglib's destination memory manager used to capture JPEG output. */
+	const unsigned char *frame;				/**< Pointer to the requantized frame. */
+	size_t size;							/**< Size of the requantized frame. */
+	jpeg_huff_learner_t huff;				/**< Learner of Huffman tables (disabled if its interval is 0). */
+	const roi_t *roi;						/**< Regions of interest, or NULL. */
+	unsigned char keep[DCTSIZE2];			/**< Whether each coefficient (in natural order) is kept in blocks outside regions of interest. */
+} video_frame_filter_requant_t;
+
+/** Natural order of coefficients in zigzag sequence. */
+static const unsigned char requant_natural_order[DCTSIZE2] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+/**************************************/
+
+/**
+ * Sets up quantization tables of the output frame.
+ *
+ * Tables derived from @c quality replace the ones copied from the input frame,
+ * but no entry is made finer than it was in the input frame.
+ *
+ * @param thiz Instance of a JPEG requantization video filter.
+ * @return Non-zero if any table has changed (requantization is needed).
+ */
+static int requant_set_tables(video_frame_filter_requant_t *thiz)
+{
+	UINT16 old[NUM_QUANT_TBLS][DCTSIZE2];
+	int t, k, changed = 0;
+
+	for (t = 0; t < NUM_QUANT_TBLS; t++)
+		if (thiz->dinfo.quant_tbl_ptrs[t])
+			memcpy(old[t], thiz->dinfo.quant_tbl_ptrs[t]->quantval, sizeof(old[t]));
+	jpeg_set_quality(&thiz->cinfo, thiz->quality, TRUE);
+	for (t = 0; t < NUM_QUANT_TBLS; t++) {
+		JQUANT_TBL *tbl = thiz->cinfo.quant_tbl_ptrs[t];
+
+		if (!thiz->dinfo.quant_tbl_ptrs[t] || !tbl)
+			continue;
+		for (k = 0; k < DCTSIZE2; k++) {
+			if (tbl->quantval[k] < old[t][k])
+				tbl->quantval[k] = old[t][k];
+			else if (tbl->quantval[k] > old[t][k])
+				changed = 1;
+		}
+	}
+	return changed;
+}
+
+/**
+ * Scales quantized DCT coefficients of a component from input to output quantization table.
+ *
+ * @param thiz Instance of a JPEG requantization video filter.
+ * @param coefs Virtual coefficient arrays of the input frame.
+ * @param ci Component index.
+ */
+static void requant_component(video_frame_filter_requant_t *thiz, jvirt_barray_ptr *coefs, int ci)
+{
+	jpeg_component_info *comp = &thiz->dinfo.comp_info[ci];
+	const UINT16 *oq = thiz->dinfo.quant_tbl_ptrs[comp->quant_tbl_no]->quantval;
+	const UINT16 *nq = thiz->cinfo.quant_tbl_ptrs[comp->quant_tbl_no]->quantval;
+	JDIMENSION row, col;
+	int k;
+
+	if (!memcmp(oq, nq, DCTSIZE2 * sizeof(*oq)))
+		return;
+	for (row = 0; row < comp->height_in_blocks; row += comp->v_samp_factor) {
+		JBLOCKARRAY blocks = (*thiz->dinfo.mem->access_virt_barray)((j_common_ptr) &thiz->dinfo,
+			coefs[ci], row, comp->v_samp_factor, TRUE);
+		int r;
+
+		for (r = 0; r < comp->v_samp_factor && row + r < comp->height_in_blocks; r++) {
+			for (col = 0; col < comp->width_in_blocks; col++) {
+				JCOEF *block = blocks[r][col];
+
+				for (k = 0; k < DCTSIZE2; k++) {
+					long v = (long) block[k] * oq[k];
+
+					block[k] = (JCOEF) (v >= 0 ? (v + nq[k] / 2) / nq[k] : -((-v + nq[k] / 2) / nq[k]));
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Zeroes high frequency coefficients of blocks of a component which are
+ * outside regions of interest.
+ *
+ * @param thiz Instance of a JPEG requantization video filter.
+ * @param coefs Virtual coefficient arrays of the input frame.
+ * @param ci Component index.
+ */
+static void requant_roi_component(video_frame_filter_requant_t *thiz, jvirt_barray_ptr *coefs, int ci)
+{
+	jpeg_component_info *comp = &thiz->dinfo.comp_info[ci];
+	unsigned block_width = DCTSIZE * thiz->dinfo.max_h_samp_factor / comp->h_samp_factor;
+	unsigned block_height = DCTSIZE * thiz->dinfo.max_v_samp_factor / comp->v_samp_factor;
+	JDIMENSION row, col;
+	int k;
+
+	for (row = 0; row < comp->height_in_blocks; row++) {
+		JBLOCKROW blocks = (*thiz->dinfo.mem->access_virt_barray)((j_common_ptr) &thiz->dinfo,
+			coefs[ci], row, 1, TRUE)[0];
+
+		for (col = 0; col < comp->width_in_blocks; col++) {
+			if (roi_contains(thiz->roi, col * block_width, row * block_height, block_width, block_height))
+				continue;
+			for (k = 1; k < DCTSIZE2; k++)
+				if (!thiz->keep[k])
+					blocks[col][k] = 0;
+		}
+	}
+}
+
+/**
+ * Adjusts quality for the next frame, so its size gets closer to the target.
+ *
+ * @param thiz Instance of a JPEG requantization video filter.
+ */
+static void requant_adjust_quality(video_frame_filter_requant_t *thiz)
+{
+	long error;
+
+	if (!thiz->target_size)
+		return;
+	/* deviation from the target in 1/16 of it */
+	error = ((long) thiz->size - (long) thiz->target_size) * 16 / (long) thiz->target_size;
+	if (error > 1) {
+		unsigned step = error > 10 ? 10 : error;
+
+		thiz->quality = thiz->quality > REQUANT_MIN_QUALITY + step ? thiz->quality - step : REQUANT_MIN_QUALITY;
+	} else if (error < -2 && thiz->quality < thiz->max_quality) {
+		thiz->quality++;
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_requant_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_requant_t *thiz = (video_frame_filter_requant_t *) base;
+	jpeg_markers_t markers;
+	jvirt_barray_ptr *coefs;
+	int ci;
+
+	thiz->frame = NULL;
+	thiz->size = 0;
+	/* libjpeg would fill in the missing part of a truncated frame with gray */
+	if (jpeg_markers_scan(frame, size, &markers))
+		return;
+	if (setjmp(thiz->jerr.jmp)) {
+		jpeg_abort_decompress(&thiz->dinfo);
+		jpeg_abort_compress(&thiz->cinfo);
+		return;
+	}
+
+	jpeg_source_mgr_mem_set(&thiz->jsrc, frame, markers.length);
+	jpeg_read_header(&thiz->dinfo, TRUE);
+	jpeg_mgr_default_huff_tables(&thiz->dinfo);
+	coefs = jpeg_read_coefficients(&thiz->dinfo);
+
+	jpeg_copy_critical_parameters(&thiz->dinfo, &thiz->cinfo);
+	if (requant_set_tables(thiz))
+		for (ci = 0; ci < thiz->dinfo.num_components; ci++)
+			requant_component(thiz, coefs, ci);
+	if (thiz->roi)
+		for (ci = 0; ci < thiz->dinfo.num_components; ci++)
+			requant_roi_component(thiz, coefs, ci);
+	if (thiz->huff.interval)
+		jpeg_huff_learner_apply(&thiz->huff, &thiz->cinfo);
+	jpeg_write_coefficients(&thiz->cinfo, coefs);
+
+	jpeg_finish_compress(&thiz->cinfo);
+	jpeg_finish_decompress(&thiz->dinfo);
+
+	thiz->frame = thiz->jdst.result;
+	thiz->size = thiz->jdst.length;
+	if (thiz->huff.interval)
+		jpeg_huff_learner_update(&thiz->huff, thiz->frame, thiz->size);
+	requant_adjust_quality(thiz);
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_requant_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_requant_t *thiz = (video_frame_filter_requant_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_requant_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_requant_t *thiz = (video_frame_filter_requant_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_requant_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_requant_t *thiz = (video_frame_filter_requant_t *) base;
+
+	jpeg_destroy_decompress(&thiz->dinfo);
+	jpeg_destroy_compress(&thiz->cinfo);
+	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
+	free(thiz);
+}
+
+/** Operations of the JPEG requantization video filter. */
+static const video_frame_filter_ops_t video_frame_filter_requant_ops = {
+	.PutFrame = video_frame_filter_requant_PutFrame,
+	.GetSize = video_frame_filter_requant_GetSize,
+	.Read = video_frame_filter_requant_Read,
+	.Destroy = video_frame_filter_requant_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_requant_create(unsigned quality, size_t target_size, unsigned huff_interval, const roi_t *roi, unsigned cutoff)
+{
+	video_frame_filter_requant_t *rv;
+	unsigned k;
+
+	if (quality < 1 || quality > 100) {
+		fprintf(stderr, "Unsupported JPEG quality %u\n", quality);
+		return NULL;
+	}
+
+	rv = (video_frame_filter_requant_t *) calloc(1, sizeof(video_frame_filter_requant_t));
+	rv->max_quality = rv->quality = quality;
+	rv->target_size = target_size;
+	jpeg_huff_learner_init(&rv->huff, huff_interval);
+	rv->roi = roi;
+	for (k = 0; k < DCTSIZE2; k++)
+		rv->keep[requant_natural_order[k]] = k < cutoff;
+	rv->dinfo.err = jpeg_error_mgr_jmp_create(&rv->jerr);
+	rv->cinfo.err = &rv->jerr.base;
+	jpeg_create_decompress(&rv->dinfo);
+	jpeg_create_compress(&rv->cinfo);
+	rv->dinfo.src = jpeg_source_mgr_mem_create(&rv->jsrc);
+	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+
+	rv->base.op = &video_frame_filter_requant_ops;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
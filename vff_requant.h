@@ -0,0 +1,60 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_REQUANT_H
+#define	VFF_REQUANT_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_requant JPEG requantization filter
+ * @{
+ * Lowers quality of (M)JPEG frame in DCT domain, without decompressing it
+ */
+
+#include <stddef.h>
+#include "vff.h"
+#include "roi.h"
+
+/**
+ * Creates an instance of a JPEG requantization frame filter.
+ *
+ * Quantized DCT coefficients of incoming JPEG or MJPEG frames are scaled
+ * to coarser quantization tables and entropy-coded again. Frames which
+ * are already quantized coarser than requested are not made finer.
+ *
+ * @param quality Desired quality of JPEG images (the highest one if @c target_size is given).
+ * @param target_size Desired size of JPEG images in bytes, or 0 if quality should stay fixed.
+ *                    Quality is adjusted frame by frame to reach it.
+ * @param huff_interval Number of frames after which Huffman tables are learned again from
+ *                      requantized frames, or 0 to use the default tables.
+ * @param roi Regions of interest, or NULL. Blocks outside them lose coefficients
+ *            beyond @c cutoff, so they cost less, but the frame is still a baseline JPEG.
+ * @param cutoff Number of coefficients (in zigzag order, DC included) kept in blocks
+ *               outside regions of interest.
+ * @return An instance of the JPEG requantization frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_requant_create(unsigned quality, size_t target_size, unsigned huff_interval, const roi_t *roi, unsigned cutoff);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
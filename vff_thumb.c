@@ -0,0 +1,182 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <jpeglib.h>
+#include "vff_thumb.h"
+#include "jpeg_huff.h"
+#include "jpeg_mgr.h"
+#include "jpeg_markers.h"
+
+/**
+ * @addtogroup vff_thumb
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a JPEG thumbnail video filter. */
+typedef struct {
+	video_frame_filter_t base;				/**< Base structure. */
+	unsigned quality;						/**< Quality of JPEG images, or UINT_MAX. */
+	jpeg_huff_dc_image_t image;				/**< DC image of the last frame. */
+	struct jpeg_compress_struct cinfo;		/**< jpeglib's compress info structure. */
+	jpeg_error_mgr_jmp_t jerr;				/**< jpeglib's error manager. */
+	jpeg_destination_mgr_mem_t jdst;		/**< jpeglib's destination memory manager used to capture JPEG output. */
+	const unsigned char *frame;				/**< Pointer to the thumbnail. */
+	size_t size;							/**< Size of the thumbnail. */
+} video_frame_filter_thumb_t;
+
+/**************************************/
+
+/**
+ * Assembles a row of the thumbnail out of components of the DC image.
+ * Subsampled components are replicated.
+ *
+ * @param image DC image.
+ * @param y Row number.
+ * @param row Receives interleaved samples.
+ */
+static void thumb_row(const jpeg_huff_dc_image_t *image, unsigned y, JSAMPLE *row)
+{
+	unsigned hmax = 1, vmax = 1, c, x;
+
+	for (c = 0; c < image->components; c++) {
+		if (hmax < image->comp[c].h)
+			hmax = image->comp[c].h;
+		if (vmax < image->comp[c].v)
+			vmax = image->comp[c].v;
+	}
+	for (c = 0; c < image->components; c++) {
+		const unsigned char *src = image->samples + image->comp[c].offset
+			+ (size_t) (y * image->comp[c].v / vmax) * image->comp[c].stride;
+		JSAMPLE *dst = row + c;
+
+		if (image->comp[c].h == hmax) {
+			for (x = 0; x < image->width; x++, dst += image->components)
+				*dst = src[x];
+		} else {
+			for (x = 0; x < image->width; x++, dst += image->components)
+				*dst = src[x * image->comp[c].h / hmax];
+		}
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_thumb_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_thumb_t *thiz = (video_frame_filter_thumb_t *) base;
+	jpeg_markers_t markers;
+	JSAMPARRAY row;
+
+	thiz->frame = NULL;
+	thiz->size = 0;
+	/* a truncated frame would yield a partly flat thumbnail */
+	if (jpeg_markers_scan(frame, size, &markers))
+		return;
+	if (jpeg_huff_dc_image(frame, markers.length, &thiz->image))
+		return;
+	if (thiz->image.components != 1 && thiz->image.components != 3)
+		return;
+	if (setjmp(thiz->jerr.jmp)) {
+		jpeg_abort_compress(&thiz->cinfo);
+		return;
+	}
+
+	thiz->cinfo.image_width = thiz->image.width;
+	thiz->cinfo.image_height = thiz->image.height;
+	thiz->cinfo.input_components = thiz->image.components;
+	thiz->cinfo.in_color_space = thiz->image.components == 1 ? JCS_GRAYSCALE : JCS_YCbCr;
+	jpeg_set_defaults(&thiz->cinfo);
+	if (thiz->quality != UINT_MAX)
+		jpeg_set_quality(&thiz->cinfo, thiz->quality, TRUE);
+	/* a second pass over such a small image costs next to nothing */
+	thiz->cinfo.optimize_coding = TRUE;
+	jpeg_start_compress(&thiz->cinfo, TRUE);
+
+	row = (*thiz->cinfo.mem->alloc_sarray)((j_common_ptr) &thiz->cinfo, JPOOL_IMAGE,
+		thiz->image.width * thiz->image.components, 1);
+	while (thiz->cinfo.next_scanline < thiz->cinfo.image_height) {
+		thumb_row(&thiz->image, thiz->cinfo.next_scanline, row[0]);
+		jpeg_write_scanlines(&thiz->cinfo, row, 1);
+	}
+
+	jpeg_finish_compress(&thiz->cinfo);
+
+	thiz->frame = thiz->jdst.result;
+	thiz->size = thiz->jdst.length;
+}
+
+/** @copydoc video_frame_filter_ops_t::GetSize */
+static size_t video_frame_filter_thumb_GetSize(video_frame_filter_t *base)
+{
+	video_frame_filter_thumb_t *thiz = (video_frame_filter_thumb_t *) base;
+
+	return thiz->size;
+}
+
+/** @copydoc video_frame_filter_ops_t::Read */
+static void video_frame_filter_thumb_Read(video_frame_filter_t *base, const unsigned char **data, size_t *size)
+{
+	video_frame_filter_thumb_t *thiz = (video_frame_filter_thumb_t *) base;
+
+	*data = thiz->frame;
+	*size = thiz->size;
+	thiz->size = 0;
+}
+
+/** @copydoc video_frame_filter_ops_t::Destroy */
+static void video_frame_filter_thumb_Destroy(video_frame_filter_t *base)
+{
+	video_frame_filter_thumb_t *thiz = (video_frame_filter_thumb_t *) base;
+
+	jpeg_destroy_compress(&thiz->cinfo);
+	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
+	jpeg_huff_dc_image_free(&thiz->image);
+	free(thiz);
+}
+
+/** Operations of the JPEG thumbnail video filter. */
+static const video_frame_filter_ops_t video_frame_filter_thumb_ops = {
+	.PutFrame = video_frame_filter_thumb_PutFrame,
+	.GetSize = video_frame_filter_thumb_GetSize,
+	.Read = video_frame_filter_thumb_Read,
+	.Destroy = video_frame_filter_thumb_Destroy,
+};
+
+/**************************************/
+
+video_frame_filter_t *vff_thumb_create(unsigned quality)
+{
+	video_frame_filter_thumb_t *rv = (video_frame_filter_thumb_t *) calloc(1, sizeof(video_frame_filter_thumb_t));
+
+	rv->quality = quality;
+	rv->cinfo.err = jpeg_error_mgr_jmp_create(&rv->jerr);
+	jpeg_create_compress(&rv->cinfo);
+	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+
+	rv->base.op = &video_frame_filter_thumb_ops;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
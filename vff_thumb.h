@@ -0,0 +1,50 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFF_THUMB_H
+#define	VFF_THUMB_H
+
+/**
+ * @addtogroup vff
+ * @{
+ * @defgroup vff_thumb JPEG thumbnail filter
+ * @{
+ * Makes 1/8 scale thumbnail of (M)JPEG frame out of its DC coefficients
+ */
+
+#include "vff.h"
+
+/**
+ * Creates an instance of a JPEG thumbnail frame filter.
+ *
+ * Only DC coefficients of incoming JPEG or MJPEG frames are decoded (see
+ * @ref jpeg_huff_dc_image), and the resulting 1/8 scale image is compressed
+ * again. This is way cheaper than scaled decoding of the whole frame.
+ *
+ * @param quality Desired quality of JPEG images, or UINT_MAX in case of no preference.
+ * @return An instance of the JPEG thumbnail frame filter, or NULL on error.
+ */
+video_frame_filter_t *vff_thumb_create(unsigned quality);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
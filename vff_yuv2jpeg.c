@@ -23,8 +23,15 @@
 #include <limits.h>
 #include <jpeglib.h>
 #include <jerror.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
 #include "vff_yuv2jpeg.h"
 #include "vff.h"
+#include "jpeg_mgr.h"
+#include "jpeg_huff.h"
+#include "bayer.h"
+#include "roi.h"
 
 /**
  * @addtogroup vff_yuv2jpeg
@@ -33,138 +40,704 @@
 
 /**************************************/
 
-/** Custom destination memory manager for capturing compressed JPEG from jpeglib. */
+/** Quality is lowered by the governor in steps of this size. */
+#define	GOVERNOR_QUALITY_STEP	10
+/** Quality is never lowered by the governor below this value. */
+#define	GOVERNOR_MIN_QUALITY	30
+/** Maximum number of frames out of which only one is compressed by the governor. */
+#define	GOVERNOR_MAX_DECIMATION	8
+/** Number of frames compressed after each change of settings before the next change. */
+#define	GOVERNOR_SETTLE			8
+/** Percentage of the budget which must not be exceeded after settings are raised. */
+#define	GOVERNOR_HEADROOM		70
+/** Number of frame intervals without frames after which a filter no longer takes a part of the budget. */
+#define	GOVERNOR_IDLE_INTERVALS	4
+/** Minimum size of a chunk given by Read() while compressing. */
+#define	YUV2JPEG_STREAM_CHUNK	16384
+
+/** Stripe (row of MCUs) of the previous frame, kept for conditional replenishment. */
 typedef struct {
-	struct jpeg_destination_mgr base;	/**< Base JPEG destination structure. */
-	unsigned char *result;				/**< Result buffer. */
-	size_t length;						/**< Length of compressed data in @c result buffer. */
-	size_t size;						/**< Total amount of space available in @c result buffer (or to be allocated if @c result is NULL). */
-} jpeg_destination_mgr_mem_t;
+	uint64_t hash;	/**< Hash of source lines of the stripe. */
+	size_t offset;	/**< Offset of entropy-coded data of the stripe in the previous frame. */
+	size_t length;	/**< Length of entropy-coded data of the stripe. */
+} yuv2jpeg_stripe_t;
+
+/** Instance of a YUV to JPEG video filter. */
+typedef struct video_frame_filter_yuv2jpeg_t {
+	video_frame_filter_t base;			/**< Base structure. */
+	unsigned width;						/**< Width of incoming frames, in pixels. */
+	unsigned bytesperline;				/**< Bytes per each line of the frame, including padding, if any. */
+	unsigned scale;						/**< Downscaling factor: 1, 2, 4 or 8. */
+	unsigned scale_shift;				/**< Binary logarithm of @c scale squared (number of pixels averaged into one). */
+	struct jpeg_compress_struct cinfo;	/**< jpeglib's compress info structure. */
+	struct jpeg_error_mgr jerr;			/**< jpeglib's error manager. */
+	jpeg_destination_mgr_mem_t jdst;	/**< jpeglib's destination memory manager used to capture JPEG output. */
+	JSAMPROW y_rows[DCTSIZE];			/**< Pointers to minimum number of Y plane rows compressed into JPEG at once (DCTSIZE). */
+	JSAMPROW u_rows[DCTSIZE];			/**< Pointers to minimum number of U plane rows compressed into JPEG at once (DCTSIZE since v_samp_factor is 1). */
+	JSAMPROW v_rows[DCTSIZE];			/**< Pointers to minimum number of V plane rows compressed into JPEG at once (DCTSIZE since v_samp_factor is 1). */
+	JSAMPARRAY samples[3];				/**< Pointers to Y, U & V row pointers, compressed into JPEG at once. */
+	unsigned short *sums[3];			/**< Column sums of Y, U & V over @c scale lines, used when downscaling. */
+	bayer_t *bayer;						/**< Demosaicing of raw Bayer frames, or NULL for YUV 4:2:2 packed frames. */
+	const unsigned char *input;			/**< Pointer to a frame provided by @ref video_frame_filter_yuv2jpeg_PutFrame. */
+	size_t input_size;					/**< Size of a frame provided by @ref video_frame_filter_yuv2jpeg_PutFrame. */
+	unsigned height;					/**< Height of the compressed image. */
+	unsigned row;						/**< Next line of the compressed image. */
+	int stream;							/**< Whether frames are compressed while being read. */
+	int compressing;					/**< Whether compression of a frame is in progress. */
+	size_t sent;						/**< Amount of compressed data given by Read() so far. */
+	unsigned long long elapsed;			/**< Time spent on compression of the current frame so far, in nanoseconds. */
+	const unsigned char *frame;			/**< Pointer to the compressed frame. */
+	size_t size;						/**< Size of the compressed frame (@ref VFF_SIZE_UNKNOWN while compressing in Read()). */
+	vff_yuv2jpeg_budget_t *budget;		/**< CPU time budget shared with other tiers, or NULL if the governor is disabled. */
+	struct video_frame_filter_yuv2jpeg_t *budget_next;	/**< Next filter sharing @c budget. */
+	unsigned long long stamp;			/**< When the last frame was provided, in nanoseconds of monotonic clock. */
+	unsigned quality;					/**< The highest quality, used at level 0 of the governor. */
+	unsigned quality_steps;				/**< Number of levels of the governor lowering quality. */
+	unsigned level;						/**< Current level of the governor (0 means no savings). */
+	unsigned decimation;				/**< Only one out of this number of frames is compressed. */
+	unsigned skip;						/**< Number of frames to skip before the next one is compressed. */
+	unsigned settle;					/**< Number of frames compressed since the last change of the level. */
+	unsigned long long avg;				/**< Average time of compression of a frame at the current level, in nanoseconds. */
+	jpeg_huff_learner_t huff;			/**< Learner of Huffman tables (disabled if its interval is 0). */
+	int replenish;						/**< Whether stripes which haven't changed are copied from the previous frame. */
+	yuv2jpeg_stripe_t *stripes;			/**< Stripes of the previous frame (one for each row of MCUs), if @c replenish is set. */
+	int stripes_valid;					/**< Whether @c stripes may be reused (tables and settings haven't changed since). */
+	unsigned char *out[2];				/**< Buffers of the current and previous frame assembled of stripes. */
+	size_t out_size[2];					/**< Sizes of @c out buffers. */
+	unsigned cur;						/**< Index of the buffer in @c out for the current frame. */
+	size_t length;						/**< Length of the current frame assembled so far. */
+	int overflow;						/**< Whether the current frame didn't fit in memory. */
+	unsigned denoise;					/**< Weight of the previous frame in temporal denoising, in 1/256, or 0 if disabled. */
+	unsigned denoise_threshold;			/**< Difference of a sample from the previous frame taken as motion (not denoised), or 0. */
+	unsigned char *state[3];			/**< Denoised Y, U & V planes of the previous frame. */
+	int state_valid;					/**< Whether @c state holds a frame already. */
+	int denoise_bypass;					/**< Whether the frame is compressed without denoising (for comparison). */
+	unsigned report_frames;				/**< Number of frames after which sizes of frames are reported, or 0. */
+	unsigned report_count;				/**< Number of frames compressed since the last report. */
+	unsigned long long report_bytes;	/**< Total size of frames compressed since the last report. */
+	jpeg_destination_mgr_mem_t jprobe;	/**< jpeglib's destination memory manager used for a frame compressed without denoising. */
+	const roi_t *roi;					/**< Regions of interest, or NULL. */
+	unsigned roi_box;					/**< Size of squares averaged in blocks outside regions of interest, or 1 if none. */
+	unsigned roi_shift;					/**< Binary logarithm of @c roi_box squared. */
+} video_frame_filter_yuv2jpeg_t;
+
+/** CPU time budget shared by YUV to JPEG filters. */
+struct vff_yuv2jpeg_budget_t {
+	unsigned long long limit;				/**< Time allowed for compression of each captured frame by all filters together, in nanoseconds. */
+	unsigned long long idle;				/**< Time without frames after which a filter no longer takes a part of the budget, in nanoseconds. */
+	video_frame_filter_yuv2jpeg_t *members;	/**< Filters sharing the budget, linked by their @c budget_next. */
+};
+
+/**************************************/
 
 /**
- * Starts collecting compressed frame.
+ * Splits a line of YUV 4:2:2 packed frame into Y, U & V rows.
  *
- * @param cinfo Memory manager used by jpeglib.
+ * @param src Source line.
+ * @param pairs Number of pixel pairs (i.e. half of the width).
+ * @param yp Destination Y row.
+ * @param up Destination U row.
+ * @param vp Destination V row.
  */
-static void jpeg_destination_init(j_compress_ptr cinfo)
+static void yuv2jpeg_split_line(const unsigned char *src, unsigned pairs, JSAMPROW yp, JSAMPROW up, JSAMPROW vp)
 {
-	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
+	unsigned x;
+
+	/* plain indexing lets the compiler vectorize it */
+	for (x = 0; x < pairs; x++) {
+		yp[2 * x] = src[4 * x];
+		up[x] = src[4 * x + 1];
+		yp[2 * x + 1] = src[4 * x + 2];
+		vp[x] = src[4 * x + 3];
+	}
+}
 
-	if (!jdst->result)
-		jdst->result = malloc(jdst->size);
-	jdst->base.next_output_byte = jdst->result;
-	jdst->base.free_in_buffer = jdst->size;
+/**
+ * Box-downscales @c scale lines of YUV 4:2:2 packed frame into single Y, U & V rows.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param src First source line.
+ * @param yp Destination Y row.
+ * @param up Destination U row.
+ * @param vp Destination V row.
+ */
+static void yuv2jpeg_scale_lines(video_frame_filter_yuv2jpeg_t *thiz, const unsigned char *src, JSAMPROW yp, JSAMPROW up, JSAMPROW vp)
+{
+	unsigned short *ys = thiz->sums[0], *us = thiz->sums[1], *vs = thiz->sums[2];
+	unsigned pairs = thiz->width / 2, s = thiz->scale, shift = thiz->scale_shift;
+	unsigned round = (1 << shift) >> 1;
+	unsigned out_pairs = thiz->cinfo.image_width / 2;
+	unsigned l, x, k;
+
+	/* vertical pass: sum up columns */
+	memset(ys, 0, pairs * 2 * sizeof(*ys));
+	memset(us, 0, pairs * sizeof(*us));
+	memset(vs, 0, pairs * sizeof(*vs));
+	for (l = 0; l < s; l++, src += thiz->bytesperline) {
+		for (x = 0; x < pairs; x++) {
+			ys[2 * x] += src[4 * x];
+			us[x] += src[4 * x + 1];
+			ys[2 * x + 1] += src[4 * x + 2];
+			vs[x] += src[4 * x + 3];
+		}
+	}
+	/* horizontal pass: sum up neighbours & divide */
+	for (x = 0; x < out_pairs * 2; x++) {
+		unsigned sum = round;
+
+		for (k = 0; k < s; k++)
+			sum += ys[x * s + k];
+		yp[x] = sum >> shift;
+	}
+	for (x = 0; x < out_pairs; x++) {
+		unsigned usum = round, vsum = round;
+
+		for (k = 0; k < s; k++) {
+			usum += us[x * s + k];
+			vsum += vs[x * s + k];
+		}
+		up[x] = usum >> shift;
+		vp[x] = vsum >> shift;
+	}
 }
 
 /**
- * Extends space for compressed frame.
+ * Denoises a row of samples with a recursive temporal filter: each sample
+ * is a weighted average of the current one and of the denoised sample of
+ * the previous frame, unless they differ too much (motion).
  *
- * @param cinfo Memory manager used by jpeglib.
- * @return true on success, false on memory allocation error.
+ * @param row Row of samples, replaced with denoised ones.
+ * @param state Row of denoised samples of the previous frame, replaced with denoised ones.
+ * @param count Number of samples.
+ * @param weight Weight of the previous frame, in 1/256.
+ * @param threshold Difference taken as motion, or 0 if motion isn't detected.
  */
-static boolean jpeg_destination_empty_output_buffer(j_compress_ptr cinfo)
+static void yuv2jpeg_denoise_row(JSAMPROW row, unsigned char *state, unsigned count, int weight, int threshold)
 {
-	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
-	size_t new_size = jdst->size * 2;	/* double the size of our buffer */
-
-	jdst->result = realloc(jdst->result, new_size);
-	jdst->base.next_output_byte = jdst->result + jdst->size;
-	jdst->base.free_in_buffer = new_size - jdst->size;
-	jdst->size = new_size;
-	return !!jdst->result;
+	unsigned x;
+
+	/* plain indexing and no branches let the compiler vectorize it */
+	for (x = 0; x < count; x++) {
+		int d = state[x] - row[x];
+		int still = !threshold || (d < 0 ? -d : d) <= threshold;
+		/* d + 256 is never negative, so shifting rounds the same way for both signs */
+		int v = row[x] + (((d + 256) * weight + 128) >> 8) - weight;
+
+		row[x] = state[x] = still ? v : row[x];
+	}
 }
 
 /**
- * Terminates compression of a frame into JPEG.
+ * Returns current time of monotonic clock.
  *
- * Takes current length as final size of a compressed frame.
+ * @return Current time, in nanoseconds.
+ */
+static unsigned long long yuv2jpeg_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Applies settings of the current level of the governor.
+ *
+ * Level 0 uses accurate DCT and the highest quality. The next level
+ * switches to fast DCT, subsequent ones lower quality step by step,
+ * and the last ones compress only every n-th frame.
  *
- * @param cinfo Memory manager used by jpeglib.
+ * @param thiz Instance of a YUV to JPEG video filter.
  */
-static void jpeg_destination_term(j_compress_ptr cinfo)
+static void yuv2jpeg_governor_apply(video_frame_filter_yuv2jpeg_t *thiz)
 {
-	jpeg_destination_mgr_mem_t *jdst = (jpeg_destination_mgr_mem_t *) cinfo->dest;
+	unsigned level = thiz->level, quality = thiz->quality;
+
+	thiz->cinfo.dct_method = level ? JDCT_IFAST : JDCT_ISLOW;
+	if (level > 1)
+		quality -= GOVERNOR_QUALITY_STEP * (level - 1 < thiz->quality_steps ? level - 1 : thiz->quality_steps);
+	if (quality < GOVERNOR_MIN_QUALITY && quality < thiz->quality)
+		quality = GOVERNOR_MIN_QUALITY;
+	jpeg_set_quality(&thiz->cinfo, quality, TRUE);
+	thiz->stripes_valid = 0;
+	thiz->decimation = level > thiz->quality_steps + 1 ? level - thiz->quality_steps : 1;
+	thiz->skip = 0;
+	thiz->settle = 0;
+}
 
-	jdst->length = jdst->size - jdst->base.free_in_buffer;
+/**
+ * Tells whether a filter sharing the budget is still given frames.
+ *
+ * @param m Instance of a YUV to JPEG video filter.
+ * @param now Current time, in nanoseconds of monotonic clock.
+ * @return Non-zero if the filter takes a part of the budget.
+ */
+static int yuv2jpeg_governor_active(const video_frame_filter_yuv2jpeg_t *m, unsigned long long now)
+{
+	return m->stamp && now - m->stamp <= m->budget->idle;
 }
 
 /**
- * Creates custom destination memory manager for jpeglib.
+ * Accounts time of compression of a frame and changes the level of the
+ * governor if compression by all filters sharing the budget doesn't fit
+ * in it, or fits in it easily.
  *
- * @param jdst Pointer to the memory manager structure to be initialized.
- * @return Pointer to base memory manager structure associated with @c jdst.
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param elapsed Time of compression of the last frame, in nanoseconds.
  */
-static struct jpeg_destination_mgr *jpeg_destination_mgr_mem_create(jpeg_destination_mgr_mem_t *jdst)
+static void yuv2jpeg_governor_update(video_frame_filter_yuv2jpeg_t *thiz, unsigned long long elapsed)
 {
-	jdst->result = NULL;
-	jdst->size = 4096;	/* start with 4 KB */
-	jdst->base.init_destination = jpeg_destination_init;
-	jdst->base.empty_output_buffer = jpeg_destination_empty_output_buffer;
-	jdst->base.term_destination = jpeg_destination_term;
-	return &jdst->base;
+	const video_frame_filter_yuv2jpeg_t *m;
+	unsigned long long load, others = 0, now = yuv2jpeg_now();
+	unsigned active = 1;
+
+	thiz->avg = thiz->settle ? (thiz->avg * 7 + elapsed) / 8 : elapsed;
+	if (++thiz->settle < GOVERNOR_SETTLE)
+		return;
+	/* time spent per captured frame, by this filter and by the others */
+	load = thiz->avg / thiz->decimation;
+	for (m = thiz->budget->members; m; m = m->budget_next)
+		if (m != thiz && yuv2jpeg_governor_active(m, now)) {
+			others += m->avg / m->decimation;
+			active++;
+		}
+	if (others + load > thiz->budget->limit) {
+		int yield = load * active >= others + load;
+
+		/* filters taking more than their share give up first; the rest only once those can't give up anymore (m is NULL then) */
+		for (m = thiz->budget->members; m && !yield; m = m->budget_next)
+			if (m != thiz && yuv2jpeg_governor_active(m, now) && m->level < m->quality_steps + GOVERNOR_MAX_DECIMATION &&
+				m->avg / m->decimation * active >= others + load)
+				break;
+		if ((yield || !m) && thiz->level < thiz->quality_steps + GOVERNOR_MAX_DECIMATION) {
+			thiz->level++;
+			yuv2jpeg_governor_apply(thiz);
+		}
+	} else if (thiz->level) {
+		/* expected load after the frame rate is raised */
+		if (thiz->decimation > 1)
+			load = thiz->avg / (thiz->decimation - 1);
+		if ((others + load) * 100 < thiz->budget->limit * GOVERNOR_HEADROOM) {
+			thiz->level--;
+			yuv2jpeg_governor_apply(thiz);
+		}
+	}
 }
 
 /**
- * Destroys custom destination memory manager for jpeglib.
+ * Returns time elapsed since given moment.
  *
- * @param jdst Pointer to the memory manager structure initialized by @ref jpeg_destination_mgr_mem_create.
+ * @param start The moment, taken from monotonic clock.
+ * @return Elapsed time, in nanoseconds.
  */
-static void jpeg_destination_mgr_mem_destroy(jpeg_destination_mgr_mem_t *jdst)
+static unsigned long long yuv2jpeg_elapsed(const struct timespec *start)
 {
-	free(jdst->result);
-	jdst->result = NULL;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000ULL + now.tv_nsec - start->tv_nsec;
 }
 
-/**************************************/
+/**
+ * Denoises Y, U & V rows of the current line of the frame being compressed.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param y Index of the rows in @c samples.
+ */
+static void yuv2jpeg_denoise_rows(video_frame_filter_yuv2jpeg_t *thiz, unsigned y)
+{
+	unsigned c;
 
-/** Instance of a YUV to JPEG video filter. */
-typedef struct {
-	video_frame_filter_t base;			/**< Base structure. */
-	unsigned bytesperline;				/**< Bytes per each line of the frame, including padding, if any. */
-	struct jpeg_compress_struct cinfo;	/**< jpeglib's compress info structure. */
-	struct jpeg_error_mgr jerr;			/**< jpeglib's error manager. */
-	jpeg_destination_mgr_mem_t jdst;	/**< jpeglib's destination memory manager used to capture JPEG output. */
-	JSAMPROW y_rows[DCTSIZE];			/**< Pointers to minimum number of Y plane rows compressed into JPEG at once (DCTSIZE). */
-	JSAMPROW u_rows[DCTSIZE];			/**< Pointers to minimum number of U plane rows compressed into JPEG at once (DCTSIZE since v_samp_factor is 1). */
-	JSAMPROW v_rows[DCTSIZE];			/**< Pointers to minimum number of V plane rows compressed into JPEG at once (DCTSIZE since v_samp_factor is 1). */
-	JSAMPARRAY samples[3];				/**< Pointers to Y, U & V row pointers, compressed into JPEG at once. */
-	const unsigned char *frame;			/**< Pointer to a frame provided by @ref video_frame_filter_yuv2jpeg_PutFrame. */
-	size_t size;						/**< Size of a frame provided by @ref video_frame_filter_yuv2jpeg_PutFrame. */
-} video_frame_filter_yuv2jpeg_t;
+	for (c = 0; c < 3; c++) {
+		unsigned count = c ? thiz->cinfo.image_width / 2 : thiz->cinfo.image_width;
+		unsigned char *state = thiz->state[c] + (size_t) thiz->row * count;
 
-/**************************************/
+		if (thiz->state_valid)
+			yuv2jpeg_denoise_row(thiz->samples[c][y], state, count, thiz->denoise, thiz->denoise_threshold);
+		else
+			memcpy(state, thiz->samples[c][y], count);
+	}
+}
 
-/** @copydoc video_frame_filter_ops_t::PutFrame */
-static void video_frame_filter_yuv2jpeg_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+/**
+ * Smooths blocks of the row of blocks in @c samples which are outside
+ * regions of interest: each square of @c roi_box samples is replaced with
+ * its mean, so high frequencies of the blocks are (roughly) gone.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ */
+static void yuv2jpeg_roi_rows(video_frame_filter_yuv2jpeg_t *thiz)
 {
-	video_frame_filter_yuv2jpeg_t *thiz = (video_frame_filter_yuv2jpeg_t *) base;
-	unsigned total_rows, c, y, x, skipbytes;
+	unsigned n = thiz->roi_box, shift = thiz->roi_shift;
+	unsigned top = (thiz->row - DCTSIZE) * thiz->scale;
+	unsigned c, bx, x, y, i, j;
 
-	jpeg_start_compress(&thiz->cinfo, TRUE);
+	for (c = 0; c < 3; c++) {
+		unsigned width = c ? thiz->cinfo.image_width / 2 : thiz->cinfo.image_width;
+		unsigned block_width = DCTSIZE * thiz->scale * (c ? 2 : 1);
+		JSAMPARRAY rows = thiz->samples[c];
+
+		/* partial blocks at the right edge are left alone, since padding isn't filled */
+		for (bx = 0; (bx + 1) * DCTSIZE <= width; bx++) {
+			if (roi_contains(thiz->roi, bx * block_width, top, block_width, DCTSIZE * thiz->scale))
+				continue;
+			for (y = 0; y < DCTSIZE; y += n) {
+				for (x = bx * DCTSIZE; x < (bx + 1) * DCTSIZE; x += n) {
+					unsigned sum = (1U << shift) >> 1;
+
+					for (j = 0; j < n; j++)
+						for (i = 0; i < n; i++)
+							sum += rows[y + j][x + i];
+					sum >>= shift;
+					for (j = 0; j < n; j++)
+						memset(rows[y + j] + x, sum, n);
+				}
+			}
+		}
+	}
+}
 
-	total_rows = thiz->cinfo.comp_info[0].height_in_blocks * DCTSIZE;
-	skipbytes = thiz->bytesperline - thiz->cinfo.image_width * 2;
-	for (c = 0; c < total_rows; c += y, frame += skipbytes) {
-		for (y = 0; y < DCTSIZE; y++) {
-			JSAMPROW yp = thiz->y_rows[y];
-			JSAMPROW up = thiz->u_rows[y];
-			JSAMPROW vp = thiz->v_rows[y];
-
-			for (x = thiz->cinfo.image_width / 2; size >= 4 && x > 0; x--, size -= 4) {
-				*yp++ = *frame++;
-				*up++ = *frame++;
-				*yp++ = *frame++;
-				*vp++ = *frame++;
+/**
+ * Prepares next row of blocks of the frame being compressed in @c samples.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ */
+static void yuv2jpeg_fill_rows(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	size_t line_size = thiz->width * 2;
+	size_t block_size = (size_t) thiz->bytesperline * thiz->scale;
+	unsigned y;
+
+	for (y = 0; y < DCTSIZE; y++, thiz->row++) {
+		size_t offset = thiz->row * block_size;
+
+		if (thiz->row >= thiz->height) {
+			/* pad up to the block boundary by repeating last row */
+			if (y) {
+				memcpy(thiz->y_rows[y], thiz->y_rows[y - 1], thiz->cinfo.image_width);
+				memcpy(thiz->u_rows[y], thiz->u_rows[y - 1], thiz->cinfo.image_width / 2);
+				memcpy(thiz->v_rows[y], thiz->v_rows[y - 1], thiz->cinfo.image_width / 2);
 			}
+		} else if (thiz->bayer) {
+			if (!bayer_line(thiz->bayer, thiz->input, thiz->input_size, thiz->row, thiz->y_rows[y], thiz->u_rows[y], thiz->v_rows[y]) &&
+				thiz->denoise && !thiz->denoise_bypass)
+				yuv2jpeg_denoise_rows(thiz, y);
+		} else if (offset + block_size - thiz->bytesperline + line_size <= thiz->input_size) {
+			if (thiz->scale == 1)
+				yuv2jpeg_split_line(thiz->input + offset, thiz->width / 2, thiz->y_rows[y], thiz->u_rows[y], thiz->v_rows[y]);
+			else
+				yuv2jpeg_scale_lines(thiz, thiz->input + offset, thiz->y_rows[y], thiz->u_rows[y], thiz->v_rows[y]);
+			if (thiz->denoise && !thiz->denoise_bypass)
+				yuv2jpeg_denoise_rows(thiz, y);
 		}
+	}
+	if (thiz->roi_box > 1)
+		yuv2jpeg_roi_rows(thiz);
+}
 
-		jpeg_write_raw_data(&thiz->cinfo, thiz->samples, DCTSIZE);
+/**
+ * Appends data to the frame being assembled of stripes.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param data Data to be appended.
+ * @param length Length of @c data.
+ */
+static void yuv2jpeg_append(video_frame_filter_yuv2jpeg_t *thiz, const unsigned char *data, size_t length)
+{
+	unsigned cur = thiz->cur;
+
+	if (thiz->length + length > thiz->out_size[cur]) {
+		size_t size = thiz->out_size[cur] ? thiz->out_size[cur] : 65536;
+		unsigned char *out;
+
+		while (size < thiz->length + length)
+			size *= 2;
+		out = realloc(thiz->out[cur], size);
+		if (!out) {
+			thiz->overflow = 1;
+			return;
+		}
+		thiz->out[cur] = out;
+		thiz->out_size[cur] = size;
+	}
+	memcpy(thiz->out[cur] + thiz->length, data, length);
+	thiz->length += length;
+}
+
+/**
+ * Computes hash of source lines of the stripe to be compressed next,
+ * along with regions of interest covering it if they move.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @return Hash of the lines.
+ */
+static uint64_t yuv2jpeg_hash_stripe(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	size_t line_size = thiz->bayer ? thiz->width : thiz->width * 2;
+	unsigned first = thiz->row * thiz->scale, last = (thiz->row + DCTSIZE) * thiz->scale, l;
+	uint64_t hash = 0;
+
+	if (thiz->bayer && thiz->scale == 1) {
+		/* interpolation takes neighbouring lines too */
+		if (first)
+			first--;
+		last++;
+	}
+	if (last > thiz->height * thiz->scale)
+		last = thiz->height * thiz->scale;
+	for (l = first; l < last; l++) {
+		const unsigned char *line = thiz->input + (size_t) l * thiz->bytesperline;
+		size_t x;
+
+		if ((size_t) l * thiz->bytesperline + line_size > thiz->input_size)
+			break;
+		for (x = 0; x + 8 <= line_size; x += 8) {
+			uint64_t word;
+
+			memcpy(&word, line + x, sizeof(word));
+			hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+			hash ^= hash >> 29;
+		}
+		for (; x < line_size; x++)
+			hash = (hash ^ line[x]) * 0x9E3779B97F4A7C15ULL;
+	}
+	if (thiz->roi_box > 1 && roi_is_dynamic(thiz->roi)) {
+		/* blocks which @ref yuv2jpeg_roi_rows smooths may differ from the previous frame, even if pixels don't */
+		unsigned top = thiz->row * thiz->scale, c, bx;
+
+		for (c = 0; c < 2; c++) {
+			unsigned width = c ? thiz->cinfo.image_width / 2 : thiz->cinfo.image_width;
+			unsigned block_width = DCTSIZE * thiz->scale * (c ? 2 : 1);
+
+			for (bx = 0; (bx + 1) * DCTSIZE <= width; bx++)
+				hash = (hash ^ (uint64_t) roi_contains(thiz->roi, bx * block_width, top, block_width, DCTSIZE * thiz->scale)) * 0x9E3779B97F4A7C15ULL;
+		}
+	}
+	return hash;
+}
+
+/**
+ * Compresses next stripe (row of MCUs) of the frame as a separate image of
+ * single stripe, and appends its entropy-coded data to the frame being
+ * assembled. Since every stripe is a restart interval, its data don't
+ * depend on other stripes. If source lines of the stripe are the same as
+ * in the previous frame, its data are copied from there instead.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ */
+static void yuv2jpeg_replenish_rows(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	static const unsigned char sof0 = 0xC0, sos = 0xDA;
+	unsigned index = thiz->row / DCTSIZE;
+	yuv2jpeg_stripe_t *stripe = &thiz->stripes[index];
+	uint64_t hash = yuv2jpeg_hash_stripe(thiz);
+	const unsigned char *data;
+	size_t pos, header;
+
+	if (index) {
+		/* restart marker, numbered by position */
+		unsigned char rst[2] = { 0xFF, 0xD0 + ((index - 1) & 7) };
+
+		yuv2jpeg_append(thiz, rst, sizeof(rst));
+	} else if (thiz->stripes_valid) {
+		/* the same header as before */
+		yuv2jpeg_append(thiz, thiz->out[!thiz->cur], thiz->stripes[0].offset);
+	}
+	if (thiz->stripes_valid && stripe->hash == hash) {
+		data = thiz->out[!thiz->cur] + stripe->offset;
+		stripe->offset = thiz->length;
+		yuv2jpeg_append(thiz, data, stripe->length);
+		thiz->row += DCTSIZE;
+		return;
 	}
 
+	/* tables are written only along with the header */
+	jpeg_start_compress(&thiz->cinfo, !thiz->stripes_valid);
+	yuv2jpeg_fill_rows(thiz);
+	jpeg_write_raw_data(&thiz->cinfo, thiz->samples, DCTSIZE);
 	jpeg_finish_compress(&thiz->cinfo);
 
-	thiz->frame = thiz->jdst.result;
-	thiz->size = thiz->jdst.length;
+	/* find entropy-coded data: from the end of SOS segment to EOI */
+	data = thiz->jdst.result;
+	for (pos = 2, header = 0; pos + 4 <= thiz->jdst.length && !header; pos += 2 + ((data[pos + 2] << 8) | data[pos + 3])) {
+		if (data[pos + 1] == sof0 && !index) {
+			/* SOF of the whole frame: store its height */
+			thiz->jdst.result[pos + 5] = thiz->height >> 8;
+			thiz->jdst.result[pos + 6] = thiz->height & 0xFF;
+		}
+		if (data[pos + 1] == sos)
+			header = pos + 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+	}
+	if (!index && !thiz->stripes_valid)
+		yuv2jpeg_append(thiz, data, header);
+	stripe->hash = hash;
+	stripe->offset = thiz->length;
+	stripe->length = thiz->jdst.length - 2 - header;
+	yuv2jpeg_append(thiz, data + header, stripe->length);
+}
+
+/**
+ * Compresses next row of blocks of the frame being compressed.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ */
+static void yuv2jpeg_write_rows(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	if (thiz->replenish) {
+		yuv2jpeg_replenish_rows(thiz);
+		return;
+	}
+	yuv2jpeg_fill_rows(thiz);
+	jpeg_write_raw_data(&thiz->cinfo, thiz->samples, DCTSIZE);
+}
+
+/**
+ * Returns compressed data of the current frame produced so far.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param length Receives length of the data.
+ * @return Pointer to the data.
+ */
+static const unsigned char *yuv2jpeg_produced(video_frame_filter_yuv2jpeg_t *thiz, size_t *length)
+{
+	if (thiz->replenish) {
+		*length = thiz->length;
+		return thiz->out[thiz->cur];
+	}
+	*length = thiz->compressing ? thiz->jdst.size - thiz->jdst.base.free_in_buffer : thiz->jdst.length;
+	return thiz->jdst.result;
+}
+
+/**
+ * Compresses the current frame again without denoising, to see how much
+ * denoising saves. Applies to frames compressed at once only.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @return Size of the frame compressed without denoising.
+ */
+static size_t yuv2jpeg_probe(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	struct jpeg_destination_mgr *dest = thiz->cinfo.dest;
+
+	thiz->cinfo.dest = &thiz->jprobe.base;
+	thiz->denoise_bypass = 1;
+	thiz->row = 0;
+	jpeg_start_compress(&thiz->cinfo, TRUE);
+	while (thiz->row < thiz->height) {
+		yuv2jpeg_fill_rows(thiz);
+		jpeg_write_raw_data(&thiz->cinfo, thiz->samples, DCTSIZE);
+	}
+	jpeg_finish_compress(&thiz->cinfo);
+	thiz->denoise_bypass = 0;
+	thiz->cinfo.dest = dest;
+	return thiz->jprobe.length;
+}
+
+/**
+ * Accounts size of a compressed frame and reports average size of frames
+ * from time to time, along with the size of a frame compressed without
+ * denoising.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ */
+static void yuv2jpeg_report(video_frame_filter_yuv2jpeg_t *thiz)
+{
+	thiz->report_bytes += thiz->size;
+	if (++thiz->report_count < thiz->report_frames)
+		return;
+	if (thiz->replenish)
+		fprintf(stderr, "yuv2jpeg: %llu B/frame denoised\n", thiz->report_bytes / thiz->report_count);
+	else
+		fprintf(stderr, "yuv2jpeg: %llu B/frame denoised, %zu B without denoising\n",
+			thiz->report_bytes / thiz->report_count, yuv2jpeg_probe(thiz));
+	thiz->report_count = 0;
+	thiz->report_bytes = 0;
+}
+
+/**
+ * Finishes compression of a frame.
+ *
+ * @param thiz Instance of a YUV to JPEG video filter.
+ * @param start When the last part of compression has started.
+ */
+static void yuv2jpeg_finish(video_frame_filter_yuv2jpeg_t *thiz, const struct timespec *start)
+{
+	if (thiz->replenish) {
+		static const unsigned char eoi[] = { 0xFF, 0xD9 };
+
+		yuv2jpeg_append(thiz, eoi, sizeof(eoi));
+		thiz->stripes_valid = !thiz->overflow;
+	} else {
+		jpeg_finish_compress(&thiz->cinfo);
+	}
+	thiz->compressing = 0;
+
+	thiz->frame = yuv2jpeg_produced(thiz, &thiz->size);
+	if (thiz->overflow)
+		thiz->size = 0;
+	/* stripes can't be reused with new tables */
+	if (thiz->huff.interval && jpeg_huff_learner_update(&thiz->huff, thiz->frame, thiz->size))
+		thiz->stripes_valid = 0;
+
+	if (thiz->budget)
+		yuv2jpeg_governor_update(thiz, thiz->elapsed + yuv2jpeg_elapsed(start));
+	if (thiz->denoise) {
+		thiz->state_valid = 1;
+		if (thiz->report_frames && thiz->size)
+			yuv2jpeg_report(thiz);
+	}
+}
+
+/** @copydoc video_frame_filter_ops_t::PutFrame */
+static void video_frame_filter_yuv2jpeg_PutFrame(video_frame_filter_t *base, const unsigned char *frame, size_t size)
+{
+	video_frame_filter_yuv2jpeg_t *thiz = (video_frame_filter_yuv2jpeg_t *) base;
+	struct timespec start;
+
+	if (thiz->compressing) {
+		/* previous frame hasn't been read out completely */
+		jpeg_abort_compress(&thiz->cinfo);
+		thiz->compressing = 0;
+		thiz->stripes_valid = 0;
+	}
+	if (thiz->budget)
+		thiz->stamp = yuv2jpeg_now();
+	if (thiz->skip) {
+		/* dropped by the governor */
+		thiz->skip--;
+		thiz->size = 0;
+		return;
+	}
+	thiz->skip = thiz->decimation - 1;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (thiz->huff.interval && !(thiz->replenish && thiz->stripes_valid))
+		jpeg_huff_learner_apply(&thiz->huff, &thiz->cinfo);
+	if (thiz->replenish) {
+		/* stripes are compressed one by one */
+		thiz->cur = !thiz->cur;
+		thiz->length = 0;
+		thiz->overflow = 0;
+	} else {
+		jpeg_start_compress(&thiz->cinfo, TRUE);
+	}
+	thiz->input = frame;
+	thiz->input_size = size;
+	thiz->row = 0;
+	thiz->sent = 0;
+	thiz->elapsed = 0;
+	thiz->compressing = 1;
+
+	if (thiz->stream) {
+		/* compressed by Read() */
+		thiz->frame = NULL;
+		thiz->size = VFF_SIZE_UNKNOWN;
+		thiz->elapsed = yuv2jpeg_elapsed(&start);
+		return;
+	}
+	while (thiz->row < thiz->height)
+		yuv2jpeg_write_rows(thiz);
+	yuv2jpeg_finish(thiz, &start);
 }
 
 /** @copydoc video_frame_filter_ops_t::GetSize */
@@ -180,6 +753,28 @@ static void video_frame_filter_yuv2jpeg_Read(video_frame_filter_t *base, const u
 {
 	video_frame_filter_yuv2jpeg_t *thiz = (video_frame_filter_yuv2jpeg_t *) base;
 
+	if (thiz->compressing) {
+		struct timespec start;
+		size_t produced;
+
+		/* compress rows of blocks until there's enough data to be sent */
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do {
+			if (thiz->row < thiz->height)
+				yuv2jpeg_write_rows(thiz);
+			else
+				yuv2jpeg_finish(thiz, &start);
+			*data = yuv2jpeg_produced(thiz, &produced) + thiz->sent;
+			produced -= thiz->sent;
+		} while (thiz->compressing && produced < YUV2JPEG_STREAM_CHUNK);
+		if (thiz->compressing)
+			thiz->elapsed += yuv2jpeg_elapsed(&start);
+		else
+			thiz->size = 0;
+		*size = produced;
+		thiz->sent += produced;
+		return;
+	}
 	*data = thiz->frame;
 	*size = thiz->size;
 	thiz->size = 0;
@@ -191,16 +786,33 @@ static void video_frame_filter_yuv2jpeg_Destroy(video_frame_filter_t *base)
 	video_frame_filter_yuv2jpeg_t *thiz = (video_frame_filter_yuv2jpeg_t *) base;
 	unsigned c, y;
 
+	if (thiz->budget) {
+		video_frame_filter_yuv2jpeg_t **m;
+
+		for (m = &thiz->budget->members; *m != thiz; m = &(*m)->budget_next)
+			;
+		*m = thiz->budget_next;
+	}
 	for (c = 0; c < 3; c++)
 		for (y = DCTSIZE; y > 0; y--)
 			free(thiz->samples[c][y - 1]);
+	for (c = 0; c < 3; c++)
+		free(thiz->sums[c]);
+	if (thiz->bayer)
+		bayer_destroy(thiz->bayer);
+	free(thiz->stripes);
+	free(thiz->out[0]);
+	free(thiz->out[1]);
+	for (c = 0; c < 3; c++)
+		free(thiz->state[c]);
+	jpeg_destination_mgr_mem_destroy(&thiz->jprobe);
 	jpeg_destroy_compress(&thiz->cinfo);
 	jpeg_destination_mgr_mem_destroy(&thiz->jdst);
 	free(thiz);
 }
 
 /** Operations of the YUV to JPEG video filter. */
-video_frame_filter_ops_t video_frame_filter_yuv2jpeg_ops = {
+static const video_frame_filter_ops_t video_frame_filter_yuv2jpeg_ops = {
 	.PutFrame = video_frame_filter_yuv2jpeg_PutFrame,
 	.GetSize = video_frame_filter_yuv2jpeg_GetSize,
 	.Read = video_frame_filter_yuv2jpeg_Read,
@@ -209,24 +821,100 @@ video_frame_filter_ops_t video_frame_filter_yuv2jpeg_ops = {
 
 /**************************************/
 
-video_frame_filter_t *vff_yuv2jpeg_create(unsigned width, unsigned height, unsigned bytesperline, unsigned quality)
+vff_yuv2jpeg_budget_t *vff_yuv2jpeg_budget_create(unsigned interval, unsigned percent)
 {
-	video_frame_filter_yuv2jpeg_t *rv = (video_frame_filter_yuv2jpeg_t *) calloc(1, sizeof(video_frame_filter_yuv2jpeg_t));
-	unsigned c, y;
+	vff_yuv2jpeg_budget_t *rv = (vff_yuv2jpeg_budget_t *) calloc(1, sizeof(vff_yuv2jpeg_budget_t));
 
-	rv->bytesperline = bytesperline;
+	if (!rv)
+		return NULL;
+	rv->limit = (unsigned long long) interval * 10 * percent;	/* us * 1000 * percent / 100 */
+	rv->idle = (unsigned long long) interval * 1000 * GOVERNOR_IDLE_INTERVALS;
+	return rv;
+}
+
+void vff_yuv2jpeg_budget_destroy(vff_yuv2jpeg_budget_t *budget)
+{
+	assert(!budget->members);
+	free(budget);
+}
+
+video_frame_filter_t *vff_yuv2jpeg_create(const capture_data_format_t *format, unsigned quality, unsigned scale, vff_yuv2jpeg_budget_t *budget, unsigned huff_interval, int stream, int replenish,
+	unsigned denoise, unsigned denoise_threshold, unsigned report_frames, const roi_t *roi, unsigned cutoff)
+{
+	video_frame_filter_yuv2jpeg_t *rv;
+	unsigned width = format->width, height = format->height;
+	bayer_t *bayer = NULL;
+	unsigned c, y, shift;
+
+	for (shift = 0; (1U << shift) < scale; shift++)
+		;
+	if (denoise > 99) {
+		fprintf(stderr, "Unsupported denoising strength %u\n", denoise);
+		return NULL;
+	}
+	if (scale > 8 || (1U << shift) != scale || width / scale < 2 || height / scale < 1) {
+		fprintf(stderr, "Unsupported scale 1/%u of %u x %u\n", scale, width, height);
+		return NULL;
+	}
+	if (CAPTURE_FMT_IS_BAYER(format->fmt)) {
+		bayer = bayer_create(format, scale);
+		if (!bayer)
+			return NULL;
+	} else if (format->fmt != CAPTURE_FMT__YUV422_PACKED) {
+		fprintf(stderr, "Unsupported format of frames %u\n", format->fmt);
+		return NULL;
+	}
+
+	rv = (video_frame_filter_yuv2jpeg_t *) calloc(1, sizeof(video_frame_filter_yuv2jpeg_t));
+	rv->width = width;
+	rv->bytesperline = format->bytesperline;
+	rv->bayer = bayer;
+	rv->scale = scale;
+	rv->scale_shift = shift * 2;
+	rv->decimation = 1;
+	rv->stream = stream;
+	rv->denoise = denoise * 256 / 100;
+	rv->denoise_threshold = denoise_threshold;
+	rv->report_frames = report_frames;
+	/* frequencies kept by zigzag cutoff are roughly the ones which survive averaging */
+	rv->roi_box = !roi ? 1 : cutoff <= 1 ? 8 : cutoff <= 3 ? 4 : cutoff <= 15 ? 2 : 1;
+	for (shift = 0; (1U << shift) < rv->roi_box; shift++)
+		;
+	rv->roi_shift = shift * 2;
+	rv->roi = roi;
+	jpeg_destination_mgr_mem_create(&rv->jprobe);
+	jpeg_huff_learner_init(&rv->huff, huff_interval);
+	width = width / scale & ~1U;
+	height /= scale;
 	jpeg_create_compress(&rv->cinfo);
 	rv->cinfo.err = jpeg_std_error(&rv->jerr);
 	rv->cinfo.dest = jpeg_destination_mgr_mem_create(&rv->jdst);
+	rv->height = height;
 	rv->cinfo.image_width = width;
 	rv->cinfo.image_height = height;
+	if (replenish) {
+		/* each stripe is compressed as a separate image, and a restart interval of the frame */
+		rv->replenish = 1;
+		rv->stripes = calloc((height + DCTSIZE - 1) / DCTSIZE, sizeof(*rv->stripes));
+		rv->cinfo.image_height = DCTSIZE;
+	}
 	rv->cinfo.input_components = 3;
 	rv->cinfo.in_color_space = JCS_YCbCr;
 	jpeg_set_defaults(&rv->cinfo);
 	rv->cinfo.raw_data_in = TRUE;
 	if (quality != UINT_MAX)
 		jpeg_set_quality(&rv->cinfo, quality, TRUE);
+	if (budget) {
+		rv->budget = budget;
+		rv->budget_next = budget->members;
+		budget->members = rv;
+		rv->quality = quality != UINT_MAX ? quality : 75;	/* jpeglib's default */
+		if (rv->quality > GOVERNOR_MIN_QUALITY)
+			rv->quality_steps = (rv->quality - GOVERNOR_MIN_QUALITY + GOVERNOR_QUALITY_STEP - 1) / GOVERNOR_QUALITY_STEP;
+	}
 	jpeg_set_colorspace(&rv->cinfo, JCS_YCbCr);
+	if (replenish)
+		rv->cinfo.restart_in_rows = 1;
 	/* Y */
 	rv->cinfo.comp_info[0].h_samp_factor = 2;
 	rv->cinfo.comp_info[0].v_samp_factor = 1;
@@ -245,6 +933,10 @@ video_frame_filter_t *vff_yuv2jpeg_create(unsigned width, unsigned height, unsig
 
 		for (y = DCTSIZE; y > 0; y--)
 			rv->samples[c][y - 1] = malloc(bytesperline);
+		if (scale > 1 && !bayer)
+			rv->sums[c] = malloc(rv->width / 2 * (!c + 1) * sizeof(*rv->sums[c]));
+		if (denoise)
+			rv->state[c] = malloc((size_t) width / (2 - !c) * height);
 	}
 
 	rv->base.op = &video_frame_filter_yuv2jpeg_ops;
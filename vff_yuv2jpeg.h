@@ -25,21 +25,76 @@
  * @{
  * @defgroup vff_yuv2jpeg YUV to JPEG filter
  * @{
- * Compresses YUV 4:2:2 (packed) frame to JPEG
+ * Compresses YUV 4:2:2 (packed) or raw Bayer frame to JPEG
  */
 
 #include "vff.h"
+#include "capture.h"
+#include "roi.h"
+
+/** CPU time budget shared by YUV to JPEG filters of all tiers. */
+typedef struct vff_yuv2jpeg_budget_t vff_yuv2jpeg_budget_t;
+
+/**
+ * Creates a CPU time budget to be shared by YUV to JPEG filters.
+ *
+ * @param interval Nominal interval between captured frames, in microseconds.
+ * @param percent Percentage of one CPU core which compression in all filters
+ *                sharing the budget may take together.
+ * @return A budget, or NULL on error.
+ */
+vff_yuv2jpeg_budget_t *vff_yuv2jpeg_budget_create(unsigned interval, unsigned percent);
+
+/**
+ * Destroys a CPU time budget.
+ *
+ * Filters sharing the budget must be destroyed first.
+ *
+ * @param budget The budget.
+ */
+void vff_yuv2jpeg_budget_destroy(vff_yuv2jpeg_budget_t *budget);
 
 /**
  * Creates an instance of a YUV 4:2:2 packed to JPEG frame filter.
  *
- * @param width Width of the frames that will be provided to the filter, in pixels.
- * @param height Height of the frames that will be provided to the filter, in pixels.
- * @param bytesperline Bytes per each line of the frame that will be provided to the filter, including padding, if any.
+ * Raw Bayer frames are accepted too: they are demosaiced line by line
+ * straight into Y, Cb & Cr rows (see @ref bayer_create).
+ *
+ * @param format Format of the frames that will be provided to the filter:
+ *               @ref CAPTURE_FMT__YUV422_PACKED or one of Bayer formats.
  * @param quality Desired quality of JPEG images, of UINT_MAX in case of no preference.
+ * @param scale Downscaling factor (1, 2, 4 or 8); frames are box-filtered to 1/scale of their
+ *              width and height before compression.
+ * @param budget CPU time budget shared with filters of other tiers, or NULL for no limit.
+ *               When time spent on compression of each captured frame by all of them together
+ *               exceeds it, DCT method of a filter is switched to a faster one, then quality is
+ *               lowered, and finally frames are dropped (output size is 0); settings are restored
+ *               when load allows. Filters which take more than their share give up first.
+ * @param huff_interval Number of frames after which Huffman tables are learned again from
+ *                      compressed frames, or 0 to use the default tables.
+ * @param stream If non-zero, frames are compressed within Read(), so compressed data can be
+ *               sent before compression is finished; GetSize() gives @ref VFF_SIZE_UNKNOWN then.
+ * @param replenish If non-zero, each row of MCUs is a restart interval, and rows whose source
+ *                  lines haven't changed since the previous frame aren't compressed again;
+ *                  their compressed data are copied from the previous frame instead.
+ * @param denoise Strength of temporal denoising (1-99), i.e. weight of the previous frame
+ *                in percent, or 0 to disable it. Samples are blended with the denoised
+ *                samples of the previous frame, which removes sensor noise from still areas.
+ * @param denoise_threshold Difference of a sample from the previous frame which is taken as
+ *                          motion, and passed as is, or 0 to denoise all samples.
+ * @param report_frames Number of frames after which average size of denoised frames is
+ *                      printed along with size of a frame compressed without denoising,
+ *                      or 0 for no report.
+ * @param roi Regions of interest, or NULL. Blocks outside them are smoothed before
+ *            compression, so they cost less, but the frame is still a baseline JPEG.
+ * @param cutoff Number of DCT coefficients (in zigzag order, DC included) which should
+ *               survive in blocks outside regions of interest. Smoothing approximates it:
+ *               1 flattens blocks, up to 3 averages 4x4 squares, up to 15 averages 2x2
+ *               squares, and more than that keeps blocks intact.
  * @return An instance of the YUV to JPEG frame filter, or NULL on error.
  */
-video_frame_filter_t *vff_yuv2jpeg_create(unsigned width, unsigned height, unsigned bytesperline, unsigned quality);
+video_frame_filter_t *vff_yuv2jpeg_create(const capture_data_format_t *format, unsigned quality, unsigned scale, vff_yuv2jpeg_budget_t *budget, unsigned huff_interval, int stream, int replenish,
+	unsigned denoise, unsigned denoise_threshold, unsigned report_frames, const roi_t *roi, unsigned cutoff);
 
 /**
  * @}
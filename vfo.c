@@ -0,0 +1,56 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <errno.h>
+#include <unistd.h>
+#include "vfo.h"
+
+/**
+ * @addtogroup vfo
+ * @{
+ */
+
+void vfo_iov_advance(struct iovec **iov, unsigned *count, size_t written)
+{
+	/* skip buffers written completely, and the written part of the next one */
+	for (; *count && written >= (*iov)->iov_len; ++*iov, --*count)
+		written -= (*iov)->iov_len;
+	if (*count) {
+		(*iov)->iov_base = (char *) (*iov)->iov_base + written;
+		(*iov)->iov_len -= written;
+	}
+}
+
+int vfo_writev(int fd, struct iovec *iov, unsigned count)
+{
+	while (count) {
+		ssize_t once = writev(fd, iov, count);
+
+		if (once < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		vfo_iov_advance(&iov, &count, once);
+	}
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -26,7 +26,9 @@
  * Sinks filtered video frames
  */
 
+#include <sys/uio.h>
 #include "vff.h"
+#include "tiers.h"
 
 /** Video frame output instance. */
 typedef struct video_frame_output_t video_frame_output_t;
@@ -42,6 +44,17 @@ typedef struct {
 	 */
 	void (*PutFrame)(video_frame_output_t *base, video_frame_filter_t *filter);
 
+	/**
+	 * Writes the last frame of any tiers the output is interested in.
+	 * Optional (may be NULL); outputs which don't implement it get
+	 * the first tier by PutFrame(). Outputs which keep the captured frame
+	 * after returning take it with capture_frame_hold().
+	 *
+	 * @param base Instance of a video frame output.
+	 * @param tiers Set of output tiers with the last frame put into it.
+	 */
+	void (*PutTiers)(video_frame_output_t *base, video_frame_tiers_t *tiers);
+
 	/**
 	 * Destroys instance of video frame output.
 	 *
@@ -54,9 +67,31 @@ typedef struct {
 /** Video frame filter instance. */
 struct video_frame_output_t {
 	/** Video frame filter operations. */
-	video_frame_output_ops_t *op;
+	const video_frame_output_ops_t *op;
 };
 
+/**
+ * Skips given number of bytes at the beginning of an array of buffers,
+ * e.g. after a partial write.
+ *
+ * @param iov Array of buffers; it's advanced past buffers consumed completely,
+ *            and the first remaining buffer is shortened.
+ * @param count Number of entries in @c iov, decreased accordingly.
+ * @param written Number of bytes to skip.
+ */
+void vfo_iov_advance(struct iovec **iov, unsigned *count, size_t written);
+
+/**
+ * Writes an array of buffers to a file descriptor completely, retrying
+ * after partial writes.
+ *
+ * @param fd File descriptor.
+ * @param iov Array of buffers; it's modified while writing.
+ * @param count Number of entries in @c iov.
+ * @return 0 on success, -1 on error (errno is set).
+ */
+int vfo_writev(int fd, struct iovec *iov, unsigned count);
+
 /**
  * @}
  */
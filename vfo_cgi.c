@@ -28,6 +28,9 @@
 
 /**************************************/
 
+/** Maximum number of chunks of a frame written at once. */
+#define	VFO_CGI_CHUNKS	8
+
 /** Instance of a CGI output. */
 typedef struct {
 	video_frame_output_t base;	/**< Base structure. */
@@ -42,48 +45,54 @@ typedef struct {
 static void video_frame_output_cgi_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
 {
 	video_frame_output_cgi_t *thiz = (video_frame_output_cgi_t *) base;
-	int ok;
-
+	size_t total = filter->op->GetSize(filter), sent = 0;
+	int streaming = total == VFF_SIZE_UNKNOWN, finished;
+	/* part header, chunks of the frame and the boundary */
+	struct iovec iov[1 + VFO_CGI_CHUNKS + 1];
+	char header[128], trailer[sizeof(thiz->boundary) + 8];
+	int length = 0;
+
+	if (!total)
+		return;
 	if (!thiz->boundary_started) {
-		fprintf(thiz->output, "--%s\r\n", thiz->boundary);
+		length = snprintf(header, sizeof(header), "--%s\r\n", thiz->boundary);
 		thiz->boundary_started++;
 	}
-	fprintf(thiz->output, 
-		"Content-type: image/jpeg\r\n"
-		"Content-length: %tu\r\n"
-		"\r\n",
-		filter->op->GetSize(filter));
-
-	for (ok = 1; ok;) {
-		const unsigned char *buffer;
-		size_t size;
-
-		filter->op->Read(filter, &buffer, &size);
-		if (size) {
-			size_t written = 0;
-
-			while (written < size) {
-				int once = fwrite(buffer + written, 1, size - written, thiz->output);
-				if (once <= 0) {
-					perror("fwrite");
-					return;
-				}
-				written += once;
-			}
-			if (written != size) {
-				ok = 0;
-			}
-		} else {
-			break;
-		}
-	}
-
-	if (ok) {
-		fprintf(thiz->output, "\n--%s\r\n", thiz->boundary);
+	if (streaming) {
+		/* length is not known yet; the part ends with the boundary anyway */
+		length += snprintf(header + length, sizeof(header) - length,
+			"Content-type: image/jpeg\r\n"
+			"\r\n");
 	} else {
-		fprintf(thiz->output, "\n--%s--\r\n", thiz->boundary);
+		length += snprintf(header + length, sizeof(header) - length,
+			"Content-type: image/jpeg\r\n"
+			"Content-length: %tu\r\n"
+			"\r\n",
+			total);
 	}
+	iov[0].iov_base = header;
+	iov[0].iov_len = length;
+	/* headers of the response may be still buffered */
 	fflush(thiz->output);
+
+	/* whole frame goes in a single call, unless it's processed while being sent */
+	do {
+		unsigned n = vff_get_chunks(filter, iov + 1, VFO_CGI_CHUNKS), i;
+
+		for (i = 1; i <= n; i++)
+			sent += iov[i].iov_len;
+		finished = !n || (!streaming && sent >= total);
+		if (finished) {
+			iov[n + 1].iov_base = trailer;
+			iov[n + 1].iov_len = snprintf(trailer, sizeof(trailer), "\n--%s\r\n", thiz->boundary);
+			n++;
+		}
+		if (vfo_writev(fileno(thiz->output), iov, n + 1)) {
+			perror("writev");
+			return;
+		}
+		iov[0].iov_len = 0;
+	} while (!finished);
 }
 
 /** @copydoc video_frame_output_ops_t::Destroy */
@@ -96,7 +105,7 @@ static void video_frame_output_cgi_Destroy(video_frame_output_t *base)
 }
 
 /** Operations of the CGI output. */
-video_frame_output_ops_t video_frame_output_cgi_ops = {
+static const video_frame_output_ops_t video_frame_output_cgi_ops = {
 	.PutFrame = video_frame_output_cgi_PutFrame,
 	.Destroy = video_frame_output_cgi_Destroy,
 };
@@ -19,7 +19,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "vfo_files.h"
+#ifdef	USE_IO_URING
+#include "uring.h"
+#endif
 
 /**
  * @addtogroup vfo_files
@@ -28,52 +33,88 @@
 
 /**************************************/
 
+/** Maximum number of chunks of a frame written at once. */
+#define	VFO_FILES_CHUNKS	8
+
 /** Instance of a multiple files output. */
 typedef struct {
 	video_frame_output_t base;	/**< Base structure. */
 	int frame_no;				/**< Frame number, incremented each frame, used to create output file name. */
+#ifdef	USE_IO_URING
+	uring_t *ring;				/**< io_uring writing each file in one go, or NULL if not supported. */
+#endif
 } video_frame_output_files_t;
 
 /**************************************/
 
+#ifdef	USE_IO_URING
+/**
+ * Writes a frame to a file using io_uring. Opening, writing and closing
+ * the file take one system call, unless the frame comes in parts.
+ *
+ * @param thiz Instance of a multiple files output.
+ * @param filter Instance of a video frame filter from which the data will be read.
+ * @param fname Name of the file.
+ * @return 0 on success, -1 on error.
+ */
+static int video_frame_output_files_uring(video_frame_output_files_t *thiz, video_frame_filter_t *filter, const char *fname)
+{
+	size_t total = filter->op->GetSize(filter), written = 0;
+	int flags = URING_OPEN;
+
+	for (;;) {
+		struct iovec iov[VFO_FILES_CHUNKS];
+		unsigned n = vff_get_chunks(filter, iov, VFO_FILES_CHUNKS), i;
+
+		for (i = 0; i < n; i++)
+			written += iov[i].iov_len;
+		if (!n || (total != VFF_SIZE_UNKNOWN && written >= total))
+			flags |= URING_CLOSE;
+		if (uring_write(thiz->ring, fname, iov, n, flags))
+			return -1;
+		if (flags & URING_CLOSE)
+			return 0;
+		flags = 0;
+	}
+}
+#endif
+
 /** @copydoc video_frame_output_ops_t::PutFrame */
 static void video_frame_output_files_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
 {
 	video_frame_output_files_t *thiz = (video_frame_output_files_t *) base;
-    char fname[32];
-    FILE *f;
+	struct iovec iov[VFO_FILES_CHUNKS];
+	char fname[32];
+	unsigned n;
+	int fd;
 
 	if (!filter->op->GetSize(filter))
 		return;
 
-    sprintf(fname, "capture/%08d.jpg", thiz->frame_no++);
-    f = fopen(fname, "w");
-    if (f) {
-		for (;;) {
-			const unsigned char *buffer;
-			size_t size;
-
-			filter->op->Read(filter, &buffer, &size);
-			if (size) {
-				size_t written;
-				ssize_t once;
-
-				for (written = 0; written < size; written += once) {
-					once = fwrite(buffer + written, 1, size - written, f);
-					if (once <= 0) {
-						perror("fwrite");
-						return;
-					}
-				}
-			} else {
-				break;
-			}
+	sprintf(fname, "capture/%08d.jpg", thiz->frame_no++);
+#ifdef	USE_IO_URING
+	if (thiz->ring) {
+		if (video_frame_output_files_uring(thiz, filter, fname))
+			perror(fname);
+		else
+			fprintf(stderr, "%s created\n", fname);
+		return;
+	}
+#endif
+	fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		perror(fname);
+		return;
+	}
+	while ((n = vff_get_chunks(filter, iov, VFO_FILES_CHUNKS)) > 0) {
+		if (vfo_writev(fd, iov, n)) {
+			perror(fname);
+			break;
 		}
-		fclose(f);
-		fprintf(stderr, "%s created\n", fname);
-	} else {
-        perror(fname);
 	}
+	close(fd);
+	if (!n)
+		fprintf(stderr, "%s created\n", fname);
 }
 
 /** @copydoc video_frame_output_ops_t::Destroy */
@@ -81,11 +122,15 @@ static void video_frame_output_files_Destroy(video_frame_output_t *base)
 {
 	video_frame_output_files_t *thiz = (video_frame_output_files_t *) base;
 
+#ifdef	USE_IO_URING
+	if (thiz->ring)
+		uring_destroy(thiz->ring);
+#endif
 	free(thiz);
 }
 
 /** Operations of the multiple files output. */
-video_frame_output_ops_t video_frame_output_files_ops = {
+static const video_frame_output_ops_t video_frame_output_files_ops = {
 	.PutFrame = video_frame_output_files_PutFrame,
 	.Destroy = video_frame_output_files_Destroy,
 };
@@ -96,6 +141,11 @@ video_frame_output_t *video_frame_output_files_init(void)
 {
 	video_frame_output_files_t *rv = (video_frame_output_files_t *) calloc(1, sizeof(video_frame_output_files_t));
 	rv->base.op = &video_frame_output_files_ops;
+#ifdef	USE_IO_URING
+	rv->ring = uring_create();
+	if (!rv->ring)
+		perror("io_uring");
+#endif
 	return &rv->base;
 }
 
@@ -20,12 +20,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
-#include <unistd.h>
+#include <linux/sockios.h>
 #include "vfo_http.h"
-#include "vfo_cgi.h"
+#include "frame_store.h"
 
 /**
  * @addtogroup vfo_http
@@ -34,24 +45,202 @@
 
 /**************************************/
 
+/** Maximum number of worker threads. */
+#define	HTTP_WORKERS_MAX	64
+/** Maximum length of HTTP request headers. */
+#define	HTTP_REQUEST_MAX	1024
+/** Number of events handled by a worker at once. */
+#define	HTTP_EVENTS			64
+/** Maximum number of tiers served. */
+#define	HTTP_TIERS_MAX		8
+/** Tier chosen by tier=low: the last one. */
+#define	HTTP_TIER_LOW		UINT_MAX
+/** Number of frames after which an adaptive stream may change its tier. */
+#define	HTTP_ADAPT_WINDOW	25
+/** Minimum number of windows without late frames before a better tier is tried. */
+#define	HTTP_ADAPT_PATIENCE	2
+/** Maximum number of windows without late frames before a better tier is tried. */
+#define	HTTP_ADAPT_PATIENCE_MAX	64
+/** Lowest frame rate a client may ask for (once per about 17 minutes). */
+#define	HTTP_FPS_MIN		0.001
+
+typedef struct video_frame_output_http_t video_frame_output_http_t;
+typedef struct http_client_t http_client_t;
+
+/** What a client is doing. */
+typedef enum {
+	HTTP_CLIENT_REQUEST,	/**< Sending a request. */
+	HTTP_CLIENT_RESPONSE,	/**< Receiving a single response. */
+	HTTP_CLIENT_WAIT,		/**< Waiting for a frame newer than @c seq, which will be the response. */
+	HTTP_CLIENT_STREAM,		/**< Receiving a stream of frames. */
+} http_client_state_e;
+
+/** Resource asked for by a request. */
+typedef enum {
+	HTTP_ROUTE_STREAM,		/**< Stream of frames as multipart/x-mixed-replace. */
+	HTTP_ROUTE_SNAPSHOT,	/**< The latest frame. */
+	HTTP_ROUTE_NEXT,		/**< The next frame, once it comes. */
+	HTTP_ROUTE_STATS,		/**< Statistics of the server. */
+	HTTP_ROUTE_NOT_FOUND,	/**< Unknown resource. */
+	HTTP_ROUTE_BAD_METHOD,	/**< Request other than GET. */
+} http_route_e;
+
+/** Parsed request. */
+typedef struct {
+	http_route_e route;		/**< Resource asked for. */
+	int keep_alive;			/**< Whether the connection should stay open after the response. */
+	unsigned long seen;		/**< Sequence number of the frame the client already has (from If-None-Match), or 0. */
+	unsigned tier;			/**< Tier asked for (tier=), or @ref HTTP_TIER_LOW. */
+	int adaptive;			/**< Whether the tier should follow throughput of the connection (no tier= or tier=auto). */
+	uint64_t interval;		/**< Minimum interval between frames of a stream in ns (fps=), or 0. */
+	unsigned maxkbps;		/**< Maximum bit rate of a stream in kbit/s (maxkbps=), or 0. */
+} http_request_t;
+
+/** Connection of an HTTP client. */
+struct http_client_t {
+	int sock;						/**< Client socket. */
+	uint32_t events;				/**< Events the socket is polled for. */
+	http_client_t *prev;			/**< Previous client of the worker. */
+	http_client_t *next;			/**< Next client of the worker. */
+	http_client_state_e state;		/**< What the client is doing. */
+	int keep_alive;					/**< Whether the connection stays open after the response. */
+	int eof;						/**< Whether the client has shut down its side of the connection. */
+	size_t request_length;			/**< Length of @c request received so far. */
+	char request[HTTP_REQUEST_MAX];	/**< Request headers, possibly followed by next requests. */
+	shared_frame_t *frame;			/**< Frame being sent, or NULL. */
+	unsigned long seq;				/**< Sequence number of the last frame sent. */
+	unsigned tier;					/**< Tier whose frames are sent. */
+	int watching;					/**< Whether the client is counted among viewers of @c tier. */
+	uint64_t interval;				/**< Minimum interval between frames of the stream in ns, or 0. */
+	unsigned maxkbps;				/**< Maximum bit rate of the stream in kbit/s, or 0. */
+	uint64_t due;					/**< Time (@ref http_now) before which the next frame of the stream isn't sent. */
+	int adaptive;					/**< Whether @c tier follows throughput of the connection. */
+	unsigned adapt_frames;			/**< Number of frames which came in the current window. */
+	unsigned adapt_late;			/**< Number of frames of the current window which came while the client was behind. */
+	unsigned adapt_clean;			/**< Number of windows in a row without late frames. */
+	unsigned adapt_patience;		/**< Number of clean windows needed before a better tier is tried. */
+	int adapt_probing;				/**< Whether the tier has been just made better, and it's not known yet whether it fits. */
+	size_t header_length;			/**< Length of @c header to be sent before the next part. */
+	char header[1024];				/**< Response headers and a short body, or headers of the part. */
+	struct iovec iov[3];			/**< Headers, frame data, boundary. */
+	struct iovec *pending;			/**< Part of @c iov which is still to be sent. */
+	unsigned pending_count;			/**< Number of entries in @c pending. */
+};
+
+/** Statistics of a worker, read by other workers. */
+typedef struct {
+	unsigned long clients;			/**< Number of connected clients. */
+	unsigned long streams;			/**< Number of clients receiving a stream. */
+	unsigned long requests;			/**< Number of requests handled so far. */
+	unsigned long long bytes;		/**< Number of bytes sent so far. */
+} http_stats_t;
+
+/** Network worker thread with its own listening socket and clients. */
+typedef struct {
+	video_frame_output_http_t *server;	/**< Server the worker belongs to. */
+	pthread_t thread;				/**< Thread of the worker. */
+	int started;					/**< Whether @c thread has been started. */
+	int listener;					/**< Listening socket, sharing the port with other workers. */
+	int epoll;						/**< Set of polled descriptors. */
+	int event;						/**< Signalled when there's a new frame or the server stops. */
+	http_client_t *clients;			/**< List of clients. */
+	http_stats_t stats;				/**< Statistics, updated atomically. */
+} http_worker_t;
+
+/** Instance of an HTTP output. */
+struct video_frame_output_http_t {
+	video_frame_output_t base;		/**< Base structure. */
+	frame_store_t *store[HTTP_TIERS_MAX];	/**< The latest frame of each tier shared by all the workers. */
+	unsigned viewers[HTTP_TIERS_MAX];	/**< Number of clients waiting for frames of each tier, updated atomically. */
+	int subscribed[HTTP_TIERS_MAX];	/**< Whether tiers are subscribed on behalf of viewers (by the main thread). */
+	unsigned tiers;					/**< Number of tiers served, known since the first frame; read atomically. */
+	int stop;						/**< Whether workers should quit. */
+	char boundary[32];				/**< Boundary separating parts of multipart/x-mixed-replace MIME type; its beginning identifies the server in ETags. */
+	char trailer[40];				/**< Boundary sent after each part. */
+	size_t trailer_length;			/**< Length of @c trailer. */
+	unsigned count;					/**< Number of workers. */
+	http_worker_t worker[];			/**< Workers (@c count entries). */
+};
+
+/** Number of characters of the boundary used to tell our ETags from those of another instance. */
+#define	HTTP_ETAG_ID		8
+
+/** Updates a statistic counter of a worker. */
+#define	HTTP_STAT_ADD(worker, counter, n)	__atomic_add_fetch(&(worker)->stats.counter, (n), __ATOMIC_RELAXED)
+
+/**************************************/
+
 /**
- * Creates a socket for listening on given TCP port.
+ * Reads a monotonic clock.
  *
- * @param port TCP port number.
+ * @return Current time in ns.
+ */
+static uint64_t http_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Finds the tier actually served in place of the one asked for.
+ *
+ * @param server Instance of an HTTP output.
+ * @param tier Tier asked for, or @ref HTTP_TIER_LOW.
+ * @return Index of an existing tier.
+ */
+static unsigned http_resolve_tier(video_frame_output_http_t *server, unsigned tier)
+{
+	unsigned count = __atomic_load_n(&server->tiers, __ATOMIC_RELAXED);
+
+	/* before the first frame only the first tier is known to exist */
+	if (!count)
+		return 0;
+	return tier < count ? tier : count - 1;
+}
+
+/**
+ * Counts a client among viewers of its tier, or stops counting it,
+ * so that the tier is processed only while somebody waits for it.
+ *
+ * @param server Instance of an HTTP output.
+ * @param client HTTP client.
+ * @param watching Whether the client waits for frames of its tier.
+ */
+static void http_client_watch(video_frame_output_http_t *server, http_client_t *client, int watching)
+{
+	if (client->watching == watching)
+		return;
+	client->watching = watching;
+	__atomic_add_fetch(&server->viewers[client->tier], watching ? 1 : -1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Creates a non-blocking socket for listening on given TCP port.
+ * Many sockets can listen on the same port; connections are spread among them.
+ *
+ * @param port TCP port number; on return it's the actual port if 0 was given.
  * @return Open socket, or -1 on error.
  */
-static int create_server_socket(unsigned short port)
+static int create_server_socket(unsigned short *port)
 {
-	int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
 
 	if (sock >= 0) {
 		do {
 			struct sockaddr_in addr;
 			socklen_t len;
+			int one = 1;
+
+			if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+				break;
+			if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+				break;
 
 			memset(&addr, 0, sizeof(addr));
 			addr.sin_family = AF_INET;
-			addr.sin_port = htons(port);
+			addr.sin_port = htons(*port);
 
 			if (bind(sock, (const struct sockaddr *) &addr, sizeof(addr)))
 				break;
@@ -59,8 +248,9 @@ static int create_server_socket(unsigned short port)
 			len = sizeof(addr);
 			if (getsockname(sock, (struct sockaddr *) &addr, &len))
 				break;
+			*port = ntohs(addr.sin_port);
 
-			if (listen(sock, 1))
+			if (listen(sock, SOMAXCONN))
 				break;
 
 			return sock;
@@ -73,64 +263,962 @@ static int create_server_socket(unsigned short port)
 }
 
 /**
- * Reads and parses HTTP query on given input.
+ * Checks whether a header line has given name, and finds its value.
  *
- * Expected query is prefixed by "GET /".
+ * @param line Header line.
+ * @param name Header name followed by a colon.
+ * @return Value of the header with leading spaces skipped, or NULL if the name doesn't match.
+ */
+static const char *http_header_value(const char *line, const char *name)
+{
+	size_t length = strlen(name);
+
+	if (strncasecmp(line, name, length))
+		return NULL;
+	for (line += length; *line == ' ' || *line == '\t'; line++)
+		;
+	return line;
+}
+
+/**
+ * Finds the newest of our frames listed in If-None-Match header.
  *
- * @param input Input file where HTTP query is expected.
- * @return 0 on success, other value if input doesn't match the expected query.
+ * @param server Instance of an HTTP output.
+ * @param value Value of the header, up to the end of line.
+ * @param tier Tier of the frame.
+ * @return Sequence number of the frame, or 0 if there's none.
  */
-static int get_query(FILE *input)
+static unsigned long http_parse_etags(video_frame_output_http_t *server, const char *value, unsigned tier)
 {
-	static char expected_query_pfx[] = "GET /";
-	char buf[128];
+	unsigned long rv = 0;
 
-	do {
-		if (!fgets(buf, sizeof(buf), input))
+	while (*value && *value != '\r' && *value != '\n') {
+		unsigned long seq;
+		unsigned t;
+		int n = 0;
+
+		if (!strncmp(value, "W/", 2))
+			value += 2;
+		if (*value == '"' && !strncmp(value + 1, server->boundary, HTTP_ETAG_ID)
+			&& sscanf(value + 1 + HTTP_ETAG_ID, "-%u-%lu\"%n", &t, &seq, &n) == 2 && n && t == tier && seq > rv)
+			rv = seq;
+		/* next entity tag */
+		value += strcspn(value, ",\r\n");
+		value += strspn(value, ", \t");
+	}
+	return rv;
+}
+
+/**
+ * Parses parameters given in the query string of a request.
+ *
+ * @param query Query string (after '?'), up to a space.
+ * @param request Receives parameters.
+ * @return 0 on success, -1 if a parameter is malformed.
+ */
+static int http_parse_query(const char *query, http_request_t *request)
+{
+	while (*query && *query != ' ') {
+		size_t length = strcspn(query, "& ");
+		double fps;
+		int n = 0;
+
+		if (!strncmp(query, "tier=", 5)) {
+			request->adaptive = !strncmp(query + 5, "auto", 4) && length == 9;
+			if (request->adaptive)
+				request->tier = 0;
+			else if (!strncmp(query + 5, "low", 3) && length == 8)
+				request->tier = HTTP_TIER_LOW;
+			else if (!strncmp(query + 5, "high", 4) && length == 9)
+				request->tier = 0;
+			else if (sscanf(query + 5, "%u%n", &request->tier, &n) != 1 || 5 + (size_t) n != length)
+				return -1;
+		} else if (!strncmp(query, "fps=", 4)) {
+			if (sscanf(query + 4, "%lf%n", &fps, &n) != 1 || 4 + (size_t) n != length || !(fps > 0))
+				return -1;
+			/* keep the interval within range of its type */
+			if (fps < HTTP_FPS_MIN)
+				fps = HTTP_FPS_MIN;
+			request->interval = 1e9 / fps;
+		} else if (!strncmp(query, "maxkbps=", 8)) {
+			if (sscanf(query + 8, "%u%n", &request->maxkbps, &n) != 1 || 8 + (size_t) n != length)
+				return -1;
+		}
+		/* unknown parameters are ignored */
+		query += length;
+		if (*query == '&')
+			query++;
+	}
+	return 0;
+}
+
+/**
+ * Parses a request received so far.
+ *
+ * @param server Instance of an HTTP output.
+ * @param client HTTP client.
+ * @param request Receives the parsed request.
+ * @return Length of the request if it's complete, 0 if it's incomplete,
+ *         -1 if it's malformed.
+ */
+static int http_request_parse(video_frame_output_http_t *server, http_client_t *client, http_request_t *request)
+{
+	char *end, *line, *path;
+	size_t path_length;
+	int length;
+
+	client->request[client->request_length] = '\0';
+	end = strstr(client->request, "\r\n\r\n");
+	if (end) {
+		length = end + 4 - client->request;
+	} else {
+		end = strstr(client->request, "\n\n");
+		if (!end)
+			return client->request_length < sizeof(client->request) - 1 ? 0 : -1;
+		length = end + 2 - client->request;
+	}
+
+	/* request line */
+	path = strchr(client->request, ' ');
+	if (!path || path > end || path[1] != '/')
+		return -1;
+	path++;
+	path_length = strcspn(path, "? \r\n");
+	line = strchr(path, ' ');
+	if (!line || line > end || strncmp(line + 1, "HTTP/1.", 7))
+		return -1;
+	/* HTTP/1.1 keeps the connection by default */
+	request->keep_alive = line[8] != '0';
+	request->seen = 0;
+	request->tier = 0;
+	/* a stream follows throughput of the connection, unless a tier is given */
+	request->adaptive = 1;
+	request->interval = 0;
+	request->maxkbps = 0;
+	if (path[path_length] == '?' && http_parse_query(path + path_length + 1, request))
+		return -1;
+	request->tier = http_resolve_tier(server, request->tier);
+
+	if (strncmp(client->request, "GET ", 4))
+		request->route = HTTP_ROUTE_BAD_METHOD;
+	else if (path_length == 1 || (path_length == 7 && !strncmp(path, "/stream", 7)))
+		request->route = HTTP_ROUTE_STREAM;
+	else if (path_length == 13 && !strncmp(path, "/snapshot.jpg", 13))
+		request->route = HTTP_ROUTE_SNAPSHOT;
+	else if (path_length == 9 && !strncmp(path, "/next.jpg", 9))
+		request->route = HTTP_ROUTE_NEXT;
+	else if (path_length == 6 && !strncmp(path, "/stats", 6))
+		request->route = HTTP_ROUTE_STATS;
+	else
+		request->route = HTTP_ROUTE_NOT_FOUND;
+
+	/* headers */
+	for (line = strchr(line, '\n') + 1; line < end; line = strchr(line, '\n') + 1) {
+		const char *value;
+
+		if ((value = http_header_value(line, "Connection:"))) {
+			if (!strncasecmp(value, "close", 5))
+				request->keep_alive = 0;
+			else if (!strncasecmp(value, "keep-alive", 10))
+				request->keep_alive = 1;
+		} else if ((value = http_header_value(line, "If-None-Match:"))) {
+			request->seen = http_parse_etags(server, value, request->tier);
+		}
+	}
+	return length;
+}
+
+/**
+ * Changes the set of events a client socket is polled for.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ * @param out Whether the client is waiting for the socket to accept more data.
+ */
+static void http_client_poll(http_worker_t *worker, http_client_t *client, int out)
+{
+	struct epoll_event event;
+	uint32_t events = (client->eof ? 0 : EPOLLIN | EPOLLRDHUP) | (out ? EPOLLOUT : 0);
+
+	if (client->events == events)
+		return;
+	event.events = events;
+	event.data.ptr = client;
+	if (!epoll_ctl(worker->epoll, EPOLL_CTL_MOD, client->sock, &event))
+		client->events = events;
+}
+
+/**
+ * Checks how much of the stream is queued in the socket, not sent yet
+ * because the connection can't carry more.
+ *
+ * @param client HTTP client.
+ * @return Number of bytes not sent yet.
+ */
+static size_t http_client_backlog(http_client_t *client)
+{
+	int queued;
+
+	if (ioctl(client->sock, SIOCOUTQNSD, &queued) || queued < 0)
+		return 0;
+	return queued;
+}
+
+/**
+ * Moves an adaptive stream to a smaller tier when the client lags,
+ * or to a better one after it keeps up for long enough. A better tier
+ * which turns out too much makes the client wait twice as long before
+ * the next try; one which fits for that long halves the wait.
+ *
+ * @param server Instance of an HTTP output.
+ * @param client HTTP client receiving an adaptive stream.
+ * @param late Whether a new frame has come while the client was behind.
+ */
+static void http_client_adapt(video_frame_output_http_t *server, http_client_t *client, int late)
+{
+	unsigned count = __atomic_load_n(&server->tiers, __ATOMIC_RELAXED), tier = client->tier;
+
+	client->adapt_frames++;
+	if (late)
+		client->adapt_late++;
+	if (client->adapt_late * 4 >= HTTP_ADAPT_WINDOW) {
+		/* a quarter of the window is lost already */
+		if (client->adapt_probing && client->adapt_patience < HTTP_ADAPT_PATIENCE_MAX)
+			client->adapt_patience *= 2;
+		client->adapt_probing = 0;
+		client->adapt_clean = 0;
+		if (tier + 1 < count)
+			tier++;
+	} else if (client->adapt_frames >= HTTP_ADAPT_WINDOW) {
+		if (client->adapt_late) {
+			client->adapt_clean = 0;
+		} else if (++client->adapt_clean >= client->adapt_patience) {
+			if (client->adapt_probing && client->adapt_patience > HTTP_ADAPT_PATIENCE) {
+				/* the better tier has been fitting for long enough */
+				client->adapt_patience /= 2;
+			}
+			client->adapt_probing = 0;
+			client->adapt_clean = 0;
+			if (tier) {
+				tier--;
+				client->adapt_probing = 1;
+			}
+		}
+	} else {
+		return;
+	}
+	client->adapt_frames = 0;
+	client->adapt_late = 0;
+	if (tier != client->tier) {
+		http_client_watch(server, client, 0);
+		client->tier = tier;
+		client->seq = 0;
+		http_client_watch(server, client, 1);
+	}
+}
+
+/**
+ * Prepares a frame to be sent to a client as the next part of the stream.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client which isn't sending any frame now.
+ * @param frame Frame; the client takes a new reference to it.
+ */
+static void http_client_begin(http_worker_t *worker, http_client_t *client, shared_frame_t *frame)
+{
+	video_frame_output_http_t *server = worker->server;
+
+	__atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+	client->frame = frame;
+	client->seq = frame->seq;
+	if (client->interval || client->maxkbps) {
+		uint64_t now = http_now(), due = now + client->interval;
+
+		/* time it takes to send the frame at the maximum bit rate */
+		if (client->maxkbps && now + frame->size * UINT64_C(8000000) / client->maxkbps > due)
+			due = now + frame->size * UINT64_C(8000000) / client->maxkbps;
+		client->due = due;
+	}
+	client->header_length += snprintf(client->header + client->header_length, sizeof(client->header) - client->header_length,
+		"Content-type: image/jpeg\r\n"
+		"Content-length: %tu\r\n"
+		"\r\n",
+		frame->size);
+	client->iov[0].iov_base = client->header;
+	client->iov[0].iov_len = client->header_length;
+	client->iov[1].iov_base = frame->data;
+	client->iov[1].iov_len = frame->size;
+	client->iov[2].iov_base = server->trailer;
+	client->iov[2].iov_len = server->trailer_length;
+	client->pending = client->iov;
+	client->pending_count = 3;
+	client->header_length = 0;
+}
+
+/**
+ * Prepares a single response to be sent to a client.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ * @param status Status code and reason phrase.
+ * @param frame Frame to be the body (the client takes a new reference to it), or NULL.
+ * @param seq Sequence number of the frame identified by ETag, or 0 if there's none.
+ * @param type Type of the body, or NULL if there's no body.
+ * @param body Body if it's not a frame, or NULL.
+ */
+static void http_client_reply(http_worker_t *worker, http_client_t *client, const char *status,
+	shared_frame_t *frame, unsigned long seq, const char *type, const char *body)
+{
+	video_frame_output_http_t *server = worker->server;
+	size_t length = frame ? frame->size : body ? strlen(body) : 0;
+	int n;
+
+	n = snprintf(client->header, sizeof(client->header),
+		"HTTP/1.1 %s\r\n"
+		"Connection: %s\r\n"
+		"Server: OLO Webcam CGI v1.2\r\n"
+		"Cache-Control: no-cache\r\n",
+		status, client->keep_alive ? "keep-alive" : "close");
+	if (seq)
+		n += snprintf(client->header + n, sizeof(client->header) - n, "ETag: \"%.*s-%u-%lu\"\r\n", HTTP_ETAG_ID, server->boundary, client->tier, seq);
+	if (type)
+		n += snprintf(client->header + n, sizeof(client->header) - n, "Content-type: %s\r\n", type);
+	if (type || !seq)
+		n += snprintf(client->header + n, sizeof(client->header) - n, "Content-length: %tu\r\n", length);
+	n += snprintf(client->header + n, sizeof(client->header) - n, "\r\n%s", frame || !body ? "" : body);
+
+	client->state = HTTP_CLIENT_RESPONSE;
+	http_client_watch(server, client, 0);
+	client->iov[0].iov_base = client->header;
+	client->iov[0].iov_len = n;
+	client->pending = client->iov;
+	client->pending_count = 1;
+	if (frame) {
+		__atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+		client->frame = frame;
+		client->iov[1].iov_base = frame->data;
+		client->iov[1].iov_len = frame->size;
+		client->pending_count++;
+	}
+}
+
+/**
+ * Prepares statistics of the server to be sent to a client.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ */
+static void http_client_reply_stats(http_worker_t *worker, http_client_t *client)
+{
+	video_frame_output_http_t *server = worker->server;
+	unsigned count = __atomic_load_n(&server->tiers, __ATOMIC_RELAXED);
+	http_stats_t total;
+	char body[640];
+	unsigned i;
+	int n;
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < server->count; i++) {
+		http_stats_t *stats = &server->worker[i].stats;
+
+		total.clients += __atomic_load_n(&stats->clients, __ATOMIC_RELAXED);
+		total.streams += __atomic_load_n(&stats->streams, __ATOMIC_RELAXED);
+		total.requests += __atomic_load_n(&stats->requests, __ATOMIC_RELAXED);
+		total.bytes += __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED);
+	}
+	n = snprintf(body, sizeof(body),
+		"{\"workers\":%u,\"clients\":%lu,\"streams\":%lu,\"requests\":%lu,\"bytes_sent\":%llu,\"tiers\":[",
+		server->count, total.clients, total.streams, total.requests, total.bytes);
+	for (i = 0; i < count; i++) {
+		shared_frame_t *frame = frame_store_get(server->store[i]);
+
+		n += snprintf(body + n, sizeof(body) - n, "%s{\"frames\":%lu,\"frame_size\":%tu,\"viewers\":%u}",
+			i ? "," : "", frame ? frame->seq : 0, frame ? frame->size : 0,
+			__atomic_load_n(&server->viewers[i], __ATOMIC_RELAXED));
+		if (frame)
+			shared_frame_release(frame);
+	}
+	snprintf(body + n, sizeof(body) - n, "]}\n");
+	http_client_reply(worker, client, "200 OK", NULL, 0, "application/json", body);
+}
+
+static int http_client_flush(http_worker_t *worker, http_client_t *client);
+
+/**
+ * Handles a request, if a complete one has been received.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client which isn't responding to anything now.
+ * @return 0 on success, -1 if the connection should be closed.
+ */
+static int http_client_request(http_worker_t *worker, http_client_t *client)
+{
+	video_frame_output_http_t *server = worker->server;
+	http_request_t request;
+	shared_frame_t *frame;
+	int length = http_request_parse(server, client, &request);
+
+	if (!length) {
+		if (client->eof)
+			return -1;
+		http_client_poll(worker, client, 0);
+		return 0;
+	}
+	if (length < 0) {
+		client->keep_alive = 0;
+		http_client_reply(worker, client, "400 Bad Request", NULL, 0, "text/plain", "Bad request\n");
+		return http_client_flush(worker, client);
+	}
+	/* forget the request, but keep next ones which may follow */
+	client->request_length -= length;
+	memmove(client->request, client->request + length, client->request_length);
+	client->keep_alive = request.keep_alive && !client->eof;
+	client->tier = request.tier;
+	HTTP_STAT_ADD(worker, requests, 1);
+
+	if (request.route == HTTP_ROUTE_SNAPSHOT && client->tier
+		&& !__atomic_load_n(&server->viewers[client->tier], __ATOMIC_RELAXED)) {
+		/* nobody is watching this tier, so its last frame may be old; wait for a fresh one */
+		request.route = HTTP_ROUTE_NEXT;
+		request.seen = 0;
+	}
+	switch (request.route) {
+		case HTTP_ROUTE_STREAM:
+			client->state = HTTP_CLIENT_STREAM;
+			client->seq = 0;
+			client->interval = request.interval;
+			client->maxkbps = request.maxkbps;
+			client->due = 0;
+			client->adaptive = request.adaptive;
+			client->adapt_frames = client->adapt_late = client->adapt_clean = 0;
+			client->adapt_patience = HTTP_ADAPT_PATIENCE;
+			client->adapt_probing = 0;
+			http_client_watch(server, client, 1);
+			client->header_length = snprintf(client->header, sizeof(client->header),
+				"HTTP/1.0 200 OK\r\n"
+				"Connection: close\r\n"
+				"Server: OLO Webcam CGI v1.2\r\n"
+				"Pragma: no-cache\r\n"
+				"Content-type: multipart/x-mixed-replace; boundary=%s\r\n"
+				"\r\n"
+				"--%s\r\n",
+				server->boundary, server->boundary);
+			HTTP_STAT_ADD(worker, streams, 1);
+			break;
+		case HTTP_ROUTE_SNAPSHOT:
+			frame = frame_store_get(server->store[client->tier]);
+			if (!frame) {
+				http_client_reply(worker, client, "503 Service Unavailable", NULL, 0, "text/plain", "No frame yet\n");
+			} else if (frame->seq == request.seen) {
+				http_client_reply(worker, client, "304 Not Modified", NULL, frame->seq, NULL, NULL);
+			} else {
+				http_client_reply(worker, client, "200 OK", frame, frame->seq, "image/jpeg", NULL);
+			}
+			if (frame)
+				shared_frame_release(frame);
+			break;
+		case HTTP_ROUTE_NEXT:
+			/* a frame newer than the one the client has, or than the latest one */
+			frame = frame_store_get(server->store[client->tier]);
+			client->state = HTTP_CLIENT_WAIT;
+			client->seq = request.seen ? request.seen : frame ? frame->seq : 0;
+			if (frame && frame->seq > client->seq)
+				http_client_reply(worker, client, "200 OK", frame, frame->seq, "image/jpeg", NULL);
+			else
+				http_client_watch(server, client, 1);
+			if (frame)
+				shared_frame_release(frame);
+			break;
+		case HTTP_ROUTE_STATS:
+			http_client_reply_stats(worker, client);
 			break;
-		if (strncmp(buf, expected_query_pfx, sizeof(expected_query_pfx) - 1))
+		case HTTP_ROUTE_NOT_FOUND:
+			http_client_reply(worker, client, "404 Not Found", NULL, 0, "text/plain", "Not found\n");
 			break;
-		while (fgets(buf, sizeof(buf), input)) {
-			char *p;
+		default:
+			client->keep_alive = 0;
+			http_client_reply(worker, client, "405 Method Not Allowed", NULL, 0, "text/plain", "Method not allowed\n");
+			break;
+	}
+	return http_client_flush(worker, client);
+}
 
-			for (p = buf; *p == '\n' || *p == '\r'; p++)
-				;
-			if (!*p)
-				break;
+/**
+ * Sends as much of the response to a client as possible without blocking.
+ *
+ * In a stream, when a frame is sent completely, the latest one follows,
+ * unless it's been already sent; frames which came meanwhile are skipped.
+ * When a single response is sent, the next request is handled, unless
+ * the connection shouldn't be kept.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ * @return 0 on success, -1 if the connection should be closed.
+ */
+static int http_client_flush(http_worker_t *worker, http_client_t *client)
+{
+	for (;;) {
+		struct msghdr msg;
+		ssize_t once;
+
+		if (!client->pending_count) {
+			shared_frame_t *frame;
+
+			if (client->frame) {
+				shared_frame_release(client->frame);
+				client->frame = NULL;
+			}
+			switch (client->state) {
+				case HTTP_CLIENT_STREAM:
+					/* the next frame waits until it's due */
+					if (client->due && http_now() < client->due) {
+						http_client_poll(worker, client, 0);
+						return client->eof ? -1 : 0;
+					}
+					frame = frame_store_get(worker->server->store[client->tier]);
+					/* an adaptive stream doesn't pile frames up in the socket */
+					if (!frame || frame->seq == client->seq
+						|| (client->adaptive && http_client_backlog(client) > frame->size / 2)) {
+						if (frame)
+							shared_frame_release(frame);
+						http_client_poll(worker, client, 0);
+						return client->eof ? -1 : 0;
+					}
+					http_client_begin(worker, client, frame);
+					shared_frame_release(frame);
+					break;
+				case HTTP_CLIENT_RESPONSE:
+					if (!client->keep_alive)
+						return -1;
+					client->state = HTTP_CLIENT_REQUEST;
+					return http_client_request(worker, client);
+				default:
+					http_client_poll(worker, client, 0);
+					return 0;
+			}
 		}
-		return 0;
-	} while (0);
-	return -1;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = client->pending;
+		msg.msg_iovlen = client->pending_count;
+		once = sendmsg(client->sock, &msg, MSG_NOSIGNAL);
+		if (once < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				http_client_poll(worker, client, 1);
+				return 0;
+			}
+			return -1;
+		}
+		HTTP_STAT_ADD(worker, bytes, once);
+		vfo_iov_advance(&client->pending, &client->pending_count, once);
+	}
 }
 
-/**************************************/
+/**
+ * Closes connection of a client and forgets it.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ */
+static void http_client_close(http_worker_t *worker, http_client_t *client)
+{
+	if (client->prev)
+		client->prev->next = client->next;
+	else
+		worker->clients = client->next;
+	if (client->next)
+		client->next->prev = client->prev;
+	if (client->frame)
+		shared_frame_release(client->frame);
+	http_client_watch(worker->server, client, 0);
+	if (client->state == HTTP_CLIENT_STREAM)
+		HTTP_STAT_ADD(worker, streams, -1);
+	HTTP_STAT_ADD(worker, clients, -1);
+	close(client->sock);
+	free(client);
+}
+
+/**
+ * Handles readiness of a client socket.
+ *
+ * @param worker Worker the client belongs to.
+ * @param client HTTP client.
+ * @param events Events reported by epoll.
+ * @return 0 on success, -1 if the connection should be closed.
+ */
+static int http_client_handle(http_worker_t *worker, http_client_t *client, uint32_t events)
+{
+	if (events & EPOLLERR)
+		return -1;
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+		ssize_t once;
+
+		if (client->state == HTTP_CLIENT_STREAM) {
+			char discard[256];
+
+			/* nothing more is expected from the client, except closing the connection */
+			once = recv(client->sock, discard, sizeof(discard), 0);
+		} else if (client->request_length < sizeof(client->request) - 1) {
+			/* next requests may come before the response is sent */
+			once = recv(client->sock, client->request + client->request_length,
+				sizeof(client->request) - 1 - client->request_length, 0);
+		} else {
+			return -1;
+		}
+		if (once < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return -1;
+		if (!once) {
+			/* the client won't send anything more, but it may still wait for the response */
+			if (client->state != HTTP_CLIENT_RESPONSE)
+				return -1;
+			client->eof = 1;
+			client->keep_alive = 0;
+			http_client_poll(worker, client, 1);
+		}
+		if (once > 0 && client->state != HTTP_CLIENT_STREAM)
+			client->request_length += once;
+		if (client->state == HTTP_CLIENT_REQUEST)
+			return http_client_request(worker, client);
+	}
+	if (events & EPOLLOUT)
+		return http_client_flush(worker, client);
+	return 0;
+}
+
+/**
+ * Accepts pending connections on the listening socket of a worker.
+ *
+ * @param worker Worker.
+ */
+static void http_worker_accept(http_worker_t *worker)
+{
+	for (;;) {
+		struct sockaddr_in addr;
+		socklen_t len = sizeof(addr);
+		struct epoll_event event;
+		http_client_t *client;
+		int sock = accept(worker->listener, (struct sockaddr *) &addr, &len);
+
+		if (sock < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				perror("accept");
+			return;
+		}
+		if (len >= sizeof(addr)) {
+			char address[INET_ADDRSTRLEN];
+
+			fprintf(stderr, "Connection from %s:%hu\n",
+				inet_ntop(AF_INET, &addr.sin_addr, address, sizeof(address)), ntohs(addr.sin_port));
+		}
+		client = (http_client_t *) calloc(1, sizeof(http_client_t));
+		if (!client || fcntl(sock, F_SETFL, O_NONBLOCK)) {
+			free(client);
+			close(sock);
+			continue;
+		}
+		client->sock = sock;
+		client->state = HTTP_CLIENT_REQUEST;
+		client->events = EPOLLIN | EPOLLRDHUP;
+		event.events = client->events;
+		event.data.ptr = client;
+		if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, sock, &event)) {
+			free(client);
+			close(sock);
+			continue;
+		}
+		client->next = worker->clients;
+		if (client->next)
+			client->next->prev = client;
+		worker->clients = client;
+		HTTP_STAT_ADD(worker, clients, 1);
+	}
+}
+
+/**
+ * Starts sending new frames to clients of a worker which are waiting for them.
+ *
+ * @param worker Worker.
+ */
+static void http_worker_new_frame(http_worker_t *worker)
+{
+	video_frame_output_http_t *server = worker->server;
+	unsigned count = __atomic_load_n(&server->tiers, __ATOMIC_RELAXED), i;
+	shared_frame_t *frames[HTTP_TIERS_MAX];
+	http_client_t *client, *next;
+	uint64_t now = http_now();
+
+	for (i = 0; i < count; i++)
+		frames[i] = frame_store_get(server->store[i]);
+	for (client = worker->clients; client; client = next) {
+		unsigned frame_tier = client->tier;
+		shared_frame_t *frame = frame_tier < count ? frames[frame_tier] : NULL;
+
+		next = client->next;
+		/* skip clients which don't need this frame before doing anything for them */
+		if (!frame || client->seq >= frame->seq)
+			continue;
+		if (client->state == HTTP_CLIENT_STREAM && client->adaptive && now >= client->due) {
+			/* still sending a previous frame, or it's still queued in the socket */
+			int late = client->frame || http_client_backlog(client) > frame->size / 2;
+
+			http_client_adapt(server, client, late);
+			if (late || client->tier != frame_tier)
+				continue;
+		}
+		if (client->frame)
+			continue;
+		if (client->state == HTTP_CLIENT_STREAM && now >= client->due)
+			http_client_begin(worker, client, frame);
+		else if (client->state == HTTP_CLIENT_WAIT)
+			http_client_reply(worker, client, "200 OK", frame, frame->seq, "image/jpeg", NULL);
+		else
+			continue;
+		if (http_client_flush(worker, client))
+			http_client_close(worker, client);
+	}
+	for (i = 0; i < count; i++) {
+		if (frames[i])
+			shared_frame_release(frames[i]);
+	}
+}
+
+/**
+ * Event loop of a worker thread.
+ *
+ * @param arg Worker.
+ * @return NULL.
+ */
+static void *http_worker_run(void *arg)
+{
+	http_worker_t *worker = (http_worker_t *) arg;
+
+	while (!__atomic_load_n(&worker->server->stop, __ATOMIC_ACQUIRE)) {
+		struct epoll_event events[HTTP_EVENTS];
+		int n = epoll_wait(worker->epoll, events, HTTP_EVENTS, -1), i, fresh = 0;
+
+		if (n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			void *ptr = events[i].data.ptr;
 
-video_frame_output_t *video_frame_output_http_init(unsigned short port)
+			if (!ptr) {
+				http_worker_accept(worker);
+			} else if (ptr == worker) {
+				uint64_t count;
+
+				if (read(worker->event, &count, sizeof(count)) == sizeof(count))
+					fresh = 1;
+			} else if (http_client_handle(worker, (http_client_t *) ptr, events[i].events)) {
+				http_client_close(worker, (http_client_t *) ptr);
+			}
+		}
+		/* after handling other events, as it may close any client */
+		if (fresh)
+			http_worker_new_frame(worker);
+	}
+	return NULL;
+}
+
+/**
+ * Sets up a worker: its listening socket, epoll set and event.
+ *
+ * @param worker Worker.
+ * @param port TCP port number; on return it's the actual port if 0 was given.
+ * @return 0 on success, -1 on error.
+ */
+static int http_worker_init(http_worker_t *worker, unsigned short *port)
 {
-	int server = create_server_socket(port);
-	struct sockaddr_in addr;
-	socklen_t len = sizeof(addr);
-	int sock;
-	FILE *output;
+	struct epoll_event event;
 
-	if (server < 0) {
+	worker->listener = create_server_socket(port);
+	if (worker->listener < 0) {
 		perror("socket");
-		return NULL;
+		return -1;
 	}
-	sock = accept(server, (struct sockaddr *) &addr, &len);
-	close(server);
-	if (sock < 0) {
-		perror("accept");
-		return NULL;
+	worker->epoll = epoll_create1(EPOLL_CLOEXEC);
+	worker->event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (worker->epoll < 0 || worker->event < 0) {
+		perror("epoll");
+		return -1;
+	}
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->listener, &event))
+		return -1;
+	event.data.ptr = worker;
+	if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->event, &event))
+		return -1;
+	return 0;
+}
+
+/**
+ * Wakes up all the workers.
+ *
+ * @param server Instance of an HTTP output.
+ */
+static void http_server_notify(video_frame_output_http_t *server)
+{
+	static const uint64_t one = 1;
+	unsigned i;
+
+	for (i = 0; i < server->count; i++) {
+		if (write(server->worker[i].event, &one, sizeof(one)) < 0 && errno != EAGAIN)
+			perror("eventfd");
+	}
+}
+
+/**************************************/
+
+/** @copydoc video_frame_output_ops_t::PutFrame */
+static void video_frame_output_http_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
+{
+	video_frame_output_http_t *thiz = (video_frame_output_http_t *) base;
+
+	__atomic_store_n(&thiz->tiers, 1, __ATOMIC_RELAXED);
+	/* the frame is copied once, then sent by all the workers */
+	if (!frame_store_put(thiz->store[0], filter))
+		http_server_notify(thiz);
+}
+
+/** @copydoc video_frame_output_ops_t::PutTiers */
+static void video_frame_output_http_PutTiers(video_frame_output_t *base, video_frame_tiers_t *tiers)
+{
+	video_frame_output_http_t *thiz = (video_frame_output_http_t *) base;
+	unsigned count = video_frame_tiers_count(tiers), i;
+	int fresh = 0;
+
+	if (count > HTTP_TIERS_MAX)
+		count = HTTP_TIERS_MAX;
+	__atomic_store_n(&thiz->tiers, count, __ATOMIC_RELAXED);
+	for (i = 0; i < count; i++) {
+		/* the first tier is always there for snapshots; others only while they're watched */
+		int wanted = !i || __atomic_load_n(&thiz->viewers[i], __ATOMIC_RELAXED);
+		shared_frame_t *frame;
+
+		if (i && wanted != thiz->subscribed[i]) {
+			if (wanted)
+				video_frame_tiers_subscribe(tiers, i);
+			else
+				video_frame_tiers_unsubscribe(tiers, i);
+			thiz->subscribed[i] = wanted;
+		}
+		if (!wanted)
+			continue;
+		/* each frame is copied once, then sent by all the workers */
+		frame = video_frame_tiers_get_shared(tiers, i);
+		if (frame) {
+			frame_store_publish(thiz->store[i], frame);
+			fresh = 1;
+		}
+	}
+	if (fresh)
+		http_server_notify(thiz);
+}
+
+/** @copydoc video_frame_output_ops_t::Destroy */
+static void video_frame_output_http_Destroy(video_frame_output_t *base)
+{
+	video_frame_output_http_t *thiz = (video_frame_output_http_t *) base;
+	unsigned i;
+
+	__atomic_store_n(&thiz->stop, 1, __ATOMIC_RELEASE);
+	http_server_notify(thiz);
+	for (i = 0; i < thiz->count; i++) {
+		http_worker_t *worker = thiz->worker + i;
+
+		if (worker->started)
+			pthread_join(worker->thread, NULL);
+		while (worker->clients)
+			http_client_close(worker, worker->clients);
+		if (worker->listener >= 0)
+			close(worker->listener);
+		if (worker->epoll >= 0)
+			close(worker->epoll);
+		if (worker->event >= 0)
+			close(worker->event);
 	}
-	if (len >= sizeof(addr)) {
-		fprintf(stderr, "Connection from %s:%hu\n", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+	for (i = 0; i < HTTP_TIERS_MAX; i++) {
+		if (thiz->store[i])
+			frame_store_destroy(thiz->store[i]);
+	}
+	free(thiz);
+}
+
+/** Operations of the HTTP output. */
+static const video_frame_output_ops_t video_frame_output_http_ops = {
+	.PutFrame = video_frame_output_http_PutFrame,
+	.PutTiers = video_frame_output_http_PutTiers,
+	.Destroy = video_frame_output_http_Destroy,
+};
+
+/**************************************/
+
+video_frame_output_t *video_frame_output_http_init(unsigned short port, unsigned threads)
+{
+	video_frame_output_http_t *rv;
+	unsigned short actual_port = port;
+	unsigned i;
+
+	if (!threads) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		threads = cpus > 0 ? cpus : 1;
 	}
-	output = fdopen(sock, "r+");
-	if (get_query(output)) {
+	if (threads > HTTP_WORKERS_MAX)
+		threads = HTTP_WORKERS_MAX;
+	rv = (video_frame_output_http_t *) calloc(1, sizeof(video_frame_output_http_t) + threads * sizeof(http_worker_t));
+	if (!rv)
 		return NULL;
+	rv->base.op = &video_frame_output_http_ops;
+	rv->count = threads;
+	for (i = 0; i < threads; i++) {
+		rv->worker[i].server = rv;
+		rv->worker[i].listener = rv->worker[i].epoll = rv->worker[i].event = -1;
 	}
-	return video_frame_output_cgi_init(output);
+
+	for (i = 0; i < sizeof(rv->boundary) - 1; i++) {
+		int x = rand() % ('9' - '0' + 1 + 'z' - 'a' + 1);
+
+		rv->boundary[i] = x <= 9 ? x + '0' : x - 10 + 'a';
+	}
+	rv->boundary[sizeof(rv->boundary) - 1] = 0;
+	rv->trailer_length = snprintf(rv->trailer, sizeof(rv->trailer), "\n--%s\r\n", rv->boundary);
+
+	do {
+		for (i = 0; i < HTTP_TIERS_MAX; i++) {
+			rv->store[i] = frame_store_create();
+			if (!rv->store[i])
+				break;
+		}
+		if (i < HTTP_TIERS_MAX)
+			break;
+		/* all the workers listen on the same port */
+		for (i = 0; i < threads; i++) {
+			if (http_worker_init(rv->worker + i, &actual_port))
+				break;
+		}
+		if (i < threads)
+			break;
+		for (i = 0; i < threads; i++) {
+			if (pthread_create(&rv->worker[i].thread, NULL, http_worker_run, rv->worker + i))
+				break;
+			rv->worker[i].started = 1;
+		}
+		if (i < threads)
+			break;
+		if (port != actual_port)
+			fprintf(stderr, "Listening on TCP port %hu\n", actual_port);
+		return &rv->base;
+	} while (0);
+
+	video_frame_output_http_Destroy(&rv->base);
+	return NULL;
 }
 
 /**
@@ -25,7 +25,7 @@
  * @{
  * @defgroup vfo_http HTTP output
  * @{
- * Provides JPEG frames as multipart/x-mixed-replace to single HTTP client
+ * Provides JPEG frames as multipart/x-mixed-replace to HTTP clients
  */
 
 #include "vfo.h"
@@ -33,13 +33,19 @@
 /**
  * Initializes HTTP output.
  *
- * Opens a port, accepts one connection, parses GET / query, then returns
- * an interface which works exactly like @ref vfo_cgi.
+ * Starts worker threads, each listening on the same port and serving
+ * its share of clients. Every client accepted with GET / query gets
+ * a stream like the one of @ref vfo_cgi. Each frame is copied once
+ * into a store shared by the workers; clients which can't keep up
+ * skip to the latest frame. Clients may choose a tier and limit their
+ * frame rate and bit rate in the query string; tiers other than the
+ * first one are subscribed only while somebody watches them.
  *
- * @param port TCP port number on which we should listen to incoming HTTP query.
+ * @param port TCP port number on which we should listen to incoming HTTP queries.
+ * @param threads Number of worker threads, or 0 for one per CPU.
  * @return An HTTP output interface, or NULL on error.
  */
-video_frame_output_t *video_frame_output_http_init(unsigned short port);
+video_frame_output_t *video_frame_output_http_init(unsigned short port, unsigned threads);
 
 /**
  * @}
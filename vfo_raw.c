@@ -0,0 +1,320 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/videodev2.h>
+#include "vfo_raw.h"
+#include "shm_ring.h"
+
+/**
+ * @addtogroup vfo_raw
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a raw frame output. */
+typedef struct {
+	video_frame_output_t base;	/**< Base structure. */
+	char *name;					/**< Name of the ring. */
+	unsigned scale;				/**< Downscaling factor of NV12 frames, or 0 to publish frames as captured. */
+	shm_ring_t *ring;			/**< Ring of frames, or NULL until the first frame. */
+	int failed;					/**< Whether publishing has failed for good. */
+	pthread_t thread;			/**< Thread publishing frames. */
+	pthread_mutex_t lock;		/**< Protects @c pending and @c stop. */
+	pthread_cond_t cond;		/**< Signalled when @c pending or @c stop is set. */
+	capture_frame_t *pending;	/**< The latest frame waiting for the thread, or NULL. */
+	int stop;					/**< Whether the thread should exit. */
+	unsigned elapsed;			/**< Time of publishing the last frame, in microseconds. */
+	unsigned long skipped;		/**< Number of frames replaced by newer ones before being published. */
+} video_frame_output_raw_t;
+
+/**************************************/
+
+/**
+ * Returns V4L2 code of a capture data format.
+ *
+ * @param fmt Capture data format.
+ * @return Four-character code of the format.
+ */
+static unsigned raw_fourcc(capture_data_format_e fmt)
+{
+	switch (fmt) {
+		case CAPTURE_FMT__YUV422_PACKED:
+			return V4L2_PIX_FMT_YUYV;
+		case CAPTURE_FMT__JPEG:
+			return V4L2_PIX_FMT_JPEG;
+		case CAPTURE_FMT__MJPEG:
+			return V4L2_PIX_FMT_MJPEG;
+		case CAPTURE_FMT__BAYER_RGGB8:
+			return V4L2_PIX_FMT_SRGGB8;
+		case CAPTURE_FMT__BAYER_GRBG8:
+			return V4L2_PIX_FMT_SGRBG8;
+		case CAPTURE_FMT__BAYER_GBRG8:
+			return V4L2_PIX_FMT_SGBRG8;
+		case CAPTURE_FMT__BAYER_BGGR8:
+			return V4L2_PIX_FMT_SBGGR8;
+	}
+	return 0;
+}
+
+/**
+ * Describes frames published for given capture data format.
+ *
+ * @param thiz Instance of a raw frame output.
+ * @param format Capture data format.
+ * @param meta Receives description of published frames (but timestamp).
+ * @return Maximum size of published frames, or 0 if the format isn't supported.
+ */
+static size_t raw_describe(video_frame_output_raw_t *thiz, const capture_data_format_t *format, shm_ring_meta_t *meta)
+{
+	memset(meta, 0, sizeof(*meta));
+	if (thiz->scale) {
+		if (format->fmt != CAPTURE_FMT__YUV422_PACKED)
+			return 0;
+		meta->fourcc = V4L2_PIX_FMT_NV12;
+		meta->width = format->width / thiz->scale & ~1u;
+		meta->height = format->height / thiz->scale & ~1u;
+		meta->stride = meta->width;
+		return (size_t) meta->width * meta->height * 3 / 2;
+	}
+	meta->fourcc = raw_fourcc(format->fmt);
+	meta->width = format->width;
+	meta->height = format->height;
+	if (format->fmt == CAPTURE_FMT__JPEG || format->fmt == CAPTURE_FMT__MJPEG)
+		return (size_t) format->width * format->height * 2;
+	meta->stride = format->bytesperline;
+	return (size_t) format->bytesperline * format->height;
+}
+
+/**
+ * Converts a YUYV frame to NV12, averaging blocks of samples.
+ *
+ * @param src YUYV frame.
+ * @param bpl Bytes per line of @c src.
+ * @param scale Downscaling factor.
+ * @param width Width of the NV12 frame (even).
+ * @param height Height of the NV12 frame (even).
+ * @param dst NV12 frame.
+ */
+static void raw_yuyv_to_nv12(const unsigned char *src, unsigned bpl, unsigned scale, unsigned width, unsigned height, unsigned char *dst)
+{
+	unsigned char *uv = dst + (size_t) width * height;
+	unsigned area = scale * scale, x, y, i, j;
+
+	for (y = 0; y < height; y++) {
+		const unsigned char *row = src + (size_t) y * scale * bpl;
+
+		for (x = 0; x < width; x++) {
+			const unsigned char *block = row + x * scale * 2;
+			unsigned sum = 0;
+
+			for (j = 0; j < scale; j++, block += bpl)
+				for (i = 0; i < scale; i++)
+					sum += block[i * 2];
+			*dst++ = (sum + area / 2) / area;
+		}
+	}
+	/* a chroma sample covers 2x2 pixels, i.e. pairs of YUYV samples in 2 lines */
+	area *= 2;
+	for (y = 0; y < height / 2; y++) {
+		const unsigned char *row = src + (size_t) y * 2 * scale * bpl;
+
+		for (x = 0; x < width / 2; x++) {
+			const unsigned char *block = row + x * scale * 4;
+			unsigned u = 0, v = 0;
+
+			for (j = 0; j < 2 * scale; j++, block += bpl) {
+				for (i = 0; i < scale; i++) {
+					u += block[i * 4 + 1];
+					v += block[i * 4 + 3];
+				}
+			}
+			*uv++ = (u + area / 2) / area;
+			*uv++ = (v + area / 2) / area;
+		}
+	}
+}
+
+/**
+ * Publishes a frame in the ring, setting the ring up if necessary.
+ *
+ * @param thiz Instance of a raw frame output.
+ * @param frame Captured frame.
+ */
+static void raw_publish(video_frame_output_raw_t *thiz, capture_frame_t *frame)
+{
+	shm_ring_meta_t meta;
+	size_t size = raw_describe(thiz, frame->format, &meta);
+	unsigned char *dst;
+
+	if (!size) {
+		fprintf(stderr, "%s: NV12 frames can be made of YUYV frames only\n", thiz->name);
+		__atomic_store_n(&thiz->failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (!thiz->ring) {
+		int claimed;
+
+		thiz->ring = shm_ring_open(thiz->name, size);
+		claimed = thiz->ring ? shm_ring_claim(thiz->ring) : -1;
+		if (claimed <= 0) {
+			fprintf(stderr, "%s: %s\n", thiz->name, claimed ? "could not set up shared memory" : "another instance publishes frames there");
+			__atomic_store_n(&thiz->failed, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	}
+	if (!thiz->scale)
+		size = frame->size;
+	dst = shm_ring_begin(thiz->ring, size);
+	if (!dst) {
+		fprintf(stderr, "%s: frame of %zu bytes doesn't fit in shared memory\n", thiz->name, size);
+		return;
+	}
+	if (thiz->scale)
+		raw_yuyv_to_nv12(frame->data, frame->format->bytesperline, thiz->scale, meta.width, meta.height, dst);
+	else
+		memcpy(dst, frame->data, size);
+	meta.timestamp = (unsigned long long) frame->time.tv_sec * 1000000000 + frame->time.tv_nsec;
+	shm_ring_commit(thiz->ring, size, &meta);
+}
+
+/**
+ * Publishes frames handed over by PutTiers() until the output is destroyed.
+ *
+ * @param arg Instance of a raw frame output.
+ * @return NULL.
+ */
+static void *raw_run(void *arg)
+{
+	video_frame_output_raw_t *thiz = (video_frame_output_raw_t *) arg;
+
+	for (;;) {
+		struct timespec start, end;
+		capture_frame_t *frame;
+
+		pthread_mutex_lock(&thiz->lock);
+		while (!thiz->pending && !thiz->stop)
+			pthread_cond_wait(&thiz->cond, &thiz->lock);
+		frame = thiz->pending;
+		thiz->pending = NULL;
+		pthread_mutex_unlock(&thiz->lock);
+		if (!frame)
+			break;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (!__atomic_load_n(&thiz->failed, __ATOMIC_RELAXED))
+			raw_publish(thiz, frame);
+		capture_frame_release(frame);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		__atomic_store_n(&thiz->elapsed, (unsigned) ((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000), __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+/** @copydoc video_frame_output_ops_t::PutFrame */
+static void video_frame_output_raw_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
+{
+	/* filtered frames aren't raw any more */
+	(void) base;
+	(void) filter;
+}
+
+/** @copydoc video_frame_output_ops_t::PutTiers */
+static void video_frame_output_raw_PutTiers(video_frame_output_t *base, video_frame_tiers_t *tiers)
+{
+	video_frame_output_raw_t *thiz = (video_frame_output_raw_t *) base;
+	capture_frame_t *frame = video_frame_tiers_get_captured(tiers), *old;
+
+	if (!frame || __atomic_load_n(&thiz->failed, __ATOMIC_RELAXED))
+		return;
+	/* the frame may wait for the previous one, so the capture buffer is copied if that's too long */
+	frame = capture_frame_hold(frame, 2 * __atomic_load_n(&thiz->elapsed, __ATOMIC_RELAXED));
+	pthread_mutex_lock(&thiz->lock);
+	old = thiz->pending;
+	thiz->pending = frame;
+	pthread_cond_signal(&thiz->cond);
+	pthread_mutex_unlock(&thiz->lock);
+	if (old) {
+		capture_frame_release(old);
+		thiz->skipped++;
+	}
+}
+
+/** @copydoc video_frame_output_ops_t::Destroy */
+static void video_frame_output_raw_Destroy(video_frame_output_t *base)
+{
+	video_frame_output_raw_t *thiz = (video_frame_output_raw_t *) base;
+
+	pthread_mutex_lock(&thiz->lock);
+	thiz->stop = 1;
+	if (thiz->pending) {
+		capture_frame_release(thiz->pending);
+		thiz->pending = NULL;
+	}
+	pthread_cond_signal(&thiz->cond);
+	pthread_mutex_unlock(&thiz->lock);
+	pthread_join(thiz->thread, NULL);
+	pthread_cond_destroy(&thiz->cond);
+	pthread_mutex_destroy(&thiz->lock);
+	if (thiz->skipped)
+		fprintf(stderr, "%s: %lu raw frames skipped\n", thiz->name, thiz->skipped);
+	if (thiz->ring)
+		shm_ring_close(thiz->ring);
+	free(thiz->name);
+	free(thiz);
+}
+
+/** Operations of the raw frame output. */
+static const video_frame_output_ops_t video_frame_output_raw_ops = {
+	.PutFrame = video_frame_output_raw_PutFrame,
+	.PutTiers = video_frame_output_raw_PutTiers,
+	.Destroy = video_frame_output_raw_Destroy,
+};
+
+/**************************************/
+
+video_frame_output_t *video_frame_output_raw_init(const char *name, unsigned scale)
+{
+	video_frame_output_raw_t *rv = (video_frame_output_raw_t *) calloc(1, sizeof(video_frame_output_raw_t));
+
+	if (!rv)
+		return NULL;
+	rv->base.op = &video_frame_output_raw_ops;
+	rv->name = strdup(name);
+	rv->scale = scale;
+	pthread_mutex_init(&rv->lock, NULL);
+	pthread_cond_init(&rv->cond, NULL);
+	if (!rv->name || pthread_create(&rv->thread, NULL, raw_run, rv)) {
+		pthread_cond_destroy(&rv->cond);
+		pthread_mutex_destroy(&rv->lock);
+		free(rv->name);
+		free(rv);
+		return NULL;
+	}
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,58 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFO_RAW_H
+#define	VFO_RAW_H
+
+/**
+ * @addtogroup vfo
+ * @{
+ * @defgroup vfo_raw Raw frame output
+ * @{
+ * Publishes captured frames, before any compression, in a shared memory ring
+ */
+
+#include "vfo.h"
+
+/**
+ * Initializes output of raw frames to a shared memory ring.
+ *
+ * Captured frames are published as they are (e.g. YUYV), or converted
+ * to NV12 (a plane of Y followed by a plane of interleaved U and V at half
+ * resolution) and downscaled on the way, with their description
+ * (see @ref shm_ring_meta_t). Local consumers can use them in place with
+ * @ref shm_ring_peek and @ref shm_ring_check. Frames are published by
+ * a thread of the output; when it's busy, it gets the latest frame next.
+ *
+ * The output needs captured frames, so it's fed by
+ * video_frame_output_ops_t::PutTiers only.
+ *
+ * @param name Name of the ring, without slashes.
+ * @param scale Downscaling factor of NV12 frames (1 for original size),
+ *              or 0 to publish frames as captured.
+ * @return An instance of raw frame output interface, or NULL on error.
+ */
+video_frame_output_t *video_frame_output_raw_init(const char *name, unsigned scale);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "vfo_shm.h"
+
+/**
+ * @addtogroup vfo_shm
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a shared memory output. */
+typedef struct {
+	video_frame_output_t base;	/**< Base structure. */
+	shm_ring_t *ring;			/**< Ring the frames are written to. */
+	size_t capacity;			/**< Size hint for frames read by PutFrame(). */
+	unsigned long oversized;	/**< Number of frames which didn't fit in the ring. */
+} video_frame_output_shm_t;
+
+/**************************************/
+
+/**
+ * Writes a frame to the ring.
+ *
+ * @param thiz Instance of a shared memory output.
+ * @param frame Frame.
+ */
+static void video_frame_output_shm_put(video_frame_output_shm_t *thiz, shared_frame_t *frame)
+{
+	if (shm_ring_put(thiz->ring, frame->data, frame->size, NULL) && !thiz->oversized++)
+		fprintf(stderr, "Frame of %zu bytes doesn't fit in shared memory, skipped\n", frame->size);
+}
+
+/** @copydoc video_frame_output_ops_t::PutFrame */
+static void video_frame_output_shm_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
+{
+	video_frame_output_shm_t *thiz = (video_frame_output_shm_t *) base;
+	shared_frame_t *frame = shared_frame_create(filter, &thiz->capacity);
+
+	if (frame) {
+		video_frame_output_shm_put(thiz, frame);
+		shared_frame_release(frame);
+	}
+}
+
+/** @copydoc video_frame_output_ops_t::PutTiers */
+static void video_frame_output_shm_PutTiers(video_frame_output_t *base, video_frame_tiers_t *tiers)
+{
+	video_frame_output_shm_t *thiz = (video_frame_output_shm_t *) base;
+	/* the first tier is read once, whoever else wants it */
+	shared_frame_t *frame = video_frame_tiers_get_shared(tiers, 0);
+
+	if (frame) {
+		video_frame_output_shm_put(thiz, frame);
+		shared_frame_release(frame);
+	}
+}
+
+/** @copydoc video_frame_output_ops_t::Destroy */
+static void video_frame_output_shm_Destroy(video_frame_output_t *base)
+{
+	video_frame_output_shm_t *thiz = (video_frame_output_shm_t *) base;
+
+	if (thiz->oversized)
+		fprintf(stderr, "%lu frames didn't fit in shared memory\n", thiz->oversized);
+	shm_ring_close(thiz->ring);
+	free(thiz);
+}
+
+/** Operations of the shared memory output. */
+static const video_frame_output_ops_t video_frame_output_shm_ops = {
+	.PutFrame = video_frame_output_shm_PutFrame,
+	.PutTiers = video_frame_output_shm_PutTiers,
+	.Destroy = video_frame_output_shm_Destroy,
+};
+
+/**************************************/
+
+video_frame_output_t *video_frame_output_shm_init(shm_ring_t *ring)
+{
+	video_frame_output_shm_t *rv = (video_frame_output_shm_t *) calloc(1, sizeof(video_frame_output_shm_t));
+
+	if (!rv) {
+		shm_ring_close(ring);
+		return NULL;
+	}
+	rv->base.op = &video_frame_output_shm_ops;
+	rv->ring = ring;
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,50 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFO_SHM_H
+#define	VFO_SHM_H
+
+/**
+ * @addtogroup vfo
+ * @{
+ * @defgroup vfo_shm Shared memory output
+ * @{
+ * Publishes frames in a shared memory ring for other processes
+ */
+
+#include "vfo.h"
+#include "shm_ring.h"
+
+/**
+ * Initializes output to a shared memory ring.
+ *
+ * The first tier is written to the ring, from which any number of other
+ * instances can read it (see @ref shm_ring_read).
+ *
+ * @param ring Ring of frames, whose broker this process is; the output takes ownership of it.
+ * @return An instance of shared memory output interface, or NULL on error.
+ */
+video_frame_output_t *video_frame_output_shm_init(shm_ring_t *ring);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
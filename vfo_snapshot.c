@@ -0,0 +1,112 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vfo_snapshot.h"
+
+/**
+ * @addtogroup vfo_snapshot
+ * @{
+ */
+
+/**************************************/
+
+/** Instance of a snapshot file output. */
+typedef struct {
+	video_frame_output_t base;	/**< Base structure. */
+	char *path;					/**< Path of the snapshot file. */
+	char *tmp_path;				/**< Path of the temporary file. */
+} video_frame_output_snapshot_t;
+
+/**************************************/
+
+/** @copydoc video_frame_output_ops_t::PutFrame */
+static void video_frame_output_snapshot_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
+{
+	video_frame_output_snapshot_t *thiz = (video_frame_output_snapshot_t *) base;
+	FILE *f;
+
+	if (!filter || !filter->op->GetSize(filter))
+		return;
+
+	f = fopen(thiz->tmp_path, "w");
+	if (!f) {
+		perror(thiz->tmp_path);
+		return;
+	}
+	for (;;) {
+		const unsigned char *buffer;
+		size_t size;
+
+		filter->op->Read(filter, &buffer, &size);
+		if (!size)
+			break;
+		if (fwrite(buffer, 1, size, f) != size) {
+			perror("fwrite");
+			fclose(f);
+			remove(thiz->tmp_path);
+			return;
+		}
+	}
+	if (fclose(f) || rename(thiz->tmp_path, thiz->path)) {
+		perror(thiz->path);
+		remove(thiz->tmp_path);
+	}
+}
+
+/** @copydoc video_frame_output_ops_t::Destroy */
+static void video_frame_output_snapshot_Destroy(video_frame_output_t *base)
+{
+	video_frame_output_snapshot_t *thiz = (video_frame_output_snapshot_t *) base;
+
+	free(thiz->path);
+	free(thiz->tmp_path);
+	free(thiz);
+}
+
+/** Operations of the snapshot file output. */
+static const video_frame_output_ops_t video_frame_output_snapshot_ops = {
+	.PutFrame = video_frame_output_snapshot_PutFrame,
+	.Destroy = video_frame_output_snapshot_Destroy,
+};
+
+/**************************************/
+
+video_frame_output_t *video_frame_output_snapshot_init(const char *path)
+{
+	video_frame_output_snapshot_t *rv = (video_frame_output_snapshot_t *) calloc(1, sizeof(video_frame_output_snapshot_t));
+	size_t len = strlen(path);
+
+	rv->base.op = &video_frame_output_snapshot_ops;
+	rv->path = strdup(path);
+	rv->tmp_path = malloc(len + sizeof(".tmp"));
+	if (!rv->path || !rv->tmp_path) {
+		video_frame_output_snapshot_Destroy(&rv->base);
+		return NULL;
+	}
+	memcpy(rv->tmp_path, path, len);
+	memcpy(rv->tmp_path + len, ".tmp", sizeof(".tmp"));
+	return &rv->base;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,50 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFO_SNAPSHOT_H
+#define	VFO_SNAPSHOT_H
+
+/**
+ * @addtogroup vfo
+ * @{
+ * @defgroup vfo_snapshot Snapshot file output
+ * @{
+ * Keeps the latest frame in a single JPEG file
+ */
+
+#include "vfo.h"
+
+/**
+ * Initializes output to a snapshot file.
+ *
+ * Each frame replaces the previous one in the file. It's written to
+ * a temporary file first and then renamed, so readers (e.g. a web server)
+ * never see a partially written frame.
+ *
+ * @param path Path of the snapshot file.
+ * @return An instance of snapshot file output interface, or NULL on error.
+ */
+video_frame_output_t *video_frame_output_snapshot_init(const char *path);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "vfo_stdout.h"
 
 /**
@@ -28,31 +29,20 @@
 
 /**************************************/
 
+/** Maximum number of chunks of a frame written at once. */
+#define	VFO_STDOUT_CHUNKS	8
+
 /** @copydoc video_frame_output_ops_t::PutFrame */
 static void video_frame_output_stdout_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
 {
-	(void) base;
-
-	for (;;) {
-		const unsigned char *buffer;
-		size_t size;
+	struct iovec iov[VFO_STDOUT_CHUNKS];
+	unsigned n;
 
-		filter->op->Read(filter, &buffer, &size);
-		if (size) {
-			size_t written = 0;
-
-			while (written < size) {
-				int once = fwrite(buffer + written, 1, size - written, stdout);
-				if (once <= 0) {
-					perror("fwrite");
-					return;
-				}
-				written += once;
-			}
-			if (written != size) {
-				break;
-			}
-		} else {
+	(void) base;
+	fflush(stdout);
+	while ((n = vff_get_chunks(filter, iov, VFO_STDOUT_CHUNKS)) > 0) {
+		if (vfo_writev(STDOUT_FILENO, iov, n)) {
+			perror("writev");
 			break;
 		}
 	}
@@ -65,7 +55,7 @@ static void video_frame_output_stdout_Destroy(video_frame_output_t *base)
 }
 
 /** Operations of the stdout output. */
-video_frame_output_ops_t video_frame_output_stdout_ops = {
+static const video_frame_output_ops_t video_frame_output_stdout_ops = {
 	.PutFrame = video_frame_output_stdout_PutFrame,
 	.Destroy = video_frame_output_stdout_Destroy,
 };
@@ -0,0 +1,268 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "vfo_tee.h"
+#include "vff_null.h"
+
+/**
+ * @addtogroup vfo_tee
+ * @{
+ */
+
+/**************************************/
+
+/** Maximum number of outputs of a tee. */
+#define	VFO_TEE_MAX		8
+
+/** Number of frames waiting for a queued output; the oldest are lost beyond that. */
+#define	VFO_TEE_QUEUE	8
+
+/** Output of a tee. */
+typedef struct {
+	video_frame_output_t *out;				/**< The output. */
+	const char *name;						/**< Name of the output for messages. */
+	video_frame_filter_t *feed;				/**< Null filter passing queued frames to @c out, or NULL if @c out is called directly. */
+	pthread_t thread;						/**< Thread writing queued frames to @c out. */
+	pthread_mutex_t lock;					/**< Protects @c queue, @c head, @c queued and @c stop. */
+	pthread_cond_t cond;					/**< Signalled when a frame is queued or @c stop is set. */
+	shared_frame_t *queue[VFO_TEE_QUEUE];	/**< Frames waiting to be written (ring buffer). */
+	unsigned head;							/**< Index of the oldest frame in @c queue. */
+	unsigned queued;						/**< Number of frames in @c queue. */
+	int stop;								/**< Whether the thread should exit once @c queue is empty. */
+	unsigned long dropped;					/**< Number of frames lost since @c out fell behind. */
+} vfo_tee_branch_t;
+
+/** Instance of a tee output. */
+typedef struct {
+	video_frame_output_t base;				/**< Base structure. */
+	unsigned count;							/**< Number of outputs. */
+	vfo_tee_branch_t branch[VFO_TEE_MAX];	/**< Outputs (@c count entries). */
+	video_frame_filter_t *feed;				/**< Null filter passing frames to outputs called directly by PutFrame(). */
+	size_t capacity;						/**< Size hint for frames read by PutFrame(). */
+} video_frame_output_tee_t;
+
+/**************************************/
+
+/**
+ * Writes frames queued for an output until the tee is destroyed.
+ *
+ * @param arg Output of a tee.
+ * @return NULL.
+ */
+static void *vfo_tee_branch_run(void *arg)
+{
+	vfo_tee_branch_t *branch = (vfo_tee_branch_t *) arg;
+
+	for (;;) {
+		shared_frame_t *frame;
+
+		pthread_mutex_lock(&branch->lock);
+		while (!branch->queued && !branch->stop)
+			pthread_cond_wait(&branch->cond, &branch->lock);
+		if (!branch->queued) {
+			pthread_mutex_unlock(&branch->lock);
+			break;
+		}
+		frame = branch->queue[branch->head];
+		branch->head = (branch->head + 1) % VFO_TEE_QUEUE;
+		branch->queued--;
+		pthread_mutex_unlock(&branch->lock);
+
+		branch->feed->op->PutFrame(branch->feed, frame->data, frame->size);
+		branch->out->op->PutFrame(branch->out, branch->feed);
+		shared_frame_release(frame);
+	}
+	return NULL;
+}
+
+/**
+ * Queues a frame for an output.
+ *
+ * @param branch Output of a tee.
+ * @param frame Frame; a new reference to it is taken.
+ */
+static void vfo_tee_branch_queue(vfo_tee_branch_t *branch, shared_frame_t *frame)
+{
+	shared_frame_t *lost = NULL;
+	int idle;
+
+	pthread_mutex_lock(&branch->lock);
+	idle = !branch->queued;
+	if (branch->queued == VFO_TEE_QUEUE) {
+		/* the output fell behind: keep the latest frames */
+		lost = branch->queue[branch->head];
+		branch->head = (branch->head + 1) % VFO_TEE_QUEUE;
+		branch->queued--;
+	}
+	branch->queue[(branch->head + branch->queued++) % VFO_TEE_QUEUE] = shared_frame_ref(frame);
+	pthread_cond_signal(&branch->cond);
+	pthread_mutex_unlock(&branch->lock);
+
+	if (lost) {
+		if (!branch->dropped++)
+			fprintf(stderr, "tee: %s output falls behind, dropping frames\n", branch->name);
+		shared_frame_release(lost);
+	} else if (idle && branch->dropped) {
+		fprintf(stderr, "tee: %s output caught up after %lu dropped frames\n", branch->name, branch->dropped);
+		branch->dropped = 0;
+	}
+}
+
+/** @copydoc video_frame_output_ops_t::PutFrame */
+static void video_frame_output_tee_PutFrame(video_frame_output_t *base, video_frame_filter_t *filter)
+{
+	video_frame_output_tee_t *thiz = (video_frame_output_tee_t *) base;
+	shared_frame_t *frame = shared_frame_create(filter, &thiz->capacity);
+	unsigned i;
+
+	if (!frame)
+		return;
+	for (i = 0; i < thiz->count; i++) {
+		vfo_tee_branch_t *branch = thiz->branch + i;
+
+		if (branch->feed) {
+			vfo_tee_branch_queue(branch, frame);
+		} else {
+			thiz->feed->op->PutFrame(thiz->feed, frame->data, frame->size);
+			branch->out->op->PutFrame(branch->out, thiz->feed);
+		}
+	}
+	shared_frame_release(frame);
+}
+
+/** @copydoc video_frame_output_ops_t::PutTiers */
+static void video_frame_output_tee_PutTiers(video_frame_output_t *base, video_frame_tiers_t *tiers)
+{
+	video_frame_output_tee_t *thiz = (video_frame_output_tee_t *) base;
+	shared_frame_t *frame = NULL;
+	int fetched = 0;
+	unsigned i;
+
+	for (i = 0; i < thiz->count; i++) {
+		vfo_tee_branch_t *branch = thiz->branch + i;
+
+		if (!branch->feed) {
+			branch->out->op->PutTiers(branch->out, tiers);
+			continue;
+		}
+		/* the first tier is read once for all the queued outputs */
+		if (!fetched) {
+			frame = video_frame_tiers_get_shared(tiers, 0);
+			fetched = 1;
+		}
+		/* the first tier may have no frame this time (skipped or invalid), other outputs still get theirs */
+		if (frame)
+			vfo_tee_branch_queue(branch, frame);
+	}
+	if (frame)
+		shared_frame_release(frame);
+}
+
+/** @copydoc video_frame_output_ops_t::Destroy */
+static void video_frame_output_tee_Destroy(video_frame_output_t *base)
+{
+	video_frame_output_tee_t *thiz = (video_frame_output_tee_t *) base;
+	unsigned i;
+
+	for (i = 0; i < thiz->count; i++) {
+		vfo_tee_branch_t *branch = thiz->branch + i;
+
+		if (branch->feed) {
+			/* frames already queued are still written */
+			pthread_mutex_lock(&branch->lock);
+			branch->stop = 1;
+			pthread_cond_signal(&branch->cond);
+			pthread_mutex_unlock(&branch->lock);
+			pthread_join(branch->thread, NULL);
+			pthread_cond_destroy(&branch->cond);
+			pthread_mutex_destroy(&branch->lock);
+			branch->feed->op->Destroy(branch->feed);
+		}
+		branch->out->op->Destroy(branch->out);
+	}
+	if (thiz->feed)
+		thiz->feed->op->Destroy(thiz->feed);
+	free(thiz);
+}
+
+/** Operations of the tee output. */
+static const video_frame_output_ops_t video_frame_output_tee_ops = {
+	.PutFrame = video_frame_output_tee_PutFrame,
+	.PutTiers = video_frame_output_tee_PutTiers,
+	.Destroy = video_frame_output_tee_Destroy,
+};
+
+/**************************************/
+
+video_frame_output_t *video_frame_output_tee_init(void)
+{
+	video_frame_output_tee_t *rv = (video_frame_output_tee_t *) calloc(1, sizeof(video_frame_output_tee_t));
+
+	if (!rv)
+		return NULL;
+	rv->base.op = &video_frame_output_tee_ops;
+	rv->feed = vff_null_create();
+	if (!rv->feed) {
+		free(rv);
+		return NULL;
+	}
+	return &rv->base;
+}
+
+int video_frame_output_tee_add(video_frame_output_t *tee, video_frame_output_t *out, const char *name)
+{
+	video_frame_output_tee_t *thiz = (video_frame_output_tee_t *) tee;
+	vfo_tee_branch_t *branch = thiz->branch + thiz->count;
+
+	if (thiz->count >= VFO_TEE_MAX) {
+		fprintf(stderr, "tee: too many outputs, at most %u are supported\n", VFO_TEE_MAX);
+		out->op->Destroy(out);
+		return -1;
+	}
+	branch->out = out;
+	branch->name = name;
+	/* outputs taking tiers don't block, others may (pipes, disks) */
+	if (!out->op->PutTiers) {
+		branch->feed = vff_null_create();
+		if (!branch->feed) {
+			out->op->Destroy(out);
+			return -1;
+		}
+		pthread_mutex_init(&branch->lock, NULL);
+		pthread_cond_init(&branch->cond, NULL);
+		if (pthread_create(&branch->thread, NULL, vfo_tee_branch_run, branch)) {
+			perror("pthread_create");
+			pthread_cond_destroy(&branch->cond);
+			pthread_mutex_destroy(&branch->lock);
+			branch->feed->op->Destroy(branch->feed);
+			branch->feed = NULL;
+			out->op->Destroy(out);
+			return -1;
+		}
+	}
+	thiz->count++;
+	return 0;
+}
+
+/**
+ * @}
+ */
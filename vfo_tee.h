@@ -0,0 +1,62 @@
+/*
+ * This file is part of webcam.
+ *
+ * Copyright (c) 2026 Aleksander Mazur
+ *
+ * webcam is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * webcam is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with webcam. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef	VFO_TEE_H
+#define	VFO_TEE_H
+
+/**
+ * @addtogroup vfo
+ * @{
+ * @defgroup vfo_tee Tee output
+ * @{
+ * Passes each frame to several outputs, each going at its own pace
+ */
+
+#include "vfo.h"
+
+/**
+ * Initializes an output passing each frame to several outputs.
+ *
+ * Outputs which take tiers (see video_frame_output_ops_t::PutTiers) are
+ * expected not to block, so they're called directly. Other outputs get
+ * the first tier, read once and shared by all of them; each of them is
+ * fed by its own thread from a short queue, which loses the oldest frames
+ * when the output falls behind, so a slow output never holds back the others.
+ *
+ * @return An instance of a tee output with no outputs yet, or NULL on error.
+ */
+video_frame_output_t *video_frame_output_tee_init(void);
+
+/**
+ * Adds an output to the tee.
+ *
+ * @param tee Instance of a tee output.
+ * @param out Instance of a video frame output; the tee takes ownership of it.
+ * @param name Name of the output used in messages; it must remain valid
+ *             until the tee is destroyed.
+ * @return 0 on success, -1 on error (@c out is destroyed then).
+ */
+int video_frame_output_tee_add(video_frame_output_t *tee, video_frame_output_t *out, const char *name);
+
+/**
+ * @}
+ * @}
+ */
+
+#endif